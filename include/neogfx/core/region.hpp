@@ -0,0 +1,200 @@
+// region.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <vector>
+#include <algorithm>
+#include <neogfx/core/geometrical.hpp>
+
+namespace neogfx
+{
+    // A set of disjoint rectangles (e.g. the damaged area of a surface). Rectangles that touch or overlap
+    // are merged into their bounding rectangle when that wastes little area, otherwise the new rectangle
+    // is clipped against the existing ones; the number of rectangles is capped by merging the pair
+    // that wastes the least area.
+    class region
+    {
+    public:
+        typedef std::vector<rect> rect_list;
+    public:
+        static constexpr std::size_t MaxRects = 16u;
+        static constexpr double MergeWaste = 0.25;
+    public:
+        region()
+        {
+        }
+        region(const rect& aRect)
+        {
+            add(aRect);
+        }
+    public:
+        bool empty() const
+        {
+            return iRects.empty();
+        }
+        const rect_list& rects() const
+        {
+            return iRects;
+        }
+        rect bounding_rect() const
+        {
+            if (iRects.empty())
+                return rect{};
+            auto result = iRects[0];
+            for (auto const& r : iRects)
+                result = result.combined(r);
+            return result;
+        }
+        double area() const
+        {
+            double result = 0.0;
+            for (auto const& r : iRects)
+                result += area(r);
+            return result;
+        }
+        bool intersects(const rect& aRect) const
+        {
+            return std::any_of(iRects.begin(), iRects.end(), [&](const rect& r) { return r.intersects(aRect); });
+        }
+        void clear()
+        {
+            iRects.clear();
+        }
+        void add(const rect& aRect)
+        {
+            if (aRect.empty())
+                return;
+            auto r = aRect;
+            for (auto existing = iRects.begin(); existing != iRects.end();)
+            {
+                if (existing->contains(r))
+                    return;
+                if (r.contains(*existing))
+                {
+                    existing = iRects.erase(existing);
+                    continue;
+                }
+                if (touches(*existing, r))
+                {
+                    auto const merged = existing->combined(r);
+                    if (area(merged) * (1.0 - MergeWaste) <= area(*existing) + area(r) - area(existing->intersection(r)))
+                    {
+                        // the merged rectangle may now cover others so start again
+                        r = merged;
+                        iRects.erase(existing);
+                        existing = iRects.begin();
+                        continue;
+                    }
+                }
+                ++existing;
+            }
+            rect_list pieces{ r };
+            rect_list remaining;
+            for (auto const& existing : iRects)
+            {
+                remaining.clear();
+                for (auto const& piece : pieces)
+                    subtract(piece, existing, remaining);
+                pieces.swap(remaining);
+            }
+            iRects.insert(iRects.end(), pieces.begin(), pieces.end());
+            while (iRects.size() > MaxRects)
+                merge_cheapest();
+        }
+        region& operator+=(const rect& aRect)
+        {
+            add(aRect);
+            return *this;
+        }
+        // Reduces the region to at most aMaxRects rectangles, or to its bounding rectangle if that wastes little area.
+        void coalesce(std::size_t aMaxRects)
+        {
+            if (iRects.size() > 1u && area(bounding_rect()) * (1.0 - MergeWaste) <= area())
+                iRects.assign(1u, bounding_rect());
+            while (iRects.size() > std::max<std::size_t>(aMaxRects, 1u))
+                merge_cheapest();
+        }
+    private:
+        static double area(const rect& aRect)
+        {
+            return aRect.cx * aRect.cy;
+        }
+        // Unlike rect::intersects this is also true for rectangles that only share an edge.
+        static bool touches(const rect& aLhs, const rect& aRhs)
+        {
+            return aLhs.x <= aRhs.x + aRhs.cx && aRhs.x <= aLhs.x + aLhs.cx &&
+                aLhs.y <= aRhs.y + aRhs.cy && aRhs.y <= aLhs.y + aLhs.cy;
+        }
+        // Appends the parts of aRect not covered by aHole: bands above and below then slices either side.
+        static void subtract(const rect& aRect, const rect& aHole, rect_list& aResult)
+        {
+            auto const hole = aRect.intersection(aHole);
+            if (hole.empty())
+            {
+                aResult.push_back(aRect);
+                return;
+            }
+            if (hole.y > aRect.y)
+                aResult.push_back(rect{ point{ aRect.x, aRect.y }, size{ aRect.cx, hole.y - aRect.y } });
+            if (hole.y + hole.cy < aRect.y + aRect.cy)
+                aResult.push_back(rect{ point{ aRect.x, hole.y + hole.cy }, size{ aRect.cx, (aRect.y + aRect.cy) - (hole.y + hole.cy) } });
+            if (hole.x > aRect.x)
+                aResult.push_back(rect{ point{ aRect.x, hole.y }, size{ hole.x - aRect.x, hole.cy } });
+            if (hole.x + hole.cx < aRect.x + aRect.cx)
+                aResult.push_back(rect{ point{ hole.x + hole.cx, hole.y }, size{ (aRect.x + aRect.cx) - (hole.x + hole.cx), hole.cy } });
+        }
+        void merge_cheapest()
+        {
+            std::size_t bestFirst = 0u;
+            std::size_t bestSecond = 1u;
+            double bestWaste = std::numeric_limits<double>::max();
+            for (std::size_t first = 0u; first < iRects.size(); ++first)
+                for (std::size_t second = first + 1u; second < iRects.size(); ++second)
+                {
+                    auto const waste = area(iRects[first].combined(iRects[second])) - area(iRects[first]) - area(iRects[second]);
+                    if (waste < bestWaste)
+                    {
+                        bestWaste = waste;
+                        bestFirst = first;
+                        bestSecond = second;
+                    }
+                }
+            auto merged = iRects[bestFirst].combined(iRects[bestSecond]);
+            iRects.erase(std::next(iRects.begin(), bestSecond));
+            iRects.erase(std::next(iRects.begin(), bestFirst));
+            // absorb anything the merged rectangle now overlaps so that the rectangles stay disjoint
+            for (auto existing = iRects.begin(); existing != iRects.end();)
+            {
+                if (existing->intersects(merged))
+                {
+                    merged = merged.combined(*existing);
+                    iRects.erase(existing);
+                    existing = iRects.begin();
+                }
+                else
+                    ++existing;
+            }
+            iRects.push_back(merged);
+        }
+    private:
+        rect_list iRects;
+    };
+}
\ No newline at end of file
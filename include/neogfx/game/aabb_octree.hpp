@@ -20,6 +20,7 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <unordered_map>
 #include <boost/pool/pool_alloc.hpp>
 #include <neolib/core/vecarray.hpp>
 #include <neolib/core/lifetime.hpp>
@@ -170,6 +171,59 @@ namespace neogfx::game
                 if (empty())
                     iTree.destroy_node(*this);
             }
+            void remove_placement(entity_id aEntity, const neogfx::aabb& aAabb)
+            {
+                if (!is_split())
+                {
+                    auto existing = std::find(iEntities.begin(), iEntities.end(), aEntity);
+                    if (existing != iEntities.end())
+                        iEntities.erase(existing);
+                    return;
+                }
+                remove_placement<0, 0, 0>(aEntity, aAabb);
+                remove_placement<0, 0, 1>(aEntity, aAabb);
+                remove_placement<0, 1, 0>(aEntity, aAabb);
+                remove_placement<0, 1, 1>(aEntity, aAabb);
+                remove_placement<1, 0, 0>(aEntity, aAabb);
+                remove_placement<1, 0, 1>(aEntity, aAabb);
+                remove_placement<1, 1, 0>(aEntity, aAabb);
+                remove_placement<1, 1, 1>(aEntity, aAabb);
+                if (!has_child<0, 0, 0>() && !has_child<0, 0, 1>() && !has_child<0, 1, 0>() && !has_child<0, 1, 1>() &&
+                    !has_child<1, 0, 0>() && !has_child<1, 0, 1>() && !has_child<1, 1, 0>() && !has_child<1, 1, 1>())
+                    iChildren = std::nullopt;
+            }
+            const node* enclosing_leaf(const neogfx::aabb& aAabb) const
+            {
+                if (!aabb_strictly_contains(iAabb, aAabb))
+                    return nullptr;
+                if (!is_split())
+                    return this;
+                if (has_child<0, 0, 0>())
+                    if (auto leaf = child<0, 0, 0>().enclosing_leaf(aAabb))
+                        return leaf;
+                if (has_child<0, 0, 1>())
+                    if (auto leaf = child<0, 0, 1>().enclosing_leaf(aAabb))
+                        return leaf;
+                if (has_child<0, 1, 0>())
+                    if (auto leaf = child<0, 1, 0>().enclosing_leaf(aAabb))
+                        return leaf;
+                if (has_child<0, 1, 1>())
+                    if (auto leaf = child<0, 1, 1>().enclosing_leaf(aAabb))
+                        return leaf;
+                if (has_child<1, 0, 0>())
+                    if (auto leaf = child<1, 0, 0>().enclosing_leaf(aAabb))
+                        return leaf;
+                if (has_child<1, 0, 1>())
+                    if (auto leaf = child<1, 0, 1>().enclosing_leaf(aAabb))
+                        return leaf;
+                if (has_child<1, 1, 0>())
+                    if (auto leaf = child<1, 1, 0>().enclosing_leaf(aAabb))
+                        return leaf;
+                if (has_child<1, 1, 1>())
+                    if (auto leaf = child<1, 1, 1>().enclosing_leaf(aAabb))
+                        return leaf;
+                return nullptr;
+            }
             void update_entity(entity_id aEntity, const collider_type& aCollider)
             {
                 iTree.iDepth = std::max(iTree.iDepth, iDepth);
@@ -368,6 +422,20 @@ namespace neogfx::game
                 }
                 return false;
             }
+            template <std::size_t X, std::size_t Y, std::size_t Z>
+            void remove_placement(entity_id aEntity, const neogfx::aabb& aAabb)
+            {
+                if (!has_child<X, Y, Z>() || !aabb_intersects(iOctants[X][Y][Z], aAabb))
+                    return;
+                auto& octant = child<X, Y, Z>();
+                octant.remove_placement(aEntity, aAabb);
+                if (octant.is_split() || !octant.entities().empty())
+                    return;
+                // empty leaf: detach it first so its destruction doesn't unsplit (and possibly destroy) this node
+                (*iChildren)[X][Y][Z] = nullptr;
+                octant.iParent = nullptr;
+                iTree.destroy_node(octant);
+            }
             bool is_split() const
             {
                 return iChildren != std::nullopt;
@@ -393,6 +461,7 @@ namespace neogfx::game
                         child<1, 1, 0>().add_entity(e, collider);
                     if (aabb_intersects(iOctants[1][1][1], collider.currentAabb))
                         child<1, 1, 1>().add_entity(e, collider);
+                    iTree.placement_split(e, collider);
                 }
                 iEntities.clear();
             }
@@ -431,6 +500,13 @@ namespace neogfx::game
             mutable std::optional<children> iChildren;
         };
         typedef typename allocator_type::template rebind<node>::other node_allocator;
+        struct placement
+        {
+            neogfx::aabb aabb;
+            std::optional<neogfx::aabb> cell;
+            uint32_t generation;
+        };
+        typedef std::unordered_map<entity_id, placement> placements;
     public:
         aabb_octree(i_ecs& iEcs, const aabb& aRootAabb = aabb{ vec3{-4096.0, -4096.0, -4096.0}, vec3{4096.0, 4096.0, 4096.0} }, scalar aMinimumOctantSize = 16.0, const allocator_type& aAllocator = allocator_type{}) :
             iAllocator{ aAllocator },
@@ -440,7 +516,10 @@ namespace neogfx::game
             iDepth{ 0 },
             iRootNode{ *this, aRootAabb },
             iMinimumOctantSize{ aMinimumOctantSize },
-            iCollisionUpdateId{ 0 }
+            iCollisionUpdateId{ 0 },
+            iPlacementsValid{ false },
+            iPlacementGeneration{ 0 },
+            iReinsertions{ 0 }
         {
         }
     public:
@@ -450,17 +529,88 @@ namespace neogfx::game
         }
         void full_update()
         {
+            iPlacementsValid = false;
+            iPlacements.clear();
             iDepth = 0;
             iRootNode.~node();
             new(&iRootNode) node{ *this, iRootAabb };
+            iReinsertions = 0;
             for (auto entity : iEcs.component<collider_type>().entities())
             {
                 auto& collider = iEcs.component<collider_type>().entity_record(entity);
                 iRootNode.add_entity(entity, collider);
+                ++iReinsertions;
+            }
+        }
+        // Only reinserts colliders whose current AABB has left the leaf node it was placed in; colliders 
+        // whose AABB is unchanged (static or sleeping bodies) cost a single lookup.
+        void incremental_update()
+        {
+            if (!iPlacementsValid)
+            {
+                rebuild();
+                return;
+            }
+            if (++iPlacementGeneration == 0)
+                iPlacementGeneration = 1;
+            iReinsertions = 0;
+            std::size_t placed = 0;
+            auto const& colliders = iEcs.component<collider_type>();
+            for (auto entity : colliders.entities())
+            {
+                auto const& collider = colliders.entity_record(entity);
+                auto existing = iPlacements.find(entity);
+                if (existing == iPlacements.end())
+                {
+                    if (collider.currentAabb)
+                    {
+                        iRootNode.add_entity(entity, collider);
+                        place(entity, *collider.currentAabb);
+                        ++iReinsertions;
+                        ++placed;
+                    }
+                    continue;
+                }
+                auto& existingPlacement = existing->second;
+                if (!collider.currentAabb)
+                {
+                    iRootNode.remove_placement(entity, existingPlacement.aabb);
+                    iPlacements.erase(existing);
+                    continue;
+                }
+                ++placed;
+                existingPlacement.generation = iPlacementGeneration;
+                auto const& currentAabb = *collider.currentAabb;
+                if (currentAabb == existingPlacement.aabb)
+                    continue;
+                if (existingPlacement.cell && aabb_strictly_contains(*existingPlacement.cell, currentAabb))
+                {
+                    existingPlacement.aabb = currentAabb;
+                    continue;
+                }
+                iRootNode.remove_placement(entity, existingPlacement.aabb);
+                iRootNode.add_entity(entity, collider);
+                place(entity, currentAabb);
+                ++iReinsertions;
+            }
+            if (placed != iPlacements.size())
+            {
+                for (auto p = iPlacements.begin(); p != iPlacements.end();)
+                {
+                    if (p->second.generation != iPlacementGeneration)
+                    {
+                        iRootNode.remove_placement(p->first, p->second.aabb);
+                        p = iPlacements.erase(p);
+                    }
+                    else
+                        ++p;
+                }
             }
         }
         void dynamic_update()
         {
+            iPlacementsValid = false;
+            iPlacements.clear();
             iDepth = 0;
             for (auto entity : iEcs.component<collider_type>().entities())
             {
@@ -541,6 +691,10 @@ namespace neogfx::game
         {
             return iDepth;
         }
+        uint32_t reinsertions() const
+        {
+            return iReinsertions;
+        }
     public:
         const node& root_node() const
         {
@@ -563,6 +717,42 @@ namespace neogfx::game
                 iAllocator.deallocate(&aNode, 1);
             }
         }
+        void rebuild()
+        {
+            full_update();
+            iPlacementsValid = true;
+            if (++iPlacementGeneration == 0)
+                iPlacementGeneration = 1;
+            auto const& colliders = iEcs.component<collider_type>();
+            for (auto entity : colliders.entities())
+            {
+                auto const& collider = colliders.entity_record(entity);
+                if (collider.currentAabb)
+                    place(entity, *collider.currentAabb);
+            }
+        }
+        void place(entity_id aEntity, const aabb& aAabb)
+        {
+            auto const leaf = iRootNode.enclosing_leaf(aAabb);
+            iPlacements[aEntity] = placement{ aAabb, leaf ? leaf->aabb() : std::optional<aabb>{}, iPlacementGeneration };
+        }
+        void placement_split(entity_id aEntity, const collider_type& aCollider)
+        {
+            if (!iPlacementsValid)
+                return;
+            auto existing = iPlacements.find(aEntity);
+            if (existing == iPlacements.end())
+                return;
+            // the entity is now placed by its current AABB in the split node but may still be placed by an older AABB elsewhere
+            if (aCollider.currentAabb)
+                existing->second.aabb = aabb_union(existing->second.aabb, *aCollider.currentAabb);
+            existing->second.cell = std::nullopt;
+        }
+        static bool aabb_strictly_contains(const aabb& aOuter, const aabb& aInner)
+        {
+            return aInner.min.x > aOuter.min.x && aInner.min.y > aOuter.min.y && aInner.min.z > aOuter.min.z &&
+                aInner.max.x < aOuter.max.x && aInner.max.y < aOuter.max.y && aInner.max.z < aOuter.max.z;
+        }
     private:
         node_allocator iAllocator;
         i_ecs& iEcs;
@@ -572,5 +762,9 @@ namespace neogfx::game
         mutable uint32_t iDepth;
         node iRootNode;
         mutable uint32_t iCollisionUpdateId;
+        bool iPlacementsValid;
+        placements iPlacements;
+        uint32_t iPlacementGeneration;
+        uint32_t iReinsertions;
     };
 }
\ No newline at end of file
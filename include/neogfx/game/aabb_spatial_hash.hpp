@@ -0,0 +1,230 @@
+// aabb_spatial_hash.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <vector>
+#include <algorithm>
+#include <neogfx/core/numerical.hpp>
+#include <neogfx/game/i_ecs.hpp>
+#include <neogfx/game/entity_info.hpp>
+
+namespace neogfx::game
+{
+    // Uniform grid broadphase stored as a flat array of (cell, collider) pairs sorted by cell; best suited
+    // to scenes where most colliders are of a similar size to the cell. Colliders that would span more than
+    // MaxCellsPerCollider cells are kept in a separate list and tested against every other collider instead.
+    template <typename Collider>
+    class aabb_spatial_hash
+    {
+    public:
+        typedef Collider collider_type;
+        typedef typename std::remove_cvref_t<decltype(std::declval<collider_type>().currentAabb)>::value_type aabb_type;
+        typedef std::remove_cvref_t<decltype(std::declval<aabb_type>().min)> point_type;
+        static constexpr bool Is2d = std::is_same_v<aabb_type, aabb_2d>;
+    private:
+        typedef uint64_t cell_key;
+        typedef std::array<int32_t, 3> cell_coordinates;
+        static constexpr int32_t CellBias = 1 << 20;
+        static constexpr int64_t MaxCellsPerCollider = 64;
+        struct entry
+        {
+            aabb_type aabb;
+            uint64_t mask;
+            entity_id entity;
+            bool oversized;
+        };
+        struct cell_entry
+        {
+            cell_key key;
+            uint32_t entry;
+        };
+    public:
+        aabb_spatial_hash(i_ecs& aEcs, scalar aCellSize = 32.0) :
+            iEcs{ aEcs },
+            iCellSize{ aCellSize }
+        {
+        }
+    public:
+        scalar cell_size() const
+        {
+            return iCellSize;
+        }
+        void set_cell_size(scalar aCellSize)
+        {
+            iCellSize = aCellSize;
+        }
+        void full_update()
+        {
+            iEntries.clear();
+            iCells.clear();
+            iOversized.clear();
+            auto const& infos = iEcs.component<entity_info>();
+            auto const& colliders = iEcs.component<collider_type>();
+            for (auto entity : colliders.entities())
+            {
+                auto const& collider = colliders.entity_record(entity);
+                if (!collider.currentAabb || infos.entity_record(entity).destroyed)
+                    continue;
+                auto const index = static_cast<uint32_t>(iEntries.size());
+                auto const first = to_cell(collider.currentAabb->min);
+                auto const last = to_cell(collider.currentAabb->max);
+                auto const cellCount = (static_cast<int64_t>(last[0]) - first[0] + 1) *
+                    (static_cast<int64_t>(last[1]) - first[1] + 1) * (static_cast<int64_t>(last[2]) - first[2] + 1);
+                iEntries.push_back(entry{ *collider.currentAabb, collider.mask, entity, cellCount > MaxCellsPerCollider });
+                if (iEntries.back().oversized)
+                {
+                    iOversized.push_back(index);
+                    continue;
+                }
+                for (auto x = first[0]; x <= last[0]; ++x)
+                    for (auto y = first[1]; y <= last[1]; ++y)
+                        for (auto z = first[2]; z <= last[2]; ++z)
+                            iCells.push_back(cell_entry{ to_key(cell_coordinates{ x, y, z }), index });
+            }
+            std::sort(iCells.begin(), iCells.end(), [](const cell_entry& aLhs, const cell_entry& aRhs)
+            {
+                return aLhs.key < aRhs.key || (aLhs.key == aRhs.key && aLhs.entry < aRhs.entry);
+            });
+        }
+        template <typename CollisionAction>
+        void collisions(CollisionAction aCollisionAction) const
+        {
+            for (auto cell = iCells.begin(); cell != iCells.end();)
+            {
+                auto const cellEnd = std::find_if(std::next(cell), iCells.end(), [&](const cell_entry& aEntry) { return aEntry.key != cell->key; });
+                for (auto first = cell; first != cellEnd; ++first)
+                {
+                    auto const& firstEntry = iEntries[first->entry];
+                    for (auto second = std::next(first); second != cellEnd; ++second)
+                    {
+                        auto const& secondEntry = iEntries[second->entry];
+                        if ((firstEntry.mask & secondEntry.mask) != 0)
+                            continue;
+                        if (!aabb_intersects(firstEntry.aabb, secondEntry.aabb))
+                            continue;
+                        // a pair spanning several cells is only reported by the cell containing the minimum corner of their overlap
+                        if (to_key(to_cell(firstEntry.aabb.min.max(secondEntry.aabb.min))) != cell->key)
+                            continue;
+                        report(firstEntry, secondEntry, aCollisionAction);
+                    }
+                }
+                cell = cellEnd;
+            }
+            for (auto oversized : iOversized)
+            {
+                auto const& oversizedEntry = iEntries[oversized];
+                for (uint32_t other = 0u; other < iEntries.size(); ++other)
+                {
+                    auto const& otherEntry = iEntries[other];
+                    // pairs of oversized colliders are only reported by the one with the lower entry index
+                    if (other == oversized || (otherEntry.oversized && other < oversized))
+                        continue;
+                    if ((oversizedEntry.mask & otherEntry.mask) != 0)
+                        continue;
+                    if (!aabb_intersects(oversizedEntry.aabb, otherEntry.aabb))
+                        continue;
+                    report(oversizedEntry, otherEntry, aCollisionAction);
+                }
+            }
+        }
+        template <typename ResultContainer>
+        void pick(const point_type& aPoint, ResultContainer& aResult, std::function<bool(entity_id aMatch, const point_type& aPoint)> aColliderPredicate = [](entity_id, const point_type&) { return true; }) const
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            auto const key = to_key(to_cell(aPoint));
+            auto cell = std::lower_bound(iCells.begin(), iCells.end(), key, [](const cell_entry& aEntry, cell_key aKey) { return aEntry.key < aKey; });
+            for (; cell != iCells.end() && cell->key == key; ++cell)
+            {
+                auto const& match = iEntries[cell->entry];
+                if (aabb_intersects(match.aabb, aabb_type{ aPoint, aPoint }) && !infos.entity_record(match.entity).destroyed && aColliderPredicate(match.entity, aPoint))
+                    aResult.insert(aResult.end(), match.entity);
+            }
+            for (auto oversized : iOversized)
+            {
+                auto const& match = iEntries[oversized];
+                if (aabb_intersects(match.aabb, aabb_type{ aPoint, aPoint }) && !infos.entity_record(match.entity).destroyed && aColliderPredicate(match.entity, aPoint))
+                    aResult.insert(aResult.end(), match.entity);
+            }
+        }
+        template <typename Visitor>
+        void visit_aabbs(const Visitor& aVisitor) const
+        {
+            for (auto cell = iCells.begin(); cell != iCells.end(); ++cell)
+                if (cell == iCells.begin() || std::prev(cell)->key != cell->key)
+                    aVisitor(to_aabb(cell->key));
+        }
+    public:
+        uint32_t count() const
+        {
+            return static_cast<uint32_t>(iEntries.size());
+        }
+        uint32_t oversized_count() const
+        {
+            return static_cast<uint32_t>(iOversized.size());
+        }
+    private:
+        template <typename CollisionAction>
+        void report(const entry& aFirst, const entry& aSecond, CollisionAction& aCollisionAction) const
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            if (infos.entity_record(aFirst.entity).destroyed || infos.entity_record(aSecond.entity).destroyed)
+                return;
+            if (aFirst.entity < aSecond.entity)
+                aCollisionAction(aFirst.entity, aSecond.entity);
+            else
+                aCollisionAction(aSecond.entity, aFirst.entity);
+        }
+        cell_coordinates to_cell(const point_type& aPoint) const
+        {
+            auto const coordinate = [&](scalar aValue)
+            {
+                return static_cast<int32_t>(std::clamp(std::floor(aValue / iCellSize), static_cast<scalar>(-CellBias + 1), static_cast<scalar>(CellBias - 1)));
+            };
+            if constexpr (Is2d)
+                return cell_coordinates{ coordinate(aPoint.x), coordinate(aPoint.y), 0 };
+            else
+                return cell_coordinates{ coordinate(aPoint.x), coordinate(aPoint.y), coordinate(aPoint.z) };
+        }
+        static cell_key to_key(const cell_coordinates& aCell)
+        {
+            return (static_cast<cell_key>(aCell[0] + CellBias) << 42) |
+                (static_cast<cell_key>(aCell[1] + CellBias) << 21) |
+                static_cast<cell_key>(aCell[2] + CellBias);
+        }
+        aabb_type to_aabb(cell_key aKey) const
+        {
+            auto const coordinate = [&](uint32_t aShift)
+            {
+                return static_cast<scalar>(static_cast<int32_t>((aKey >> aShift) & ((1u << 21) - 1u)) - CellBias) * iCellSize;
+            };
+            if constexpr (Is2d)
+                return aabb_type{ point_type{ coordinate(42), coordinate(21) }, point_type{ coordinate(42) + iCellSize, coordinate(21) + iCellSize } };
+            else
+                return aabb_type{ point_type{ coordinate(42), coordinate(21), coordinate(0) }, point_type{ coordinate(42) + iCellSize, coordinate(21) + iCellSize, coordinate(0) + iCellSize } };
+        }
+    private:
+        i_ecs& iEcs;
+        scalar iCellSize;
+        std::vector<entry> iEntries;
+        std::vector<cell_entry> iCells;
+        std::vector<uint32_t> iOversized;
+    };
+}
\ No newline at end of file
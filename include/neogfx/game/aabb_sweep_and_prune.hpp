@@ -0,0 +1,149 @@
+// aabb_sweep_and_prune.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <neogfx/core/numerical.hpp>
+#include <neogfx/game/i_ecs.hpp>
+#include <neogfx/game/entity_info.hpp>
+
+namespace neogfx::game
+{
+    // Sort-and-sweep broadphase over a contiguous array of collider AABBs kept sorted on the x axis; the
+    // previous cycle's order is retained so that coherent motion re-sorts in close to linear time.
+    template <typename Collider>
+    class aabb_sweep_and_prune
+    {
+    public:
+        typedef Collider collider_type;
+        typedef typename std::remove_cvref_t<decltype(std::declval<collider_type>().currentAabb)>::value_type aabb_type;
+        typedef std::remove_cvref_t<decltype(std::declval<aabb_type>().min)> point_type;
+    private:
+        struct entry
+        {
+            aabb_type aabb;
+            uint64_t mask;
+            entity_id entity;
+        };
+    public:
+        aabb_sweep_and_prune(i_ecs& aEcs) :
+            iEcs{ aEcs },
+            iGeneration{ 0 }
+        {
+        }
+    public:
+        void full_update()
+        {
+            if (++iGeneration == 0)
+                iGeneration = 1;
+            auto const& infos = iEcs.component<entity_info>();
+            auto const& colliders = iEcs.component<collider_type>();
+            auto const live = [&](entity_id aEntity)
+            {
+                return colliders.has_entity_record(aEntity) &&
+                    colliders.entity_record(aEntity).currentAabb &&
+                    !infos.entity_record(aEntity).destroyed;
+            };
+            auto next = iEntries.begin();
+            for (auto& existing : iEntries)
+            {
+                if (!live(existing.entity))
+                {
+                    iKnown.erase(existing.entity);
+                    continue;
+                }
+                auto const& collider = colliders.entity_record(existing.entity);
+                existing.aabb = *collider.currentAabb;
+                existing.mask = collider.mask;
+                iKnown[existing.entity] = iGeneration;
+                *next++ = existing;
+            }
+            iEntries.erase(next, iEntries.end());
+            for (auto entity : colliders.entities())
+            {
+                auto known = iKnown.find(entity);
+                if (known != iKnown.end() && known->second == iGeneration)
+                    continue;
+                if (!live(entity))
+                    continue;
+                auto const& collider = colliders.entity_record(entity);
+                iEntries.push_back(entry{ *collider.currentAabb, collider.mask, entity });
+                iKnown[entity] = iGeneration;
+            }
+            // insertion sort: near linear when the previous order is mostly preserved
+            for (auto i = std::next(iEntries.begin(), std::min<std::size_t>(1u, iEntries.size())); i != iEntries.end(); ++i)
+            {
+                auto const value = *i;
+                auto j = i;
+                for (; j != iEntries.begin() && std::prev(j)->aabb.min.x > value.aabb.min.x; --j)
+                    *j = *std::prev(j);
+                *j = value;
+            }
+        }
+        template <typename CollisionAction>
+        void collisions(CollisionAction aCollisionAction) const
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            for (auto first = iEntries.begin(); first != iEntries.end(); ++first)
+            {
+                for (auto second = std::next(first); second != iEntries.end() && second->aabb.min.x <= first->aabb.max.x; ++second)
+                {
+                    if ((first->mask & second->mask) != 0)
+                        continue;
+                    if (!aabb_intersects(first->aabb, second->aabb))
+                        continue;
+                    if (infos.entity_record(first->entity).destroyed || infos.entity_record(second->entity).destroyed)
+                        continue;
+                    if (first->entity < second->entity)
+                        aCollisionAction(first->entity, second->entity);
+                    else
+                        aCollisionAction(second->entity, first->entity);
+                }
+            }
+        }
+        template <typename ResultContainer>
+        void pick(const point_type& aPoint, ResultContainer& aResult, std::function<bool(entity_id aMatch, const point_type& aPoint)> aColliderPredicate = [](entity_id, const point_type&) { return true; }) const
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            for (auto candidate = iEntries.begin(); candidate != iEntries.end() && candidate->aabb.min.x <= aPoint.x; ++candidate)
+                if (aabb_intersects(candidate->aabb, aabb_type{ aPoint, aPoint }) && !infos.entity_record(candidate->entity).destroyed && aColliderPredicate(candidate->entity, aPoint))
+                    aResult.insert(aResult.end(), candidate->entity);
+        }
+        template <typename Visitor>
+        void visit_aabbs(const Visitor& aVisitor) const
+        {
+            for (auto const& e : iEntries)
+                aVisitor(e.aabb);
+        }
+    public:
+        uint32_t count() const
+        {
+            return static_cast<uint32_t>(iEntries.size());
+        }
+    private:
+        i_ecs& iEcs;
+        std::vector<entry> iEntries;
+        std::unordered_map<entity_id, uint32_t> iKnown;
+        uint32_t iGeneration;
+    };
+}
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include <neogfx/game/animation_filter.hpp>
 #include <neogfx/game/mesh_renderer.hpp>
 #include <neogfx/game/mesh_render_cache.hpp>
+#include <neogfx/game/live_entity_view.hpp>
 
 namespace neogfx::game
 {
@@ -59,5 +60,6 @@ namespace neogfx::game
         };
     private:
         scoped_component_lock<entity_info, mesh_render_cache, animation_filter> iLock;
+        live_entity_view<animation_filter> iLiveFilters;
     };
 }   
\ No newline at end of file
@@ -0,0 +1,229 @@
+// barnes_hut_tree.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <vector>
+#include <array>
+#include <numeric>
+#include <algorithm>
+#include <neogfx/core/numerical.hpp>
+
+namespace neogfx::game
+{
+    // Octree of point masses used to approximate universal gravitation in O(n log n); a node whose
+    // extent subtends less than theta as seen from the sample point is treated as a single mass.
+    class barnes_hut_tree
+    {
+    public:
+        static constexpr std::size_t LeafSize = 8u;
+        static constexpr uint32_t MaximumDepth = 32u;
+    private:
+        static constexpr uint32_t NoChild = ~0u;
+        struct node
+        {
+            scalar centerOfMassX;
+            scalar centerOfMassY;
+            scalar centerOfMassZ;
+            scalar mass;
+            scalar size;
+            uint32_t first;
+            uint32_t last;
+            std::array<uint32_t, 8> children;
+        };
+    public:
+        barnes_hut_tree(scalar aTheta = 0.5) :
+            iTheta{ aTheta }
+        {
+        }
+    public:
+        scalar theta() const
+        {
+            return iTheta;
+        }
+        void set_theta(scalar aTheta)
+        {
+            iTheta = aTheta;
+        }
+        std::size_t node_count() const
+        {
+            return iNodes.size();
+        }
+    public:
+        void build(const scalar* aX, const scalar* aY, const scalar* aZ, const scalar* aMass, std::size_t aCount)
+        {
+            iNodes.clear();
+            iIndices.resize(aCount);
+            std::iota(iIndices.begin(), iIndices.end(), 0u);
+            if (aCount == 0)
+                return;
+            scalar minX = aX[0], minY = aY[0], minZ = aZ[0];
+            scalar maxX = aX[0], maxY = aY[0], maxZ = aZ[0];
+            for (std::size_t i = 1; i < aCount; ++i)
+            {
+                minX = std::min(minX, aX[i]); maxX = std::max(maxX, aX[i]);
+                minY = std::min(minY, aY[i]); maxY = std::max(maxY, aY[i]);
+                minZ = std::min(minZ, aZ[i]); maxZ = std::max(maxZ, aZ[i]);
+            }
+            scalar const size = std::max({ maxX - minX, maxY - minY, maxZ - minZ });
+            build_node(aX, aY, aZ, aMass, 0u, static_cast<uint32_t>(aCount), minX, minY, minZ, size, 0u);
+            // store bodies in leaf order so that leaf traversal is contiguous
+            iX.resize(aCount);
+            iY.resize(aCount);
+            iZ.resize(aCount);
+            iMass.resize(aCount);
+            for (std::size_t i = 0; i < aCount; ++i)
+            {
+                auto const index = iIndices[i];
+                iX[i] = aX[index];
+                iY[i] = aY[index];
+                iZ[i] = aZ[index];
+                iMass[i] = aMass[index];
+            }
+        }
+        // Returns the sum of m * d / |d|^3 over all masses where d is the displacement from each mass to the sample point.
+        vec3 field(scalar aX, scalar aY, scalar aZ) const
+        {
+            scalar fieldX = 0.0, fieldY = 0.0, fieldZ = 0.0;
+            if (iNodes.empty())
+                return vec3{};
+            scalar const theta2 = iTheta * iTheta;
+            std::array<uint32_t, 8u * MaximumDepth + 1u> stack;
+            std::size_t top = 0u;
+            stack[top++] = 0u;
+            while (top != 0u)
+            {
+                auto const& n = iNodes[stack[--top]];
+                bool const leaf = (n.children == empty_children());
+                if (!leaf)
+                {
+                    scalar const dx = aX - n.centerOfMassX;
+                    scalar const dy = aY - n.centerOfMassY;
+                    scalar const dz = aZ - n.centerOfMassZ;
+                    scalar const r2 = dx * dx + dy * dy + dz * dz;
+                    if (n.size * n.size < theta2 * r2)
+                    {
+                        scalar const k = n.mass / (r2 * std::sqrt(r2));
+                        fieldX += dx * k;
+                        fieldY += dy * k;
+                        fieldZ += dz * k;
+                    }
+                    else
+                    {
+                        for (auto child : n.children)
+                            if (child != NoChild)
+                                stack[top++] = child;
+                    }
+                    continue;
+                }
+                for (uint32_t i = n.first; i < n.last; ++i)
+                {
+                    scalar const dx = aX - iX[i];
+                    scalar const dy = aY - iY[i];
+                    scalar const dz = aZ - iZ[i];
+                    scalar const r2 = dx * dx + dy * dy + dz * dz;
+                    if (r2 > 0.0) // avoid division by zero or sample point coinciding with a mass
+                    {
+                        scalar const k = iMass[i] / (r2 * std::sqrt(r2));
+                        fieldX += dx * k;
+                        fieldY += dy * k;
+                        fieldZ += dz * k;
+                    }
+                }
+            }
+            return vec3{ fieldX, fieldY, fieldZ };
+        }
+    private:
+        static const std::array<uint32_t, 8>& empty_children()
+        {
+            static const std::array<uint32_t, 8> sEmpty = { NoChild, NoChild, NoChild, NoChild, NoChild, NoChild, NoChild, NoChild };
+            return sEmpty;
+        }
+        uint32_t build_node(const scalar* aX, const scalar* aY, const scalar* aZ, const scalar* aMass, uint32_t aFirst, uint32_t aLast,
+            scalar aMinX, scalar aMinY, scalar aMinZ, scalar aSize, uint32_t aDepth)
+        {
+            auto const nodeIndex = static_cast<uint32_t>(iNodes.size());
+            iNodes.push_back(node{ 0.0, 0.0, 0.0, 0.0, aSize, aFirst, aLast, empty_children() });
+            if (aLast - aFirst <= LeafSize || aDepth >= MaximumDepth)
+            {
+                scalar mass = 0.0, momentX = 0.0, momentY = 0.0, momentZ = 0.0;
+                for (auto i = aFirst; i < aLast; ++i)
+                {
+                    auto const index = iIndices[i];
+                    mass += aMass[index];
+                    momentX += aMass[index] * aX[index];
+                    momentY += aMass[index] * aY[index];
+                    momentZ += aMass[index] * aZ[index];
+                }
+                set_mass(iNodes[nodeIndex], mass, momentX, momentY, momentZ);
+                return nodeIndex;
+            }
+            scalar const half = aSize / 2.0;
+            scalar const centerX = aMinX + half;
+            scalar const centerY = aMinY + half;
+            scalar const centerZ = aMinZ + half;
+            auto const begin = iIndices.begin();
+            std::array<uint32_t, 9> bounds;
+            bounds[0] = aFirst;
+            bounds[8] = aLast;
+            bounds[4] = static_cast<uint32_t>(std::partition(begin + aFirst, begin + aLast, [&](uint32_t i) { return aX[i] < centerX; }) - begin);
+            bounds[2] = static_cast<uint32_t>(std::partition(begin + bounds[0], begin + bounds[4], [&](uint32_t i) { return aY[i] < centerY; }) - begin);
+            bounds[6] = static_cast<uint32_t>(std::partition(begin + bounds[4], begin + bounds[8], [&](uint32_t i) { return aY[i] < centerY; }) - begin);
+            bounds[1] = static_cast<uint32_t>(std::partition(begin + bounds[0], begin + bounds[2], [&](uint32_t i) { return aZ[i] < centerZ; }) - begin);
+            bounds[3] = static_cast<uint32_t>(std::partition(begin + bounds[2], begin + bounds[4], [&](uint32_t i) { return aZ[i] < centerZ; }) - begin);
+            bounds[5] = static_cast<uint32_t>(std::partition(begin + bounds[4], begin + bounds[6], [&](uint32_t i) { return aZ[i] < centerZ; }) - begin);
+            bounds[7] = static_cast<uint32_t>(std::partition(begin + bounds[6], begin + bounds[8], [&](uint32_t i) { return aZ[i] < centerZ; }) - begin);
+            scalar mass = 0.0, momentX = 0.0, momentY = 0.0, momentZ = 0.0;
+            for (uint32_t octant = 0u; octant < 8u; ++octant)
+            {
+                if (bounds[octant] == bounds[octant + 1u])
+                    continue;
+                auto const child = build_node(aX, aY, aZ, aMass, bounds[octant], bounds[octant + 1u],
+                    (octant & 4u) ? centerX : aMinX, (octant & 2u) ? centerY : aMinY, (octant & 1u) ? centerZ : aMinZ, half, aDepth + 1u);
+                iNodes[nodeIndex].children[octant] = child;
+                auto const& childNode = iNodes[child];
+                mass += childNode.mass;
+                momentX += childNode.mass * childNode.centerOfMassX;
+                momentY += childNode.mass * childNode.centerOfMassY;
+                momentZ += childNode.mass * childNode.centerOfMassZ;
+            }
+            set_mass(iNodes[nodeIndex], mass, momentX, momentY, momentZ);
+            return nodeIndex;
+        }
+        static void set_mass(node& aNode, scalar aMass, scalar aMomentX, scalar aMomentY, scalar aMomentZ)
+        {
+            aNode.mass = aMass;
+            if (aMass != 0.0)
+            {
+                aNode.centerOfMassX = aMomentX / aMass;
+                aNode.centerOfMassY = aMomentY / aMass;
+                aNode.centerOfMassZ = aMomentZ / aMass;
+            }
+        }
+    private:
+        scalar iTheta;
+        std::vector<node> iNodes;
+        std::vector<uint32_t> iIndices;
+        std::vector<scalar> iX;
+        std::vector<scalar> iY;
+        std::vector<scalar> iZ;
+        std::vector<scalar> iMass;
+    };
+}
\ No newline at end of file
@@ -23,7 +23,11 @@
 #include <neogfx/game/system.hpp>
 #include <neogfx/game/aabb_quadtree.hpp>
 #include <neogfx/game/aabb_octree.hpp>
+#include <neogfx/game/aabb_spatial_hash.hpp>
+#include <neogfx/game/aabb_sweep_and_prune.hpp>
 #include <neogfx/game/box_collider.hpp>
+#include <neogfx/game/mesh_filter.hpp>
+#include <neogfx/game/live_entity_view.hpp>
 
 namespace neogfx::game
 {
@@ -50,6 +54,19 @@ namespace neogfx::game
         return static_cast<collision_detection_cycle>(static_cast<uint32_t>(aLhs) & static_cast<uint32_t>(aRhs));
     }
 
+    enum class broadphase_update_mode : uint32_t
+    {
+        Full,           // rebuild broadphase trees every cycle
+        Incremental     // only reinsert colliders that have left their tree node
+    };
+
+    enum class broadphase_strategy : uint32_t
+    {
+        Tree,           // aabb_octree/aabb_quadtree
+        SpatialHash,    // aabb_spatial_hash
+        SweepAndPrune   // aabb_sweep_and_prune
+    };
+
     class collision_detector : public game::system<entity_info, box_collider, box_collider_2d>
     {
     public:
@@ -69,13 +86,42 @@ namespace neogfx::game
         template <typename Visitor>
         void visit_aabbs(const Visitor& aVisitor) const
         {
-            iBroadphaseTree.visit_aabbs(aVisitor);
+            switch (broadphase())
+            {
+            case broadphase_strategy::Tree:
+                iBroadphaseTree.visit_aabbs(aVisitor);
+                break;
+            case broadphase_strategy::SpatialHash:
+                iBroadphaseHash.visit_aabbs(aVisitor);
+                break;
+            case broadphase_strategy::SweepAndPrune:
+                iBroadphaseSweep.visit_aabbs(aVisitor);
+                break;
+            }
         }
         template <typename Visitor>
         void visit_aabbs_2d(const Visitor& aVisitor) const
         {
-            iBroadphase2dTree.visit_aabbs(aVisitor);
+            switch (broadphase())
+            {
+            case broadphase_strategy::Tree:
+                iBroadphase2dTree.visit_aabbs(aVisitor);
+                break;
+            case broadphase_strategy::SpatialHash:
+                iBroadphase2dHash.visit_aabbs(aVisitor);
+                break;
+            case broadphase_strategy::SweepAndPrune:
+                iBroadphase2dSweep.visit_aabbs(aVisitor);
+                break;
+            }
         }
+    public:
+        uint32_t last_collider_update_count() const;
+    public:
+        broadphase_strategy broadphase() const;
+        void set_broadphase(broadphase_strategy aStrategy);
+        broadphase_update_mode update_mode() const;
+        void set_update_mode(broadphase_update_mode aMode);
     public:
         const aabb_octree<box_collider>& broadphase_tree() const;
         const aabb_quadtree<box_collider_2d>& broadphase_2d_tree() const;
@@ -97,9 +143,42 @@ namespace neogfx::game
                 return sName;
             }
         };
+    private:
+        struct collider_inputs
+        {
+            std::optional<vec3> position;
+            scalar angle = 0.0;
+            const mesh_filter* meshFilter = nullptr;
+            std::optional<mat44> meshFilterTransformation;
+            std::optional<mat44> animationTransformation;
+            uint32_t generation = 0u;
+
+            bool same_as(const collider_inputs& aOther) const
+            {
+                return meshFilter == aOther.meshFilter &&
+                    position == aOther.position &&
+                    angle == aOther.angle &&
+                    meshFilterTransformation == aOther.meshFilterTransformation &&
+                    animationTransformation == aOther.animationTransformation;
+            }
+        };
+        typedef std::unordered_map<entity_id, collider_inputs> collider_inputs_map;
     private:
         aabb_octree<box_collider> iBroadphaseTree;
         aabb_quadtree<box_collider_2d> iBroadphase2dTree;
+        aabb_spatial_hash<box_collider> iBroadphaseHash;
+        aabb_spatial_hash<box_collider_2d> iBroadphase2dHash;
+        aabb_sweep_and_prune<box_collider> iBroadphaseSweep;
+        aabb_sweep_and_prune<box_collider_2d> iBroadphase2dSweep;
+        std::atomic<broadphase_strategy> iStrategy;
         std::atomic<bool> iCollidersUpdated;
+        live_entity_view<box_collider> iLiveColliders;
+        live_entity_view<box_collider_2d> iLiveColliders2d;
+        collider_inputs_map iColliderInputs;
+        collider_inputs_map iCollider2dInputs;
+        uint32_t iColliderGeneration;
+        uint32_t iColliderUpdateCount;
+        std::atomic<bool> iTreesUpdated;
+        std::atomic<broadphase_update_mode> iUpdateMode;
     };
 }
\ No newline at end of file
@@ -20,6 +20,9 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <deque>
+#include <mutex>
+#include <atomic>
 #include <neogfx/gfx/i_vertex_provider.hpp>
 #include <neolib/ecs/ecs.hpp>
 
@@ -32,6 +35,8 @@ namespace neogfx
         class ecs : public neolib::ecs::ecs, public i_vertex_provider
         {
             typedef neolib::ecs::ecs base_type;
+        public:
+            static constexpr std::size_t DestructionJournalCapacity = 65536u;
         public:
             ecs(ecs_flags aCreationFlags = ecs_flags::Default);
             ~ecs();
@@ -39,10 +44,26 @@ namespace neogfx
             bool run_threaded(const system_id& aSystemId) const override;
         public:
             void destroy_entity(entity_id aEntityId, bool aNotify = true) override;
+        public:
+            uint64_t destruction_sequence() const;
+            bool destroyed_entities(uint64_t& aCursor, std::vector<entity_id>& aDestroyed) const;
+            uint64_t reorder_sequence() const;
+            void component_reordered();
         public:
             bool cacheable() const override;
             const game::component<game::mesh_render_cache>& cache() const override;
             game::component<game::mesh_render_cache>& cache() override;
+            const game::mesh_render_index& render_index() const override;
+            game::mesh_render_index& render_index() override;
+            const entity_culling_statistics& culling_statistics() const override;
+            entity_culling_statistics& culling_statistics() override;
+        private:
+            mutable std::mutex iDestructionJournalMutex;
+            std::deque<entity_id> iDestructionJournal;
+            std::atomic<uint64_t> iDestructionSequence;
+            std::atomic<uint64_t> iReorderSequence;
+            game::mesh_render_index iRenderIndex;
+            entity_culling_statistics iCullingStatistics = {};
         };
 
         template <typename... Systems>
@@ -0,0 +1,168 @@
+// live_entity_view.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <vector>
+#include <neogfx/game/ecs.hpp>
+#include <neogfx/game/entity_info.hpp>
+
+namespace neogfx::game
+{
+    // Compacted list of the records of a component whose entities have not been destroyed, kept in component
+    // order alongside a liveness bitmap. Destructions are replayed from the game::ecs destruction journal and
+    // appended records are picked up incrementally. The component's storage (neolib::ecs) does not publish
+    // reorders, so the existing records are checked against a snapshot of their entities on every refresh and
+    // any sort, swap or purge forces a rebuild.
+    template <typename Data>
+    class live_entity_view
+    {
+    public:
+        typedef Data data_type;
+        struct live_record
+        {
+            uint32_t index;
+            entity_id entity;
+        };
+        typedef typename std::vector<live_record>::const_iterator const_iterator;
+    public:
+        live_entity_view(i_ecs& aEcs) :
+            iEcs{ aEcs },
+            iJournal{ dynamic_cast<const game::ecs*>(&aEcs) },
+            iCursor{ 0u },
+            iReorderCursor{ 0u },
+            iComponentSize{ 0u },
+            iValid{ false }
+        {
+        }
+    public:
+        // The caller must hold the locks of entity_info and the viewed component.
+        void refresh()
+        {
+            auto const& records = iEcs.component<data_type>();
+            auto const& data = records.component_data();
+            if (iValid && iJournal != nullptr && iJournal->reorder_sequence() == iReorderCursor && data.size() >= iComponentSize && unchanged())
+            {
+                if (data.size() != iComponentSize)
+                    append();
+                if (iJournal->destruction_sequence() == iCursor)
+                    return;
+                iDestroyed.clear();
+                if (iJournal->destroyed_entities(iCursor, iDestroyed))
+                {
+                    bool changed = false;
+                    for (auto entity : iDestroyed)
+                    {
+                        if (!records.has_entity_record_no_lock(entity))
+                            continue;
+                        auto const index = static_cast<uint32_t>(&records.entity_record_no_lock(entity) - &data[0]);
+                        if (index < iLiveness.size() && iLiveness[index])
+                        {
+                            iLiveness[index] = false;
+                            changed = true;
+                        }
+                    }
+                    if (changed)
+                        std::erase_if(iRecords, [&](const live_record& aRecord) { return !iLiveness[aRecord.index]; });
+                    return;
+                }
+            }
+            rebuild();
+        }
+        // Forces a rebuild on the next refresh; for owners that have just reordered the component.
+        void invalidate()
+        {
+            iValid = false;
+        }
+    public:
+        const_iterator begin() const
+        {
+            return iRecords.begin();
+        }
+        const_iterator end() const
+        {
+            return iRecords.end();
+        }
+        std::size_t size() const
+        {
+            return iRecords.size();
+        }
+        bool empty() const
+        {
+            return iRecords.empty();
+        }
+        bool live(uint32_t aIndex) const
+        {
+            return aIndex < iLiveness.size() && iLiveness[aIndex];
+        }
+    private:
+        bool unchanged() const
+        {
+            auto const& records = iEcs.component<data_type>();
+            auto const& data = records.component_data();
+            for (std::size_t index = 0u; index < iEntities.size(); ++index)
+                if (records.entity(data[index]) != iEntities[index])
+                    return false;
+            return true;
+        }
+        void append()
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            auto const& records = iEcs.component<data_type>();
+            auto const& data = records.component_data();
+            iLiveness.resize(data.size(), false);
+            for (auto index = static_cast<uint32_t>(iComponentSize); index < data.size(); ++index)
+            {
+                auto const entity = records.entity(data[index]);
+                iEntities.push_back(entity);
+                if (infos.entity_record(entity).destroyed)
+                    continue;
+                iLiveness[index] = true;
+                iRecords.push_back(live_record{ index, entity });
+            }
+            iComponentSize = data.size();
+        }
+        void rebuild()
+        {
+            if (iJournal != nullptr)
+            {
+                iCursor = iJournal->destruction_sequence();
+                iReorderCursor = iJournal->reorder_sequence();
+            }
+            iComponentSize = 0u;
+            iRecords.clear();
+            iEntities.clear();
+            iLiveness.clear();
+            append();
+            iValid = true;
+        }
+    private:
+        i_ecs& iEcs;
+        const game::ecs* iJournal;
+        uint64_t iCursor;
+        uint64_t iReorderCursor;
+        std::size_t iComponentSize;
+        bool iValid;
+        std::vector<live_record> iRecords;
+        std::vector<entity_id> iEntities;
+        std::vector<bool> iLiveness;
+        std::vector<entity_id> iDestroyed;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,217 @@
+// mesh_render_index.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <neogfx/core/numerical.hpp>
+#include <neogfx/game/i_ecs.hpp>
+
+namespace neogfx::game
+{
+    // Uniform grid over the x-y world bounds of rendered meshes (mesh_render_cache::bounds) so that a renderer only
+    // visits the entities overlapping its view. An entity is re-bucketed only when its bounds are updated; entities
+    // without bounds or spanning more than MaxCellsPerEntity cells are kept aside and visited by every query. Each
+    // entity keeps the ordinal it was first indexed with so that callers can restore a stable visiting order.
+    class mesh_render_index
+    {
+    public:
+        static constexpr int64_t MaxCellsPerEntity = 64;
+    private:
+        typedef uint64_t cell_key;
+        typedef std::array<int32_t, 2> cell_coordinates;
+        static constexpr int32_t CellBias = 1 << 30;
+        struct entry
+        {
+            uint64_t ordinal;
+            std::optional<aabb_2d> bounds;
+            bool bucketed;
+        };
+        struct cell_entry
+        {
+            entity_id entity;
+            uint64_t ordinal;
+            aabb_2d bounds;
+        };
+    public:
+        mesh_render_index(scalar aCellSize = 256.0) :
+            iCellSize{ aCellSize }
+        {
+        }
+    public:
+        scalar cell_size() const
+        {
+            return iCellSize;
+        }
+        std::size_t count() const
+        {
+            return iEntries.size();
+        }
+        // number of source records (e.g. mesh renderers) the index was last built from
+        std::size_t source_count() const
+        {
+            return iSourceCount;
+        }
+        void set_source_count(std::size_t aSourceCount)
+        {
+            iSourceCount = aSourceCount;
+        }
+        void clear()
+        {
+            iEntries.clear();
+            iCells.clear();
+            iUnbucketed.clear();
+            iSourceCount = 0u;
+        }
+        void update(entity_id aEntity, std::optional<aabb> const& aBounds)
+        {
+            std::optional<aabb_2d> bounds;
+            if (aBounds)
+                bounds = aabb_2d{ aBounds->min.xy, aBounds->max.xy };
+            auto existing = iEntries.find(aEntity);
+            if (existing != iEntries.end())
+                unlink(aEntity, existing->second);
+            else
+                existing = iEntries.emplace(aEntity, entry{ iNextOrdinal++ }).first;
+            existing->second.bounds = bounds;
+            link(aEntity, existing->second);
+        }
+        void remove(entity_id aEntity)
+        {
+            auto existing = iEntries.find(aEntity);
+            if (existing == iEntries.end())
+                return;
+            unlink(aEntity, existing->second);
+            iEntries.erase(existing);
+        }
+        template <typename Visitor>
+        void query(aabb_2d const& aView, Visitor aVisitor) const
+        {
+            // an entity in several cells is only reported by the cell containing the minimum corner of its overlap
+            // with the view
+            auto const visit_cell = [&](cell_key aKey, std::vector<cell_entry> const& aCell)
+            {
+                for (auto const& e : aCell)
+                    if (aabb_intersects(e.bounds, aView) && to_key(to_cell(e.bounds.min.max(aView.min))) == aKey)
+                        aVisitor(e.entity, e.ordinal);
+            };
+            auto const first = to_cell(aView.min);
+            auto const last = to_cell(aView.max);
+            auto const viewCells = (static_cast<int64_t>(last[0]) - first[0] + 1) * (static_cast<int64_t>(last[1]) - first[1] + 1);
+            if (viewCells > static_cast<int64_t>(iCells.size()))
+            {
+                for (auto const& cell : iCells)
+                    visit_cell(cell.first, cell.second);
+            }
+            else
+            {
+                for (auto x = first[0]; x <= last[0]; ++x)
+                    for (auto y = first[1]; y <= last[1]; ++y)
+                    {
+                        auto const key = to_key(cell_coordinates{ x, y });
+                        auto const cell = iCells.find(key);
+                        if (cell != iCells.end())
+                            visit_cell(key, cell->second);
+                    }
+            }
+            for (auto entity : iUnbucketed)
+            {
+                auto const& e = iEntries.find(entity)->second;
+                if (!e.bounds || aabb_intersects(*e.bounds, aView))
+                    aVisitor(entity, e.ordinal);
+            }
+        }
+    private:
+        void link(entity_id aEntity, entry& aEntry)
+        {
+            aEntry.bucketed = false;
+            if (aEntry.bounds)
+            {
+                auto const first = to_cell(aEntry.bounds->min);
+                auto const last = to_cell(aEntry.bounds->max);
+                auto const cellCount = (static_cast<int64_t>(last[0]) - first[0] + 1) * (static_cast<int64_t>(last[1]) - first[1] + 1);
+                aEntry.bucketed = (cellCount <= MaxCellsPerEntity);
+            }
+            if (!aEntry.bucketed)
+            {
+                iUnbucketed.push_back(aEntity);
+                return;
+            }
+            auto const first = to_cell(aEntry.bounds->min);
+            auto const last = to_cell(aEntry.bounds->max);
+            for (auto x = first[0]; x <= last[0]; ++x)
+                for (auto y = first[1]; y <= last[1]; ++y)
+                    iCells[to_key(cell_coordinates{ x, y })].push_back(cell_entry{ aEntity, aEntry.ordinal, *aEntry.bounds });
+        }
+        void unlink(entity_id aEntity, entry const& aEntry)
+        {
+            if (!aEntry.bucketed)
+            {
+                auto existing = std::find(iUnbucketed.begin(), iUnbucketed.end(), aEntity);
+                if (existing != iUnbucketed.end())
+                {
+                    *existing = iUnbucketed.back();
+                    iUnbucketed.pop_back();
+                }
+                return;
+            }
+            auto const first = to_cell(aEntry.bounds->min);
+            auto const last = to_cell(aEntry.bounds->max);
+            for (auto x = first[0]; x <= last[0]; ++x)
+                for (auto y = first[1]; y <= last[1]; ++y)
+                {
+                    auto cell = iCells.find(to_key(cell_coordinates{ x, y }));
+                    if (cell == iCells.end())
+                        continue;
+                    auto& entities = cell->second;
+                    auto existing = std::find_if(entities.begin(), entities.end(), [aEntity](cell_entry const& e) { return e.entity == aEntity; });
+                    if (existing != entities.end())
+                    {
+                        *existing = entities.back();
+                        entities.pop_back();
+                    }
+                    if (entities.empty())
+                        iCells.erase(cell);
+                }
+        }
+        cell_coordinates to_cell(vec2 const& aPoint) const
+        {
+            auto const coordinate = [&](scalar aValue)
+            {
+                return static_cast<int32_t>(std::clamp(std::floor(aValue / iCellSize), static_cast<scalar>(-CellBias + 1), static_cast<scalar>(CellBias - 1)));
+            };
+            return cell_coordinates{ coordinate(aPoint.x), coordinate(aPoint.y) };
+        }
+        static cell_key to_key(cell_coordinates const& aCell)
+        {
+            return (static_cast<cell_key>(aCell[0] + CellBias) << 32) | static_cast<cell_key>(aCell[1] + CellBias);
+        }
+    private:
+        scalar iCellSize;
+        std::unordered_map<entity_id, entry> iEntries;
+        std::unordered_map<cell_key, std::vector<cell_entry>> iCells;
+        std::vector<entity_id> iUnbucketed;
+        uint64_t iNextOrdinal = 0u;
+        std::size_t iSourceCount = 0u;
+    };
+}
\ No newline at end of file
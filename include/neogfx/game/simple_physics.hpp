@@ -25,6 +25,7 @@
 #include <neogfx/game/mesh_filter.hpp>
 #include <neogfx/game/rigid_body.hpp>
 #include <neogfx/game/mesh_render_cache.hpp>
+#include <neogfx/game/live_entity_view.hpp>
 
 namespace neogfx::game
 {
@@ -42,8 +43,16 @@ namespace neogfx::game
         bool universal_gravitation_enabled() const;
         void enable_universal_gravitation();
         void disable_universal_gravitation();
+        bool parallel_integration_enabled() const;
+        void enable_parallel_integration();
+        void disable_parallel_integration();
+        bool barnes_hut_enabled() const;
+        void enable_barnes_hut(scalar aTheta = 0.5);
+        void disable_barnes_hut();
     public:
         void yield_after(std::chrono::duration<double, std::milli> aTime);
+    private:
+        void integrate_parallel(scalar aElapsedTime, const vec3& aUniformGravity, scalar aGravitationalConstant);
     public:
         struct meta
         {
@@ -58,7 +67,13 @@ namespace neogfx::game
                 return sName;
             }
         };
+    private:
+        struct integration_data;
     private:
         std::chrono::duration<double, std::milli> iYieldTime = std::chrono::duration<double, std::milli>{ 1.0 };
+        bool iParallelIntegration = false;
+        std::optional<scalar> iBarnesHutTheta;
+        live_entity_view<rigid_body> iLiveRigidBodies;
+        std::unique_ptr<integration_data> iIntegrationData;
     };
 }
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include <neogfx/neogfx.hpp>
 #include <neogfx/gfx/primitives.hpp>
 #include <neogfx/gfx/i_graphics_context.hpp>
+#include <neogfx/gfx/text/i_font_manager.hpp>
 #include <neogfx/game/component.hpp>
 #include <neogfx/game/entity.hpp>
 #include <neogfx/game/renderable_entity_archetype.hpp>
@@ -45,6 +46,7 @@ namespace neogfx::game
         text_effect_type textEffect;
         material textEffectMaterial;
         scalar textEffectWidth;
+        mutable std::shared_ptr<glyph_pins> glyphPins; // not a field: keeps the glyphs baked into the mesh resident
 
         struct meta : i_component_data::meta
         {
@@ -139,6 +141,7 @@ namespace neogfx::game
                     aEcs.component<mesh_renderer>().populate(aEntity, mesh_renderer{});
                 mf.mesh = mesh{};
                 mr.patches = patches{};
+                auto glyphPins = std::make_shared<neogfx::glyph_pins>();
                 auto multilineGlyphText = aGc.to_multiline_glyph_text(aData.text, service<i_font_manager>().font_from_id(aData.font.ptr->id.cookie()), aData.extents.x, aData.alignment);
                 for (auto const& line : multilineGlyphText.lines)
                 {
@@ -151,6 +154,7 @@ namespace neogfx::game
                             if (!is_whitespace(glyphChar))
                             {
                                 auto const& glyphTexture = multilineGlyphText.glyphText.glyph(glyphChar);
+                                glyphPins->pin(glyphTexture);
                                 add_patch(*mf.mesh, mr, pos + vec3{ glyphChar.cell[0] } + quad{ glyphChar.shape[0], glyphChar.shape[1], glyphChar.shape[2], glyphChar.shape[3] }, glyphTexture.texture());
                                 mr.patches.back().material = material{ aMaterial.color, aMaterial.gradient, aMaterial.sharedTexture, mr.patches.back().material.texture, aMaterial.shaderEffect };
                             }
@@ -169,6 +173,7 @@ namespace neogfx::game
                     }
                     mesh_line(vec2{}, aData.ink);
                 }
+                aData.glyphPins = glyphPins;
             }
         };
     };
@@ -25,6 +25,19 @@
 
 namespace neogfx
 {
+    struct texture_atlas_statistics
+    {
+        uint32_t pages;
+        uint32_t subTextures;
+        uint32_t freeRects;
+        dimension totalArea;
+        dimension usedArea;
+        dimension freeArea;
+        dimension largestFreeArea;
+        double occupancy;       // used area / total area
+        double fragmentation;   // 1 - sum of each page's largest free rectangle / free area
+    };
+
     class i_texture_atlas
     {
     public:
@@ -39,5 +52,8 @@ namespace neogfx
         virtual i_sub_texture& create_sub_texture(const i_image& aImage) = 0;
         virtual i_sub_texture& create_sub_texture(const i_image& aImage, const rect& aImagePart) = 0;
         virtual void destroy_sub_texture(i_sub_texture& aSubTexture) = 0;
+    public:
+        virtual texture_atlas_statistics statistics() const = 0;
+        virtual void compact() = 0;
     };
 }
\ No newline at end of file
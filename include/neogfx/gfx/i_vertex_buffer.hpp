@@ -117,6 +117,8 @@ namespace neogfx
         virtual void attach_shader(i_rendering_context& aContext, i_shader_program& aShaderProgram) = 0;
         virtual void detach_shader() = 0;
     public:
+        // vertex indices handed out before the buffer was last emptied belong to an earlier generation
+        virtual uint32_t generation() const = 0;
         virtual void reclaim(std::size_t aStartIndex, std::size_t aEndIndex) = 0;
     };
 }
\ No newline at end of file
@@ -21,9 +21,17 @@
 
 #include <neogfx/neogfx.hpp>
 #include <neogfx/game/mesh_render_cache.hpp>
+#include <neogfx/game/mesh_render_index.hpp>
 
 namespace neogfx
 {
+    // Entities gathered for drawing in the last frame and those skipped as lying outside the render target.
+    struct entity_culling_statistics
+    {
+        uint32_t drawn;
+        uint32_t culled;
+    };
+
     class i_vertex_provider
     {
     public:
@@ -34,5 +42,9 @@ namespace neogfx
         virtual bool cacheable() const = 0;
         virtual const game::component<game::mesh_render_cache>& cache() const = 0;
         virtual game::component<game::mesh_render_cache>& cache() = 0;
+        virtual const game::mesh_render_index& render_index() const = 0;
+        virtual game::mesh_render_index& render_index() = 0;
+        virtual const entity_culling_statistics& culling_statistics() const = 0;
+        virtual entity_culling_statistics& culling_statistics() = 0;
     };
 }
\ No newline at end of file
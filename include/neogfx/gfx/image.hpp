@@ -23,21 +23,36 @@
 #include <vector>
 #include <unordered_map>
 #include <optional>
+#include <memory>
+#include <atomic>
+#include <neolib/task/timer.hpp>
 #include <neogfx/core/event.hpp>
 #include <neogfx/gfx/i_image.hpp>
 
 namespace neogfx
 {
+    struct image_decode_options
+    {
+        // The size the image will be displayed at: JPEGs are decoded at the smallest DCT scale (n/8) that is
+        // no smaller than this so that thumbnails never allocate a full resolution buffer; other formats are
+        // decoded at full resolution.
+        optional_size targetExtents;
+        // Decode on a worker thread; Decoded is triggered when the pixels are ready.
+        bool background = false;
+    };
+
     class image : public reference_counted<i_image>
     {
     public:
         define_declared_event(Downloaded, downloaded)
         define_declared_event(FailedToDownload, failed_to_download)
+        define_event(Decoded, decoded)
     public:
         enum image_type_e
         {
             UnknownImage,
-            PngImage
+            PngImage,
+            JpegImage
         };
     public:
         typedef neolib::vector<uint8_t> data_type;
@@ -45,10 +60,28 @@ namespace neogfx
     private:
         struct error_parsing_image_pattern : std::logic_error { error_parsing_image_pattern() : std::logic_error("neogfx::image::error_parsing_image_pattern") {} };
         struct no_resource : std::logic_error { no_resource() : std::logic_error("neogfx::image::no_resource") {} };
+        class jpeg_decoder;
+        struct decode_result
+        {
+            data_type pixels;
+            neogfx::size extents;
+            std::optional<string> error;
+        };
+        // State shared by a detached background decode and the images waiting for it (an image copied mid-decode
+        // waits too); the worker holds its own reference to the resource so that an image can go away at any time.
+        struct background_decode
+        {
+            ref_ptr<i_resource> resource;
+            std::atomic<bool> cancelled = false;
+            std::atomic<bool> finished = false;
+            decode_result result;
+            uint32_t waiting = 1u; // GUI thread only
+        };
     public:
         image(dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(const neogfx::size& aSize, const color& aColor = color::Black, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(std::string const& aUri, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
+        image(std::string const& aUri, image_decode_options const& aDecodeOptions, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(std::string const& aImagePattern, const std::unordered_map<std::string, color>& aColorMap, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(std::string const& aUri, std::string const& aImagePattern, const std::unordered_map<std::string, color>& aColorMap, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(image const& aOther);
@@ -83,12 +116,23 @@ namespace neogfx
         void* pixels() override;
         color get_pixel(const point& aPoint) const override;
         void set_pixel(const point& aPoint, const color& aColor) override;
+    public:
+        // True whilst a streaming or background decode is incomplete; the rows of a streaming decode that have
+        // not arrived yet are transparent.
+        bool decoding() const;
+        // Decodes as much of a downloading resource as has arrived so far; returns true once the image is complete.
+        bool decode_available();
     private:
         bool has_resource() const;
         const i_resource& resource() const;
         image_type_e recognize() const;
         bool load();
-        bool load_png();
+        void apply(decode_result&& aResult);
+        void start_background_decode_pump();
+        void watch_download();
+        static decode_result decode(image_type_e aType, const i_resource& aResource, const optional_size& aTargetExtents, std::atomic<bool> const* aCancelled = nullptr);
+        static bool decode_png(const i_resource& aResource, decode_result& aResult);
+        static bool decode_jpeg(const i_resource& aResource, const optional_size& aTargetExtents, decode_result& aResult, std::atomic<bool> const* aCancelled);
     private:
         ref_ptr<i_resource> iResource;
         string iUri;
@@ -100,5 +144,10 @@ namespace neogfx
         mutable std::optional<data_type> iHash;
         texture_sampling iSampling;
         neogfx::size iSize;
+        image_decode_options iDecodeOptions;
+        std::unique_ptr<jpeg_decoder> iStreamingDecoder;
+        std::shared_ptr<background_decode> iBackgroundDecode;
+        std::optional<neolib::callback_timer> iBackgroundDecodePump;
+        sink iSink;
     };
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+// max_rects_pack.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <vector>
+#include <neogfx/core/geometrical.hpp>
+
+namespace neogfx
+{
+    // Maximal rectangles bin packer supporting removal. Freed space is coalesced with neighbouring free
+    // rectangles immediately; the exact set of maximal free rectangles is recomputed from the occupied
+    // rectangles only when an insertion would otherwise fail.
+    class max_rects_pack
+    {
+    public:
+        max_rects_pack(const size& aDimensions);
+    public:
+        const size& dimensions() const;
+        bool insert(const size& aElementSize, rect& aResult);
+        void remove(const rect& aElement);
+        void rebuild();
+    public:
+        bool empty() const;
+        std::size_t used_count() const;
+        std::size_t free_count() const;
+        dimension used_area() const;
+        dimension free_area() const;
+        dimension largest_free_area() const;
+    private:
+        bool find_position(const size& aElementSize, rect& aResult) const;
+        void place(const rect& aElement);
+        void split(const rect& aUsed);
+        void prune(std::size_t aFirstNew);
+    private:
+        size iDimensions;
+        std::vector<rect> iUsed;
+        std::vector<rect> iFree;
+        std::vector<rect> iSplit;
+        dimension iUsedArea;
+        bool iExact;
+    };
+}
\ No newline at end of file
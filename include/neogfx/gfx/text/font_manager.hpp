@@ -24,6 +24,7 @@
 #include <set>
 #include <neolib/core/jar.hpp>
 #include <neolib/core/string_ci.hpp>
+#include <neolib/task/timer.hpp>
 #include <neogfx/gfx/texture_atlas.hpp>
 #include <neogfx/gfx/text/emoji_atlas.hpp>
 #include <neogfx/gfx/text/i_font_manager.hpp>
@@ -33,6 +34,8 @@ typedef struct FT_LibraryRec_* FT_Library;
 namespace neogfx
 {
     class native_font;
+    class native_font_face;
+    class glyph_rasteriser;
 
     class fallback_font_info : public i_fallback_font_info
     {
@@ -54,6 +57,16 @@ namespace neogfx
         typedef font id_cache_entry;
         typedef neolib::small_jar<id_cache_entry> id_cache;
         friend neolib::small_cookie item_cookie(const id_cache_entry&);
+        struct cached_glyph
+        {
+            native_font_face* face;
+            uint32_t glyph;
+            texture_id texture;
+            uint64_t bytes;
+            uint64_t lastUsedFrame;
+            bool referenced;
+        };
+        typedef std::list<cached_glyph> glyph_cache;
     public:
         struct error_initializing_font_library : std::runtime_error { error_initializing_font_library() : std::runtime_error("neogfx::font_manager::error_initializing_font_library") {} };
         struct no_matching_font_found : std::runtime_error { no_matching_font_found() : std::runtime_error("neogfx::font_manager::no_matching_font_found") {} };
@@ -97,6 +110,21 @@ namespace neogfx
         i_texture_atlas& glyph_atlas() override;
         const i_emoji_atlas& emoji_atlas() const override;
         i_emoji_atlas& emoji_atlas() override;
+    public:
+        uint64_t glyph_cache_budget() const override;
+        void set_glyph_cache_budget(uint64_t aBytes) override;
+        neogfx::glyph_cache_statistics glyph_cache_statistics() const override;
+        void end_glyph_cache_frame() override;
+        void pin_glyph(texture_id aGlyphTexture) override;
+        void unpin_glyph(texture_id aGlyphTexture) override;
+    public:
+        bool async_glyph_rasterisation_enabled() const override;
+        void enable_async_glyph_rasterisation(uint32_t aThreadCount) override;
+        void disable_async_glyph_rasterisation() override;
+        neogfx::glyph_placeholder_policy glyph_placeholder_policy() const override;
+        void set_glyph_placeholder_policy(neogfx::glyph_placeholder_policy aPolicy) override;
+        void prefetch_glyphs(font const& aFont, char32_t aFirst, char32_t aLast) override;
+        uint64_t pending_glyph_count() const override;
     protected:
         void add_ref(font_id aId) override;
         void release(font_id aId) override;
@@ -107,6 +135,15 @@ namespace neogfx
     private:
         i_native_font_face& add_font(const ref_ptr<i_native_font_face>& aNewFont);
         void cleanup();
+    private:
+        glyph_cache::iterator glyph_cached(native_font_face& aFace, uint32_t aGlyph, texture_id aTexture, uint64_t aBytes);
+        void glyph_cache_hit(glyph_cache::iterator aEntry);
+        void glyphs_released(native_font_face& aFace);
+        void trim_glyph_cache();
+        glyph_rasteriser& rasteriser();
+        uint32_t rasteriser_generation() const;
+        void glyph_rasterisation_cancelled(native_font_face const& aFace);
+        void process_rasterised_glyphs();
     private:
         mutable std::unordered_map<system_font_role, optional<font_info>> iDefaultSystemFontInfo;
         mutable std::optional<fallback_font_info> iDefaultFallbackFontInfo;
@@ -118,5 +155,15 @@ namespace neogfx
         std::unique_ptr<i_glyph_text_factory> iGlyphTextFactory;
         texture_atlas iGlyphAtlas;
         neogfx::emoji_atlas iEmojiAtlas;
+        glyph_cache iGlyphCache;
+        glyph_cache::iterator iGlyphCacheHand;
+        uint64_t iGlyphCacheBudget;
+        uint64_t iGlyphCacheFrame;
+        neogfx::glyph_cache_statistics iGlyphCacheStatistics;
+        std::unordered_map<texture_id, uint32_t> iPinnedGlyphs;
+        std::unique_ptr<glyph_rasteriser> iGlyphRasteriser;
+        uint32_t iGlyphRasteriserGeneration;
+        neogfx::glyph_placeholder_policy iGlyphPlaceholderPolicy;
+        std::optional<neolib::callback_timer> iGlyphRasteriserPump;
     };
 }
\ No newline at end of file
@@ -551,6 +551,16 @@ namespace neogfx
         function_type iSelectorFunction;
     };
     
+    struct glyph_text_cache_statistics
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t entries;
+    };
+
+    // Text shaped with a single font is cached by the factory; the glyph_text returned by the single font
+    // overloads may be shared with other callers so must be cloned before it is modified.
     class i_glyph_text_factory
     {
     public:
@@ -560,7 +570,25 @@ namespace neogfx
         virtual glyph_text create_glyph_text(font const& aFont) = 0;
         virtual glyph_text to_glyph_text(i_graphics_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) = 0;
         virtual glyph_text to_glyph_text(i_graphics_context const& aContext, char const* aUtf8Begin, char const* aUtf8End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) = 0;
-    public:
+        virtual glyph_text to_glyph_text(i_graphics_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, font const& aFont, bool aAlignBaselines = true) = 0;
+        virtual glyph_text to_glyph_text(i_graphics_context const& aContext, char const* aUtf8Begin, char const* aUtf8End, font const& aFont, bool aAlignBaselines = true) = 0;
+        // For use on worker threads; returns nothing if the text needs a fallback font or emoji as these can only be
+        // created on the GUI thread. The font selector must be safe to call concurrently.
+        virtual optional_glyph_text to_glyph_text_concurrent(i_graphics_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) = 0;
+    public:
+        virtual uint32_t glyph_text_cache_capacity() const = 0;
+        virtual void set_glyph_text_cache_capacity(uint32_t aEntries) = 0;
+        virtual neogfx::glyph_text_cache_statistics glyph_text_cache_statistics() const = 0;
+        virtual void clear_glyph_text_cache() = 0;
+    public:
+        glyph_text to_glyph_text(i_graphics_context const& aContext, std::u32string_view const& aString, font const& aFont, bool aAlignBaselines = true)
+        {
+            return to_glyph_text(aContext, aString.data(), aString.data() + aString.size(), aFont, aAlignBaselines);
+        }
+        glyph_text to_glyph_text(i_graphics_context const& aContext, std::string_view const& aString, font const& aFont, bool aAlignBaselines = true)
+        {
+            return to_glyph_text(aContext, aString.data(), aString.data() + aString.size(), aFont, aAlignBaselines);
+        }
         glyph_text to_glyph_text(i_graphics_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, std::function<font(std::size_t)> aFontSelector, bool aAlignBaselines = true)
         {
             return to_glyph_text(aContext, aUtf32Begin, aUtf32End, font_selector{ aFontSelector }, aAlignBaselines);
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <unordered_set>
 #include <neolib/core/jar.hpp>
 #include <neogfx/core/geometrical.hpp>
 #include <neogfx/core/device_metrics.hpp>
@@ -43,6 +44,22 @@ namespace neogfx
         Widget
     };
 
+    enum class glyph_placeholder_policy : uint32_t
+    {
+        Synchronous,
+        Blank,
+        Invalid
+    };
+
+    struct glyph_cache_statistics
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t bytes;
+        uint64_t glyphs;
+    };
+
     class i_fallback_font_info
     {
     public:
@@ -97,6 +114,21 @@ namespace neogfx
         virtual i_texture_atlas& glyph_atlas() = 0;
         virtual const i_emoji_atlas& emoji_atlas() const = 0;
         virtual i_emoji_atlas& emoji_atlas() = 0;
+    public:
+        virtual uint64_t glyph_cache_budget() const = 0;
+        virtual void set_glyph_cache_budget(uint64_t aBytes) = 0;
+        virtual neogfx::glyph_cache_statistics glyph_cache_statistics() const = 0;
+        virtual void end_glyph_cache_frame() = 0;
+        virtual void pin_glyph(texture_id aGlyphTexture) = 0;
+        virtual void unpin_glyph(texture_id aGlyphTexture) = 0;
+    public:
+        virtual bool async_glyph_rasterisation_enabled() const = 0;
+        virtual void enable_async_glyph_rasterisation(uint32_t aThreadCount) = 0;
+        virtual void disable_async_glyph_rasterisation() = 0;
+        virtual neogfx::glyph_placeholder_policy glyph_placeholder_policy() const = 0;
+        virtual void set_glyph_placeholder_policy(neogfx::glyph_placeholder_policy aPolicy) = 0;
+        virtual void prefetch_glyphs(font const& aFont, char32_t aFirst, char32_t aLast) = 0;
+        virtual uint64_t pending_glyph_count() const = 0;
     public:
         bool has_font(std::string const& aFamily, std::string const& aStyle) const
         {
@@ -113,4 +145,33 @@ namespace neogfx
     public:
         static uuid const& iid() { static uuid const sIid{ 0x83bbaf78, 0x66a8, 0x4862, 0x9221, { 0x4c, 0xfd, 0x93, 0xfb, 0xf3, 0xe7 } }; return sIid; }
     };
+
+    // Pins the glyphs baked into retained geometry (ECS text meshes) so that the glyph cache never evicts atlas
+    // space that the geometry still samples; the pins are released when the owning geometry lets go of this.
+    class glyph_pins
+    {
+    public:
+        glyph_pins() :
+            iFontManager{ service<i_font_manager>() }
+        {
+        }
+        glyph_pins(glyph_pins const&) = delete;
+        ~glyph_pins()
+        {
+            for (auto glyphTexture : iGlyphTextures)
+                iFontManager.unpin_glyph(glyphTexture);
+        }
+    public:
+        glyph_pins& operator=(glyph_pins const&) = delete;
+    public:
+        void pin(i_glyph const& aGlyph)
+        {
+            auto const glyphTexture = aGlyph.texture().atlas_id();
+            if (iGlyphTextures.insert(glyphTexture).second)
+                iFontManager.pin_glyph(glyphTexture);
+        }
+    private:
+        i_font_manager& iFontManager;
+        std::unordered_set<texture_id> iGlyphTextures;
+    };
 }
\ No newline at end of file
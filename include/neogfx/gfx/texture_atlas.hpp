@@ -21,13 +21,11 @@
 
 #include <neogfx/neogfx.hpp>
 #include <unordered_map>
-#include <set>
-#include <tuple>
 #include "i_texture_atlas.hpp"
 #include "i_texture_manager.hpp"
 #include "texture.hpp"
 #include "sub_texture.hpp"
-#include "rect_pack.hpp"
+#include "max_rects_pack.hpp"
 
 namespace neogfx
 {
@@ -38,26 +36,14 @@ namespace neogfx
     private:
         struct fragments
         {
-            struct fragment_less_than
-            {
-                bool operator()(const rect& aLhs, const rect& aRhs) const
-                {
-                    return std::forward_as_tuple(aLhs.width() * aLhs.height(), aLhs.top_left()) <
-                        std::forward_as_tuple(aRhs.width() * aRhs.height(), aRhs.top_left());
-                }
-            };
-            rect_pack pack;
-            std::set<rect, fragment_less_than> used;
-            std::set<rect, fragment_less_than> freed; // todo: use this when bin pack is full
+            max_rects_pack pack;
             bool insert(const size& aSize, rect& aResult)
             {
-                if (pack.insert(aSize, aResult))
-                {
-                    used.insert(aResult);
-                    return true;
-                }
-                else
-                    return false;
+                return pack.insert(aSize, aResult);
+            }
+            void remove(const rect& aSpace)
+            {
+                pack.remove(aSpace);
             }
         };
         typedef std::pair<texture, fragments> page;
@@ -73,6 +59,9 @@ namespace neogfx
         i_sub_texture& create_sub_texture(const i_image& aImage) override;
         i_sub_texture& create_sub_texture(const i_image& aImage, const rect& aImagePart) override;
         void destroy_sub_texture(i_sub_texture& aSubTexture) override;
+    public:
+        texture_atlas_statistics statistics() const override;
+        void compact() override;
     private:
         const size& page_size() const;
         pages::iterator create_page(dimension aDpiScaleFactor, texture_sampling aSampling, texture_data_format aDataFormat);
@@ -0,0 +1,31 @@
+// vertex_transform.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <neogfx/core/numerical.hpp>
+
+namespace neogfx
+{
+    // Transforms aCount vertices into the single precision positions stored in vertex buffers; without a
+    // transformation the vertices are only converted. Affine transformations (the usual case) are applied a
+    // matrix column at a time using AVX or SSE2 where available.
+    void transform_vertices(optional_mat44 const& aTransformation, vec3 const* aInput, std::size_t aCount, vec3f* aOutput);
+}
\ No newline at end of file
@@ -21,6 +21,7 @@
 
 #include <neogfx/neogfx.hpp>
 #include <vector>
+#include <unordered_map>
 #include <neogfx/gui/widget/timer.hpp>
 #include <neogfx/gui/window/i_window.hpp>
 #include <neogfx/gui/layout/i_async_layout.hpp>
@@ -35,10 +36,11 @@ namespace neogfx
             destroyed_flag destroyed;
             i_widget* widget;
             bool validated;
+            uint32_t depth;
             std::optional<pause_rendering> pauseRendering;
 
             entry(destroyed_flag&& destroyed, i_widget* widget) :
-                destroyed{ std::move(destroyed) }, widget{ widget }, validated{ false }
+                destroyed{ std::move(destroyed) }, widget{ widget }, validated{ false }, depth{ 0u }
             {
                 if (!widget->is_root())
                     pauseRendering.emplace(widget->root());
@@ -47,6 +49,7 @@ namespace neogfx
             entry& operator=(entry&&) = default;
         };
         typedef std::vector<entry> entry_queue;
+        typedef std::unordered_map<i_widget const*, std::size_t> entry_index;
     public:
         async_layout();
     public:
@@ -54,15 +57,23 @@ namespace neogfx
         bool defer_layout(i_widget& aWidget) override;
         void validate(i_widget& aWidget) override;
         void invalidate(i_widget& aWidget) override;
+        async_layout_statistics const& last_tick_statistics() const override;
     private:
         std::optional<entry_queue::const_iterator> pending(i_widget& aWidget) const noexcept;
         std::optional<entry_queue::iterator> pending(i_widget& aWidget) noexcept;
         std::optional<entry_queue::const_iterator> processing(i_widget& aWidget) const noexcept;
         std::optional<entry_queue::iterator> processing(i_widget& aWidget) noexcept;
+        static std::optional<entry_queue::const_iterator> find(entry_queue const& aQueue, entry_index const& aIndex, i_widget& aWidget) noexcept;
+        static std::optional<entry_queue::iterator> find(entry_queue& aQueue, entry_index const& aIndex, i_widget& aWidget) noexcept;
         void process();
     private:
         neolib::callback_timer iTimer;
         entry_queue iPending;
+        entry_index iPendingIndex;
         entry_queue iProcessing;
+        entry_index iProcessingIndex;
+        uint32_t iQueued;
+        uint32_t iMerged;
+        async_layout_statistics iLastTickStatistics;
     };
 }
\ No newline at end of file
@@ -20,10 +20,19 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <chrono>
 #include <neogfx/gui/widget/i_widget.hpp>
 
 namespace neogfx
 {
+    struct async_layout_statistics
+    {
+        uint32_t queued;
+        uint32_t coalesced;
+        uint32_t laidOut;
+        std::chrono::microseconds duration;
+    };
+
     class i_async_layout : public i_service
     {
     public:
@@ -33,6 +42,7 @@ namespace neogfx
         virtual bool defer_layout(i_widget& aWidget) = 0;
         virtual void validate(i_widget& aWidget) = 0;
         virtual void invalidate(i_widget& aWidget) = 0;
+        virtual async_layout_statistics const& last_tick_statistics() const = 0;
     public:
         static uuid const& iid() { static uuid const sIid{ 0x3e50d155, 0xa8a, 0x4867, 0xacf8, { 0x42, 0xab, 0xd3, 0x34, 0xc0, 0xab } }; return sIid; }
     };
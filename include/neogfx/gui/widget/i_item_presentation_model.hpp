@@ -309,6 +309,8 @@ namespace neogfx
         virtual double total_height(i_units_context const& aUnitsContext) const = 0;
         virtual double item_position(item_presentation_model_index const& aIndex, i_units_context const& aUnitsContext) const = 0;
         virtual std::pair<item_presentation_model_index::value_type, coordinate> item_at(double aPosition, i_units_context const& aUnitsContext) const = 0;
+        virtual bool virtualized_row_extents() const = 0;
+        virtual void set_virtualized_row_extents(bool aVirtualized) = 0;
     public:
         virtual item_cell_flags cell_flags(item_presentation_model_index const& aIndex) const = 0;
         virtual void set_cell_flags(item_presentation_model_index const& aIndex, item_cell_flags aFlags) = 0;
@@ -334,7 +336,13 @@ namespace neogfx
         virtual optional_sort_by_param sorting_by() const = 0;
         virtual void sort_by(item_presentation_model_index::column_type aColumnIndex, optional_sort_direction const& aSortDirection = optional_sort_direction{}) = 0;
         virtual void reset_sort() = 0;
+        virtual bool background_sort_filter() const = 0;
+        virtual void set_background_sort_filter(bool aBackground) = 0;
+        virtual bool sort_filter_pending() const = 0;
+        virtual void cancel_sort_filter() = 0;
     public:
+        virtual bool search_indexed(item_presentation_model_index::column_type aColumnIndex) const = 0;
+        virtual void set_search_indexed(item_presentation_model_index::column_type aColumnIndex, bool aIndexed = true) = 0;
         virtual optional_item_presentation_model_index find_item(filter_search_key const& aFilterSearchKey, item_presentation_model_index::column_type aColumnIndex = 0, filter_search_type aFilterSearchType = filter_search_type::Prefix, case_sensitivity aCaseSensitivity = case_sensitivity::CaseInsensitive) const = 0;
     public:
         virtual bool filtering() const = 0;
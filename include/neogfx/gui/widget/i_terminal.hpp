@@ -38,6 +38,9 @@ namespace neogfx
         virtual void set_text_format(optional_text_format const& aTextFormat) = 0;
     public:
         virtual size_type terminal_size() const = 0;
+        // The maximum number of lines (scrollback and screen) that are kept; the oldest are discarded first.
+        virtual dimension_type scrollback_limit() const = 0;
+        virtual void set_scrollback_limit(dimension_type aLines) = 0;
     public:
         virtual void output(i_string const& aOutput) = 0;
     };
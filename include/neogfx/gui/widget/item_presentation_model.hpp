@@ -22,10 +22,19 @@
 #include <neogfx/neogfx.hpp>
 #include <vector>
 #include <deque>
+#include <map>
+#include <bit>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <numeric>
+#include <execution>
+#include <regex>
 #include <boost/algorithm/string.hpp>
 #include <neolib/core/vecarray.hpp>
 #include <neolib/core/segmented_array.hpp>
 #include <neolib/core/scoped.hpp>
+#include <neolib/task/timer.hpp>
 #include <neogfx/core/object.hpp>
 #include <neogfx/gfx/graphics_context.hpp>
 #include <neogfx/app/i_app.hpp>
@@ -90,6 +99,54 @@ namespace neogfx
         typedef typename container_traits::allocator_type allocator_type;
         typedef typename container_type::value_type row_type;
         typedef std::optional<i_scrollbar::value_type> optional_position;
+    private:
+        // Raw cell data of one model column, indexed by model row. It is snapshotted on the GUI thread and shared
+        // with background jobs, which do any string conversion and case folding themselves.
+        typedef std::vector<item_cell_data> column_values;
+        struct sort_key
+        {
+            std::shared_ptr<column_values const> values;
+            sort_direction direction;
+            std::vector<std::string> folded; // filled by prepare_sort_keys on the thread doing the sort
+        };
+        typedef std::vector<sort_key> sort_keys;
+        // A search key prepared once per search: folded unless case sensitive, with the literal prefix that
+        // a sorted index can narrow on (none for a regex) and the compiled regex if any.
+        struct search_pattern
+        {
+            filter_search_type type;
+            bool caseSensitive;
+            std::string key;
+            std::string literalPrefix;
+            std::optional<std::regex> regex;
+        };
+        struct filter_key
+        {
+            std::shared_ptr<column_values const> values;
+            search_pattern pattern;
+        };
+        // Case-folded cell strings of one model column and the model rows ordered by them; order holds exactly the
+        // rows [0, order.size()) and rows appended since are searched linearly until they are merged into order.
+        struct search_index
+        {
+            bool valid = false;
+            std::vector<std::string> keys;
+            std::vector<item_model_index::row_type> order;
+        };
+        typedef std::vector<filter_key> filter_keys;
+        typedef std::vector<std::size_t> sort_result;
+        typedef std::vector<item_model_index::row_type> filter_result;
+        template <typename Result>
+        struct background_job
+        {
+            std::shared_ptr<std::atomic<bool>> cancelled;
+            std::uint64_t revision;
+            std::future<std::optional<Result>> result;
+        };
+        static constexpr std::size_t SortChunkSize = 16384u;
+        static constexpr std::size_t FilterBlockSize = 4096u;
+        static constexpr std::size_t MinSearchIndexTail = 64u;
+        static constexpr uint32_t ColumnWidthSampleRows = 256u;
     private:
         typedef std::vector<item_presentation_model_index::optional_row_type, typename std::allocator_traits<allocator_type>:: template rebind_alloc<item_presentation_model_index::optional_row_type>> row_map_type;
         typedef std::vector<item_presentation_model_index::optional_column_type, typename std::allocator_traits<allocator_type>:: template rebind_alloc<item_presentation_model_index::optional_column_type>> column_map_type;
@@ -125,11 +182,11 @@ namespace neogfx
         using typename base_type::bad_index;
         using typename base_type::no_mapped_row;
     public:
-        basic_item_presentation_model(bool aSortable = false) : iItemModel{ nullptr }, iSortable{ aSortable }, iAlternatingRowColor{ false }
+        basic_item_presentation_model(bool aSortable = false) : iItemModel{ nullptr }, iSortable{ aSortable }, iAlternatingRowColor{ false }, iVirtualizedRowExtents{ false }
         {
             init();
         }
-        basic_item_presentation_model(i_item_model& aItemModel, bool aSortable = false) : iItemModel{ nullptr }, iSortable{ aSortable }, iAlternatingRowColor{ false }
+        basic_item_presentation_model(i_item_model& aItemModel, bool aSortable = false) : iItemModel{ nullptr }, iSortable{ aSortable }, iAlternatingRowColor{ false }, iVirtualizedRowExtents{ false }
         {
             init();
             set_item_model(aItemModel);
@@ -137,6 +194,8 @@ namespace neogfx
         ~basic_item_presentation_model()
         {
             set_destroying();
+            iSortFilterPump.reset();
+            cancel_sort_filter();
             iSink.clear();
             iItemModelSink.clear();
         }
@@ -217,14 +276,19 @@ namespace neogfx
                     ItemModelChanged.trigger(item_model());
                 };
                 iItemModelSink.clear();
+                cancel_sort_filter();
+                reset_column_values();
+                invalidate_search_indices();
                 iItemModel = &aItemModel;
                 iItemModelSink += item_model().column_info_changed([this](item_model_index::column_type aColumnIndex) { item_model_column_info_changed(aColumnIndex); });
-                iItemModelSink += item_model().item_added([this](const item_model_index& aItemIndex) { item_added(aItemIndex); });
-                iItemModelSink += item_model().item_changed([this](const item_model_index& aItemIndex) { item_changed(aItemIndex); });
-                iItemModelSink += item_model().item_removing([this](const item_model_index& aItemIndex) { item_removing(aItemIndex); });
+                iItemModelSink += item_model().item_added([this](const item_model_index& aItemIndex) { update_column_values_added(aItemIndex); update_search_indices_added(aItemIndex); item_added(aItemIndex); });
+                iItemModelSink += item_model().item_changed([this](const item_model_index& aItemIndex) { update_column_values_changed(aItemIndex); update_search_indices_changed(aItemIndex); item_changed(aItemIndex); });
+                iItemModelSink += item_model().item_removing([this](const item_model_index& aItemIndex) { update_column_values_removing(aItemIndex); update_search_indices_removing(aItemIndex); item_removing(aItemIndex); });
                 iItemModelSink += item_model().item_removed([this](const item_model_index& aItemIndex) { item_removed(aItemIndex); });
                 iItemModelSink += item_model().cleared([this]()
                 {  
+                    reset_column_values();
+                    invalidate_search_indices();
                     iRows.clear();
                     reset_maps();
                     reset_meta();
@@ -233,6 +297,9 @@ namespace neogfx
                 });
                 iItemModelSink += item_model().destroying([this]() 
                 { 
+                    cancel_sort_filter();
+                    reset_column_values();
+                    invalidate_search_indices();
                     iItemModel = nullptr;
                     iColumns.clear(); 
                     iRows.clear(); 
@@ -303,7 +370,9 @@ namespace neogfx
             auto& cellWidths = column(aColumnIndex).cellWidths;
             if (!cellWidths.empty())
                 return units_converter(aUnitsContext).from_device_units(cellWidths.rbegin()->first) + (aExtendIntoPadding ? cell_padding(aUnitsContext).size().cx : 0.0);
-            for (item_presentation_model_index::row_type row = 0u; row < rows(); ++row)
+            // with virtualized row extents only an even sample of rows is measured; the width grows as rows are visited
+            auto const step = (iVirtualizedRowExtents ? std::max(rows() / ColumnWidthSampleRows, 1u) : 1u);
+            for (item_presentation_model_index::row_type row = 0u; row < rows(); row += step)
                 cell_extents(item_presentation_model_index{ row, aColumnIndex }, aUnitsContext);
             return units_converter(aUnitsContext).from_device_units(cellWidths.rbegin()->first) + (aExtendIntoPadding ? cell_padding(aUnitsContext).size().cx : 0.0);
         }
@@ -572,10 +641,18 @@ namespace neogfx
                         height = std::max<dimension>(height, dip(basic_spin_box<double>::SPIN_BUTTON_MINIMUM_SIZE.cy * 2.0));
                 }
             }
-            return height + cell_padding(aUnitsContext).size().cy + cell_spacing(aUnitsContext).cy;
+            height += cell_padding(aUnitsContext).size().cy + cell_spacing(aUnitsContext).cy;
+            if (iVirtualizedRowExtents)
+                update_row_extent(aIndex.row(), height, aUnitsContext);
+            return height;
         }
         double total_height(i_units_context const& aUnitsContext) const final
         {
+            if (iVirtualizedRowExtents)
+            {
+                validate_row_extents(aUnitsContext);
+                return row_extent_prefix(rows());
+            }
             if (iTotalHeight != std::nullopt)
                 return *iTotalHeight;
             i_scrollbar::value_type height = 0.0;
@@ -586,6 +663,11 @@ namespace neogfx
         }
         double item_position(item_presentation_model_index const& aIndex, i_units_context const& aUnitsContext) const final
         {
+            if (iVirtualizedRowExtents)
+            {
+                validate_row_extents(aUnitsContext);
+                return row_extent_prefix(aIndex.row());
+            }
             if (iPositions[aIndex.row()] == std::nullopt)
             {
                 auto pred = [](const optional_position& lhs, const optional_position& rhs) -> bool
@@ -615,6 +697,19 @@ namespace neogfx
         {
             if (rows() == 0)
                 return std::pair<item_presentation_model_index::row_type, coordinate>{ 0u, 0.0 };
+            if (iVirtualizedRowExtents)
+            {
+                validate_row_extents(aUnitsContext);
+                // measuring the row found may move it (its estimate was wrong) so search again until the row
+                // containing the position has been measured; each pass measures a row so this terminates.
+                auto row = row_extent_find(aPosition);
+                while (!iRowMeasured[row])
+                {
+                    item_height(item_presentation_model_index{ row }, aUnitsContext);
+                    row = row_extent_find(aPosition);
+                }
+                return std::pair<item_presentation_model_index::row_type, coordinate>{ row, static_cast<coordinate>(row_extent_prefix(row) - aPosition) };
+            }
             auto pred = [](const optional_position& lhs, const optional_position& rhs) -> bool
             {
                 if (lhs == std::nullopt && rhs == std::nullopt)
@@ -647,6 +742,18 @@ namespace neogfx
             auto const result = std::pair<item_presentation_model_index::row_type, coordinate>{ static_cast<item_presentation_model_index::row_type>(std::distance(iPositions.begin(), i)), static_cast<coordinate>(**i - aPosition) };
             return result;
         }
+        bool virtualized_row_extents() const final
+        {
+            return iVirtualizedRowExtents;
+        }
+        void set_virtualized_row_extents(bool aVirtualized) final
+        {
+            if (iVirtualizedRowExtents != aVirtualized)
+            {
+                iVirtualizedRowExtents = aVirtualized;
+                reset_position_meta(0);
+            }
+        }
     public:
         item_cell_flags cell_flags(item_presentation_model_index const& aIndex) const override
         {
@@ -861,12 +968,12 @@ namespace neogfx
         }
         size cell_extents(item_presentation_model_index const& aIndex, i_units_context const& aUnitsContext) const override
         {
-            auto oldItemHeight = item_height(aIndex, aUnitsContext);
             auto const& cellFont = cell_font(aIndex);
             auto const& effectiveFont = (cellFont == std::nullopt ? default_font() : *cellFont);
             auto& cellMeta = cell_meta(aIndex);
             if (cellMeta.extents != std::nullopt)
                 return units_converter(aUnitsContext).from_device_units(*cellMeta.extents);
+            auto const oldItemHeight = (!iVirtualizedRowExtents && iTotalHeight != std::nullopt ? item_height(aIndex, aUnitsContext) : 0.0);
             size cellExtents = cell_glyph_text(aIndex).extents();
             auto const& cellInfo = item_model().cell_info(to_item_model_index(aIndex));
             if (cell_editable(aIndex) && cellInfo.dataStep != neolib::none)
@@ -891,7 +998,9 @@ namespace neogfx
             }
             cellExtents.cy = std::max(cellExtents.cy, effectiveFont.height());
             cache_cell_meta_extents(aIndex, cellExtents.ceil());
-            if (iTotalHeight != std::nullopt)
+            if (iVirtualizedRowExtents)
+                row_extent_changed(aIndex.row());
+            else if (iTotalHeight != std::nullopt)
                 *iTotalHeight += (item_height(aIndex, aUnitsContext) - oldItemHeight);
             return units_converter(aUnitsContext).from_device_units(*cell_meta(aIndex).extents);
         }
@@ -913,6 +1022,8 @@ namespace neogfx
         void sort(i_item_sort_predicate const& aPredicate) final
         {
             iSortOrder.clear();
+            cancel_job(iSortJob);
+            row_positions_changed();
             ItemsSorting.trigger();
             if constexpr (container_traits::is_flat)
                 std::sort(iRows.begin(), iRows.end(), [&](auto const& lhs, auto const& rhs) { return aPredicate.compare(lhs.value, rhs.value); });
@@ -963,26 +1074,118 @@ namespace neogfx
             if (sortable())
                 execute_sort();
         }
+        bool background_sort_filter() const final
+        {
+            return iSortFilterPump != std::nullopt;
+        }
+        void set_background_sort_filter(bool aBackground) final
+        {
+            if (aBackground == background_sort_filter())
+                return;
+            if (aBackground)
+                iSortFilterPump.emplace(service<i_async_task>(), [this](neolib::callback_timer& aTimer)
+                {
+                    aTimer.again();
+                    process_sort_filter();
+                }, std::chrono::milliseconds{ 10 });
+            else
+            {
+                iSortFilterPump.reset();
+                bool const filterPending = (iFilterJob != std::nullopt);
+                bool const sortPending = (iSortJob != std::nullopt);
+                cancel_sort_filter();
+                if (filterPending)
+                    execute_filter();
+                else if (sortPending)
+                    execute_sort(true);
+            }
+        }
+        bool sort_filter_pending() const final
+        {
+            return iSortJob != std::nullopt || iFilterJob != std::nullopt;
+        }
+        void cancel_sort_filter() final
+        {
+            cancel_job(iSortJob);
+            cancel_job(iFilterJob);
+        }
     public:
+        bool search_indexed(item_presentation_model_index::column_type aColumnIndex) const final
+        {
+            return iSearchIndices.find(model_column(aColumnIndex)) != iSearchIndices.end();
+        }
+        void set_search_indexed(item_presentation_model_index::column_type aColumnIndex, bool aIndexed = true) final
+        {
+            if (aIndexed)
+                iSearchIndices.try_emplace(model_column(aColumnIndex));
+            else
+                iSearchIndices.erase(model_column(aColumnIndex));
+        }
         optional_item_presentation_model_index find_item(filter_search_key const& aFilterSearchKey, item_presentation_model_index::column_type aColumnIndex = 0, 
             filter_search_type aFilterSearchType = filter_search_type::Prefix, case_sensitivity aCaseSensitivity = case_sensitivity::CaseInsensitive) const final
         {
-            for (item_presentation_model_index::row_type row = 0; row < rows(); ++row)
+            auto const pattern = make_search_pattern(aFilterSearchKey, aFilterSearchType, aCaseSensitivity);
+            if (pattern.key.empty())
+                return optional_item_presentation_model_index{};
+            auto const modelColumn = model_column(aColumnIndex);
+            auto existingIndex = iSearchIndices.find(modelColumn);
+            if (existingIndex == iSearchIndices.end())
             {
-                auto modelIndex = to_item_model_index(item_presentation_model_index{ row, aColumnIndex });
-                auto const& origValue = item_model().cell_data(modelIndex).to_string();
-                auto const& value = aCaseSensitivity == case_sensitivity::CaseSensitive ? origValue : boost::to_upper_copy<std::string>(origValue);
-                auto const& origKey = aFilterSearchKey;
-                auto const& key = aCaseSensitivity == case_sensitivity::CaseSensitive ? origKey : boost::to_upper_copy<std::string>(origKey);
-                if (key.empty())
-                    continue;
-                switch (aFilterSearchType)
+                for (item_presentation_model_index::row_type row = 0; row < rows(); ++row)
+                {
+                    auto modelIndex = to_item_model_index(item_presentation_model_index{ row, aColumnIndex });
+                    auto const& origValue = item_model().cell_data(modelIndex).to_string();
+                    if (search_matches(pattern, pattern.caseSensitive ? origValue : boost::to_upper_copy<std::string>(origValue)))
+                        return from_item_model_index(modelIndex);
+                }
+                return optional_item_presentation_model_index{};
+            }
+            // narrow to the index range sharing the literal prefix and pick the candidate presented first; only a
+            // pattern without a literal prefix (every row a candidate) walks the presentation order instead
+            auto const& index = validated_search_index(existingIndex->second, modelColumn);
+            auto const rangePrefix = (pattern.caseSensitive ? boost::to_upper_copy<std::string>(pattern.literalPrefix) : pattern.literalPrefix);
+            auto const matches = [&](item_model_index::row_type aModelRow)
+            {
+                return pattern.caseSensitive ?
+                    search_matches(pattern, item_model().cell_data(item_model_index{ aModelRow, modelColumn }).to_string()) :
+                    search_matches(pattern, index.keys[aModelRow]);
+            };
+            auto const first = std::lower_bound(index.order.begin(), index.order.end(), rangePrefix,
+                [&](item_model_index::row_type aRow, std::string const& aPrefix) { return index.keys[aRow] < aPrefix; });
+            auto const last = std::partition_point(first, index.order.end(),
+                [&](item_model_index::row_type aRow) { return index.keys[aRow].starts_with(rangePrefix); });
+            if (rangePrefix.empty())
+            {
+                for (item_presentation_model_index::row_type row = 0; row < rows(); ++row)
                 {
-                case filter_search_type::Prefix:
-                    if (value.size() >= key.size() && value.substr(0, key.size()) == key)
+                    auto const modelIndex = to_item_model_index(item_presentation_model_index{ row, aColumnIndex });
+                    if (modelIndex.row() < index.keys.size() && index.keys[modelIndex.row()].starts_with(rangePrefix) && matches(modelIndex.row()))
                         return from_item_model_index(modelIndex);
                 }
+                return optional_item_presentation_model_index{};
             }
+            std::optional<item_presentation_model_index::row_type> bestRow;
+            item_model_index::row_type bestModelRow = 0;
+            auto const consider = [&](item_model_index::row_type aModelRow)
+            {
+                if (!has_item_model_index(item_model_index{ aModelRow }))
+                    return;
+                auto const row = mapped_row(aModelRow);
+                if (bestRow != std::nullopt && *bestRow <= row)
+                    return;
+                if (matches(aModelRow))
+                {
+                    bestRow = row;
+                    bestModelRow = aModelRow;
+                }
+            };
+            for (auto match = first; match != last; ++match)
+                consider(*match);
+            for (auto modelRow = static_cast<item_model_index::row_type>(index.order.size()); modelRow < index.keys.size(); ++modelRow)
+                if (index.keys[modelRow].starts_with(rangePrefix))
+                    consider(modelRow);
+            if (bestRow != std::nullopt)
+                return from_item_model_index(item_model_index{ bestModelRow, modelColumn });
             return optional_item_presentation_model_index{};
         }
     public:
@@ -1045,76 +1248,500 @@ namespace neogfx
                 sort_by(0, sort_direction::Ascending);
                 return;
             }
+            if (!aForce && iSortJob != std::nullopt)
+            {
+                // rows changed while a sort is running: let it finish and sort again once its result is applied,
+                // rather than cancelling it, so that a model which keeps changing still gets sorted
+                iSortStale = true;
+                return;
+            }
+            cancel_job(iSortJob);
+            iSortStale = false;
             ItemsSorting.trigger();
-            auto sortPredicate = [&](const typename container_type::value_type& aLhs, const typename container_type::value_type& aRhs) -> bool
+            auto keys = extract_sort_keys();
+            std::atomic<bool> const notCancelled = false;
+            if constexpr (container_traits::is_flat)
             {
-                for (std::size_t i = 0; i < iSortOrder.size(); ++i)
+                std::vector<item_model_index::row_type> modelRows;
+                modelRows.reserve(iRows.size());
+                for (auto const& row : iRows)
+                    modelRows.push_back(row.value);
+                if (background_sort_filter())
                 {
-                    auto col = iSortOrder[i].first;
-                    auto const& v1 = item_model().cell_data(item_model_index{ aLhs.value, model_column(col) });
-                    auto const& v2 = item_model().cell_data(item_model_index{ aRhs.value, model_column(col) });
-                    if (std::holds_alternative<string>(v1) && std::holds_alternative<string>(v2))
-                    {
-                        std::string s1 = boost::to_upper_copy<std::string>(std::get<string>(v1));
-                        std::string s2 = boost::to_upper_copy<std::string>(std::get<string>(v2));
-                        if (s1 < s2)
-                            return iSortOrder[i].second == sort_direction::Ascending;
-                        else if (s2 < s1)
-                            return iSortOrder[i].second == sort_direction::Descending;
-                    }
-                    if (v1 < v2)
-                        return iSortOrder[i].second == sort_direction::Ascending;
-                    else if (v2 < v1)
-                        return iSortOrder[i].second == sort_direction::Descending;
+                    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+                    iSortJob.emplace(cancelled, iRowPositionsRevision, std::async(std::launch::async, 
+                        [keys = std::move(keys), modelRows = std::move(modelRows), cancelled]() mutable
+                        {
+                            if (!prepare_sort_keys(keys, *cancelled))
+                                return std::optional<sort_result>{};
+                            return sort_rows(keys, modelRows, *cancelled);
+                        }));
+                    return;
                 }
-                return false;
-            };
-            if constexpr (container_traits::is_flat)
-                std::sort(iRows.begin(), iRows.end(), sortPredicate);
+                prepare_sort_keys(keys, notCancelled);
+                apply_sort(*sort_rows(keys, modelRows, notCancelled));
+            }
             else
-                iRows.sort(sortPredicate);
-            reset_row_map();
-            reset_position_meta(0);
-            ItemsSorted.trigger();
+            {
+                prepare_sort_keys(keys, notCancelled);
+                iRows.sort([&](auto const& lhs, auto const& rhs) { return compare_rows(keys, lhs.value, rhs.value); });
+                reset_row_map();
+                reset_position_meta(0);
+                ItemsSorted.trigger();
+            }
         }
         void execute_filter()
+        {
+            cancel_job(iFilterJob);
+            cancel_job(iSortJob);
+            filter_keys keys;
+            for (auto const& filter : iFilters)
+                keys.push_back(filter_key{ 
+                    column_values_for(model_column(std::get<0>(filter))), 
+                    make_search_pattern(std::get<1>(filter), std::get<2>(filter), std::get<3>(filter)) });
+            std::size_t const modelRows = item_model().rows();
+            ItemsFiltering.trigger();
+            if (background_sort_filter())
+            {
+                auto cancelled = std::make_shared<std::atomic<bool>>(false);
+                iFilterJob.emplace(cancelled, iRowsRevision, std::async(std::launch::async, [keys = std::move(keys), modelRows, cancelled]()
+                {
+                    return filter_rows(keys, modelRows, *cancelled);
+                }));
+                return;
+            }
+            std::atomic<bool> const notCancelled = false;
+            apply_filter(*filter_rows(keys, modelRows, notCancelled));
+        }
+        void apply_sort(sort_result const& aOrder)
+        {
+            if constexpr (container_traits::is_flat)
+            {
+                container_type sorted;
+                sorted.reserve(iRows.size());
+                for (auto i : aOrder)
+                    sorted.push_back(std::move(iRows[i]));
+                // rows appended since a background sort was issued stay after the sorted rows until the next sort
+                for (auto i = aOrder.size(); i < iRows.size(); ++i)
+                    sorted.push_back(std::move(iRows[i]));
+                iRows = std::move(sorted);
+                row_positions_changed();
+                reset_row_map();
+                reset_position_meta(0);
+                ItemsSorted.trigger();
+            }
+        }
+        void apply_filter(filter_result const& aMatches)
         {
             {
                 scoped_item_update siu{ *this };
                 neolib::scoped_flag sf2{ iFiltering };
-                ItemsFiltering.trigger();
                 iRows.clear();
-                for (item_model_index::row_type row = 0; row < item_model().rows(); ++row)
+                for (auto row : aMatches)
+                    item_added(item_model_index{ row });
+                row_positions_changed();
+            }
+            ItemsFiltered.trigger();
+            execute_sort();
+        }
+        void process_sort_filter()
+        {
+            std::erase_if(iAbandonedSortJobs, [](auto const& aJob) { return aJob.result.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready; });
+            std::erase_if(iAbandonedFilterJobs, [](auto const& aJob) { return aJob.result.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready; });
+            if (iFilterJob && iFilterJob->result.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready)
+            {
+                auto job = std::move(*iFilterJob);
+                iFilterJob.reset();
+                auto const matches = job.result.get();
+                if (matches && job.revision == iRowsRevision)
+                    apply_filter(*matches);
+                else if (matches)
+                    execute_filter();
+            }
+            if (iSortJob && iSortJob->result.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready)
+            {
+                auto job = std::move(*iSortJob);
+                iSortJob.reset();
+                auto const order = job.result.get();
+                if (order && job.revision == iRowPositionsRevision)
+                    apply_sort(*order);
+                else if (order)
+                    iSortStale = true;
+                if (iSortStale)
+                    execute_sort(true);
+            }
+        }
+        template <typename Result>
+        void cancel_job(std::optional<background_job<Result>>& aJob)
+        {
+            if (aJob == std::nullopt)
+                return;
+            *aJob->cancelled = true;
+            // a cancelled job is parked rather than waited for so that the GUI thread never blocks on it
+            if constexpr (std::is_same_v<Result, sort_result>)
+                iAbandonedSortJobs.push_back(std::move(*aJob));
+            else
+                iAbandonedFilterJobs.push_back(std::move(*aJob));
+            aJob.reset();
+        }
+        // Rows before the end of the presentation have moved or gone so no background result can be applied.
+        void row_positions_changed()
+        {
+            ++iRowsRevision;
+            ++iRowPositionsRevision;
+        }
+        void reset_column_values()
+        {
+            iColumnValues.clear();
+            row_positions_changed();
+        }
+        std::shared_ptr<column_values const> column_values_for(item_model_index::column_type aModelColumn) const
+        {
+            auto& existing = iColumnValues[aModelColumn];
+            if (existing == nullptr)
+            {
+                existing = std::make_shared<column_values>();
+                auto const modelRows = item_model().rows();
+                existing->reserve(modelRows);
+                for (item_model_index::row_type row = 0; row < modelRows; ++row)
+                    existing->push_back(item_model().cell_data(item_model_index{ row, aModelColumn }));
+            }
+            return existing;
+        }
+        // The update_column_values_* functions keep the snapshots in step with a row appended to, changed in or
+        // removed from the end of the item model; a snapshot still held by a background job, or one that would be
+        // renumbered, is dropped and taken again when next needed.
+        void update_column_values_added(item_model_index const& aItemIndex)
+        {
+            ++iRowsRevision;
+            for (auto existing = iColumnValues.begin(); existing != iColumnValues.end();)
+            {
+                auto& values = existing->second;
+                if (values.use_count() == 1 && aItemIndex.row() == values->size())
+                {
+                    values->push_back(item_model().cell_data(item_model_index{ aItemIndex.row(), existing->first }));
+                    ++existing;
+                }
+                else
+                    existing = iColumnValues.erase(existing);
+            }
+        }
+        void update_column_values_changed(item_model_index const& aItemIndex)
+        {
+            for (auto existing = iColumnValues.begin(); existing != iColumnValues.end();)
+            {
+                auto& values = existing->second;
+                if (values.use_count() == 1 && aItemIndex.row() < values->size())
                 {
-                    bool matches = true;
-                    for (auto const& filter : iFilters)
+                    (*values)[aItemIndex.row()] = item_model().cell_data(item_model_index{ aItemIndex.row(), existing->first });
+                    ++existing;
+                }
+                else
+                    existing = iColumnValues.erase(existing);
+            }
+        }
+        void update_column_values_removing(item_model_index const& aItemIndex)
+        {
+            row_positions_changed();
+            for (auto existing = iColumnValues.begin(); existing != iColumnValues.end();)
+            {
+                auto& values = existing->second;
+                if (values.use_count() == 1 && aItemIndex.row() + 1u == values->size())
+                {
+                    values->pop_back();
+                    ++existing;
+                }
+                else
+                    existing = iColumnValues.erase(existing);
+            }
+        }
+        sort_keys extract_sort_keys() const
+        {
+            sort_keys keys;
+            for (auto const& sortBy : iSortOrder)
+                keys.push_back(sort_key{ column_values_for(model_column(sortBy.first)), sortBy.second });
+            return keys;
+        }
+        // Case-folds the string values of each key in parallel blocks.
+        static bool prepare_sort_keys(sort_keys& aKeys, std::atomic<bool> const& aCancelled)
+        {
+            for (auto& key : aKeys)
+            {
+                auto const& values = *key.values;
+                key.folded.resize(values.size());
+                std::vector<std::size_t> starts;
+                for (std::size_t start = 0u; start < values.size(); start += FilterBlockSize)
+                    starts.push_back(start);
+                std::for_each(std::execution::par, starts.begin(), starts.end(), [&](std::size_t aStart)
+                {
+                    if (aCancelled)
+                        return;
+                    for (auto row = aStart; row < std::min(aStart + FilterBlockSize, values.size()); ++row)
+                        if (std::holds_alternative<string>(values[row]))
+                            key.folded[row] = boost::to_upper_copy<std::string>(values[row].to_string());
+                });
+                if (aCancelled)
+                    return false;
+            }
+            return true;
+        }
+        static bool compare_rows(sort_keys const& aKeys, item_model_index::row_type aLhs, item_model_index::row_type aRhs)
+        {
+            for (auto const& key : aKeys)
+            {
+                auto const& v1 = (*key.values)[aLhs];
+                auto const& v2 = (*key.values)[aRhs];
+                if (std::holds_alternative<string>(v1) && std::holds_alternative<string>(v2))
+                {
+                    auto const& s1 = key.folded[aLhs];
+                    auto const& s2 = key.folded[aRhs];
+                    if (s1 < s2)
+                        return key.direction == sort_direction::Ascending;
+                    else if (s2 < s1)
+                        return key.direction == sort_direction::Descending;
+                }
+                if (v1 < v2)
+                    return key.direction == sort_direction::Ascending;
+                else if (v2 < v1)
+                    return key.direction == sort_direction::Descending;
+            }
+            return false;
+        }
+        // Sorts chunks in parallel then merges them pairwise; cancellation is checked between passes.
+        static std::optional<sort_result> sort_rows(sort_keys const& aKeys, std::vector<item_model_index::row_type> const& aModelRows, std::atomic<bool> const& aCancelled)
+        {
+            auto const n = aModelRows.size();
+            sort_result order(n);
+            std::iota(order.begin(), order.end(), 0u);
+            auto const less = [&](std::size_t aLhs, std::size_t aRhs) { return compare_rows(aKeys, aModelRows[aLhs], aModelRows[aRhs]); };
+            std::size_t const threads = std::max(1u, std::thread::hardware_concurrency());
+            std::size_t const chunk = std::max(SortChunkSize, (n + threads - 1u) / threads);
+            std::vector<std::size_t> starts;
+            for (std::size_t start = 0u; start < n; start += chunk)
+                starts.push_back(start);
+            std::for_each(std::execution::par, starts.begin(), starts.end(), [&](std::size_t aStart)
+            {
+                if (!aCancelled)
+                    std::sort(std::next(order.begin(), aStart), std::next(order.begin(), std::min(aStart + chunk, n)), less);
+            });
+            for (std::size_t width = chunk; width < n; width *= 2u)
+            {
+                if (aCancelled)
+                    return {};
+                starts.clear();
+                for (std::size_t start = 0u; start + width < n; start += width * 2u)
+                    starts.push_back(start);
+                std::for_each(std::execution::par, starts.begin(), starts.end(), [&](std::size_t aStart)
+                {
+                    std::inplace_merge(std::next(order.begin(), aStart), std::next(order.begin(), aStart + width), std::next(order.begin(), std::min(aStart + width * 2u, n)), less);
+                });
+            }
+            if (aCancelled)
+                return {};
+            return order;
+        }
+        static search_pattern make_search_pattern(filter_search_key const& aKey, filter_search_type aType, case_sensitivity aCaseSensitivity)
+        {
+            bool const caseSensitive = (aCaseSensitivity == case_sensitivity::CaseSensitive);
+            search_pattern result{ aType, caseSensitive, 
+                caseSensitive || aType == filter_search_type::Regex ? aKey : boost::to_upper_copy<std::string>(aKey) };
+            switch (aType)
+            {
+            case filter_search_type::Prefix:
+                result.literalPrefix = result.key;
+                break;
+            case filter_search_type::Glob:
+                result.literalPrefix = result.key.substr(0, result.key.find_first_of("*?"));
+                break;
+            case filter_search_type::Regex:
+                try
+                {
+                    result.regex.emplace(result.key, caseSensitive ? std::regex::ECMAScript : std::regex::ECMAScript | std::regex::icase);
+                }
+                catch (std::regex_error const&)
+                {
+                    // an incomplete expression (the user is still typing) matches nothing
+                }
+                break;
+            }
+            return result;
+        }
+        static bool search_matches(search_pattern const& aPattern, std::string const& aValue)
+        {
+            switch (aPattern.type)
+            {
+            case filter_search_type::Prefix:
+                return aValue.starts_with(aPattern.key);
+            case filter_search_type::Glob:
+                return glob_matches(aValue, aPattern.key);
+            case filter_search_type::Regex:
+                return aPattern.regex != std::nullopt && std::regex_search(aValue, *aPattern.regex);
+            }
+            return false;
+        }
+        static bool glob_matches(std::string_view aValue, std::string_view aGlob)
+        {
+            std::size_t value = 0u;
+            std::size_t glob = 0u;
+            std::optional<std::size_t> star;
+            std::size_t starValue = 0u;
+            while (value < aValue.size())
+            {
+                if (glob < aGlob.size() && (aGlob[glob] == '?' || aGlob[glob] == aValue[value]))
+                {
+                    ++value;
+                    ++glob;
+                }
+                else if (glob < aGlob.size() && aGlob[glob] == '*')
+                {
+                    star = glob++;
+                    starValue = value;
+                }
+                else if (star != std::nullopt)
+                {
+                    glob = *star + 1u;
+                    value = ++starValue;
+                }
+                else
+                    return false;
+            }
+            while (glob < aGlob.size() && aGlob[glob] == '*')
+                ++glob;
+            return glob == aGlob.size();
+        }
+        static bool search_index_less(search_index const& aIndex, item_model_index::row_type aLhs, item_model_index::row_type aRhs)
+        {
+            auto const compare = aIndex.keys[aLhs].compare(aIndex.keys[aRhs]);
+            return compare < 0 || (compare == 0 && aLhs < aRhs);
+        }
+        search_index const& validated_search_index(search_index& aIndex, item_model_index::column_type aModelColumn) const
+        {
+            if (!aIndex.valid)
+            {
+                auto const modelRows = item_model().rows();
+                aIndex.keys.clear();
+                aIndex.keys.reserve(modelRows);
+                for (item_model_index::row_type row = 0; row < modelRows; ++row)
+                    aIndex.keys.push_back(boost::to_upper_copy<std::string>(item_model().cell_data(item_model_index{ row, aModelColumn }).to_string()));
+                aIndex.order.resize(modelRows);
+                std::iota(aIndex.order.begin(), aIndex.order.end(), 0u);
+                std::sort(std::execution::par, aIndex.order.begin(), aIndex.order.end(),
+                    [&](item_model_index::row_type aLhs, item_model_index::row_type aRhs) { return search_index_less(aIndex, aLhs, aRhs); });
+                aIndex.valid = true;
+            }
+            return aIndex;
+        }
+        static void invalidate_search_index(search_index& aIndex)
+        {
+            aIndex.valid = false;
+            aIndex.keys.clear();
+            aIndex.order.clear();
+        }
+        void invalidate_search_indices() const
+        {
+            for (auto& index : iSearchIndices)
+                invalidate_search_index(index.second);
+        }
+        static void merge_search_index_tail(search_index& aIndex)
+        {
+            auto const less = [&](item_model_index::row_type aLhs, item_model_index::row_type aRhs) { return search_index_less(aIndex, aLhs, aRhs); };
+            auto const sorted = aIndex.order.size();
+            for (auto row = static_cast<item_model_index::row_type>(sorted); row < aIndex.keys.size(); ++row)
+                aIndex.order.push_back(row);
+            std::sort(std::next(aIndex.order.begin(), sorted), aIndex.order.end(), less);
+            std::inplace_merge(aIndex.order.begin(), std::next(aIndex.order.begin(), sorted), aIndex.order.end(), less);
+        }
+        // The update_search_indices_* functions keep built indices in step with rows appended to, changed in or
+        // removed from the end of the item model without renumbering; a batch update or a row inserted or removed
+        // elsewhere would shift the rows held by the index so it is invalidated and rebuilt on the next search.
+        void update_search_indices_added(item_model_index const& aItemIndex)
+        {
+            auto const newRow = aItemIndex.row();
+            for (auto& [modelColumn, index] : iSearchIndices)
+            {
+                if (!index.valid)
+                    continue;
+                if (updating() || newRow != index.keys.size())
+                {
+                    invalidate_search_index(index);
+                    continue;
+                }
+                index.keys.push_back(boost::to_upper_copy<std::string>(item_model().cell_data(item_model_index{ newRow, modelColumn }).to_string()));
+                auto const tail = index.keys.size() - index.order.size();
+                if (tail > MinSearchIndexTail && tail * tail > index.keys.size())
+                    merge_search_index_tail(index);
+            }
+        }
+        void update_search_indices_changed(item_model_index const& aItemIndex)
+        {
+            auto const changedRow = aItemIndex.row();
+            for (auto& [modelColumn, index] : iSearchIndices)
+            {
+                if (!index.valid)
+                    continue;
+                if (changedRow >= index.keys.size())
+                {
+                    invalidate_search_index(index);
+                    continue;
+                }
+                if (changedRow >= index.order.size())
+                {
+                    index.keys[changedRow] = boost::to_upper_copy<std::string>(item_model().cell_data(item_model_index{ changedRow, modelColumn }).to_string());
+                    continue;
+                }
+                auto const less = [&](item_model_index::row_type aLhs, item_model_index::row_type aRhs) { return search_index_less(index, aLhs, aRhs); };
+                index.order.erase(std::lower_bound(index.order.begin(), index.order.end(), changedRow, less));
+                index.keys[changedRow] = boost::to_upper_copy<std::string>(item_model().cell_data(item_model_index{ changedRow, modelColumn }).to_string());
+                index.order.insert(std::lower_bound(index.order.begin(), index.order.end(), changedRow, less), changedRow);
+            }
+        }
+        void update_search_indices_removing(item_model_index const& aItemIndex)
+        {
+            auto const removedRow = aItemIndex.row();
+            for (auto& [modelColumn, index] : iSearchIndices)
+            {
+                if (!index.valid)
+                    continue;
+                if (updating() || removedRow + 1u != index.keys.size())
+                {
+                    invalidate_search_index(index);
+                    continue;
+                }
+                if (removedRow < index.order.size())
+                    index.order.erase(std::lower_bound(index.order.begin(), index.order.end(), removedRow,
+                        [&](item_model_index::row_type aLhs, item_model_index::row_type aRhs) { return search_index_less(index, aLhs, aRhs); }));
+                index.keys.pop_back();
+            }
+        }
+        static std::optional<filter_result> filter_rows(filter_keys const& aKeys, std::size_t aModelRows, std::atomic<bool> const& aCancelled)
+        {
+            std::vector<char> matched(aModelRows, 1);
+            std::vector<std::size_t> starts;
+            for (std::size_t start = 0u; start < aModelRows; start += FilterBlockSize)
+                starts.push_back(start);
+            std::for_each(std::execution::par, starts.begin(), starts.end(), [&](std::size_t aStart)
+            {
+                if (aCancelled)
+                    return;
+                for (auto row = aStart; row < std::min(aStart + FilterBlockSize, aModelRows); ++row)
+                {
+                    for (auto const& key : aKeys)
                     {
-                        auto const& origValue = item_model().cell_data(item_model_index{ row, model_column(std::get<0>(filter)) }).to_string();
-                        auto const& value = (std::get<3>(filter) == case_sensitivity::CaseSensitive ? origValue : boost::to_upper_copy<std::string>(origValue));
-                        auto const& origKey = std::get<1>(filter);
-                        auto const& key = (std::get<3>(filter) == case_sensitivity::CaseSensitive ? origKey : boost::to_upper_copy<std::string>(origKey));
-                        if (key.empty())
+                        if (key.pattern.key.empty())
                             continue;
-                        switch (std::get<2>(filter))
-                        {
-                        case filter_search_type::Prefix:
-                            if (value.size() < key.size() || value.substr(0, key.size()) != key)
-                                matches = false;
-                            break;
-                        case filter_search_type::Glob:
-                            // todo
-                            break;
-                        case filter_search_type::Regex:
-                            // todo
-                            break;
-                        }
+                        auto const value = (*key.values)[row].to_string();
+                        if (!search_matches(key.pattern, key.pattern.caseSensitive ? value : boost::to_upper_copy<std::string>(value)))
+                            matched[row] = 0;
                     }
-                    if (matches)
-                        item_added(item_model_index{ row });
                 }
-            }
-            ItemsFiltered.trigger();
-            execute_sort();
+            });
+            if (aCancelled)
+                return {};
+            filter_result result;
+            for (std::size_t row = 0u; row < aModelRows; ++row)
+                if (matched[row])
+                    result.push_back(static_cast<item_model_index::row_type>(row));
+            return result;
         }
     private:
         void item_model_column_info_changed(item_model_index::column_type aColumnIndex)
@@ -1158,7 +1785,10 @@ namespace neogfx
 
             if (!updating())
             {
-                reset_position_meta(aItemIndex.row());
+                if (iVirtualizedRowExtents)
+                    row_extent_inserted(from_item_model_index(aItemIndex, true).row());
+                else
+                    reset_position_meta(aItemIndex.row());
                 execute_sort();
                 ItemAdded.trigger(from_item_model_index(aItemIndex, true));
             }
@@ -1170,7 +1800,10 @@ namespace neogfx
             if (!updating())
             {
                 reset_row_map();
-                reset_position_meta(aItemIndex.row());
+                if (iVirtualizedRowExtents)
+                    row_extent_changed(from_item_model_index(aItemIndex).row());
+                else
+                    reset_position_meta(aItemIndex.row());
                 execute_sort();
                 auto const index = from_item_model_index(aItemIndex);
                 auto& cellMeta = cell_meta(index);
@@ -1201,7 +1834,10 @@ namespace neogfx
             iRowMap.erase(std::next(iRowMap.begin(), aItemIndex.row()));
             if (!updating())
             {
-                reset_position_meta(index.row());
+                if (iVirtualizedRowExtents)
+                    row_extent_removed(index.row());
+                else
+                    reset_position_meta(index.row());
                 ItemRemoved.trigger(index);
             }
         }
@@ -1319,7 +1955,7 @@ namespace neogfx
             reset_column_meta();
             reset_position_meta(0);
 
-            if (attached())
+            if (attached() && !iVirtualizedRowExtents)
                 for (item_presentation_model_index::row_type row = 0; row < rows(); ++row)
                     for (item_presentation_model_index::column_type col = 0; col < iColumns.size(); ++col)
                         cell_extents(item_presentation_model_index{row, col}, attachment());
@@ -1349,11 +1985,136 @@ namespace neogfx
         }
         void reset_position_meta(item_presentation_model_index::row_type aFromRow) const
         {
+            if (iVirtualizedRowExtents)
+            {
+                reset_row_extents();
+                return;
+            }
             iTotalHeight = std::nullopt;
             iPositions.resize(rows());
             for (std::size_t i = aFromRow; i < iPositions.size(); ++i)
                 iPositions[i] = std::nullopt;
         }
+        // Virtualized row extents: every row starts with an estimated height and a Fenwick tree over the
+        // per-row heights gives positions and hit testing in O(log n); rows are measured when visited.
+        void reset_row_extents() const
+        {
+            iEstimatedRowHeight = std::nullopt;
+            iRowExtentTreeValid = false;
+            iRowExtents.clear();
+            iRowMeasured.clear();
+        }
+        void row_extent_inserted(item_presentation_model_index::row_type aRow) const
+        {
+            if (aRow > iRowExtents.size() || iRowExtents.size() + 1u != rows())
+            {
+                reset_row_extents();
+                return;
+            }
+            if (iRowExtentTreeValid && aRow == iRowExtents.size())
+            {
+                // appending adds tree node n + 1 covering rows (n + 1 - lowbit, n + 1]; no existing node covers it
+                auto const extent = *iEstimatedRowHeight;
+                iRowExtents.push_back(extent);
+                iRowMeasured.push_back(false);
+                auto const node = iRowExtents.size();
+                auto const coveredFrom = node - (node & (~node + 1u));
+                iRowExtentTree.push_back(extent + row_extent_prefix(static_cast<item_presentation_model_index::row_type>(node - 1u)) -
+                    row_extent_prefix(static_cast<item_presentation_model_index::row_type>(coveredFrom)));
+                return;
+            }
+            // an insertion before the end shifts every later row so the tree is rebuilt, without measuring anything
+            iRowExtents.insert(std::next(iRowExtents.begin(), aRow), -1.0);
+            iRowMeasured.insert(std::next(iRowMeasured.begin(), aRow), false);
+            iRowExtentTreeValid = false;
+        }
+        void row_extent_removed(item_presentation_model_index::row_type aRow) const
+        {
+            if (aRow >= iRowExtents.size() || iRowExtents.size() != rows() + 1u)
+            {
+                reset_row_extents();
+                return;
+            }
+            if (iRowExtentTreeValid && aRow + 1u == iRowExtents.size())
+            {
+                // the last row is covered only by the last tree node
+                iRowExtents.pop_back();
+                iRowMeasured.pop_back();
+                iRowExtentTree.pop_back();
+                return;
+            }
+            iRowExtents.erase(std::next(iRowExtents.begin(), aRow));
+            iRowMeasured.erase(std::next(iRowMeasured.begin(), aRow));
+            iRowExtentTreeValid = false;
+        }
+        void row_extent_changed(item_presentation_model_index::row_type aRow) const
+        {
+            // the previous height stands in as the estimate until the row is measured again
+            if (aRow < iRowMeasured.size())
+                iRowMeasured[aRow] = false;
+        }
+        void validate_row_extents(i_units_context const& aUnitsContext) const
+        {
+            if (iRowExtents.size() != rows())
+            {
+                iRowExtents.resize(rows(), -1.0);
+                iRowMeasured.resize(rows(), false);
+                iRowExtentTreeValid = false;
+            }
+            if (iRowExtentTreeValid)
+                return;
+            if (iEstimatedRowHeight == std::nullopt)
+                iEstimatedRowHeight = units_converter(aUnitsContext).from_device_units(size{ 0.0, std::ceil(default_font().height()) }).cy +
+                    cell_padding(aUnitsContext).size().cy + cell_spacing(aUnitsContext).cy;
+            auto const n = iRowExtents.size();
+            iRowExtentTree.assign(n + 1u, 0.0);
+            for (std::size_t i = 0u; i < n; ++i)
+            {
+                if (!iRowMeasured[i] && iRowExtents[i] < 0.0)
+                    iRowExtents[i] = *iEstimatedRowHeight;
+                iRowExtentTree[i + 1u] += iRowExtents[i];
+                auto const parent = (i + 1u) + ((i + 1u) & (~(i + 1u) + 1u));
+                if (parent <= n)
+                    iRowExtentTree[parent] += iRowExtentTree[i + 1u];
+            }
+            iRowExtentTreeValid = true;
+        }
+        void update_row_extent(item_presentation_model_index::row_type aRow, dimension aHeight, i_units_context const& aUnitsContext) const
+        {
+            validate_row_extents(aUnitsContext);
+            if (aRow >= iRowExtents.size())
+                return;
+            iRowMeasured[aRow] = true;
+            auto const delta = aHeight - iRowExtents[aRow];
+            if (delta == 0.0)
+                return;
+            iRowExtents[aRow] = aHeight;
+            for (std::size_t i = aRow + 1u; i < iRowExtentTree.size(); i += (i & (~i + 1u)))
+                iRowExtentTree[i] += delta;
+        }
+        double row_extent_prefix(item_presentation_model_index::row_type aRow) const
+        {
+            double result = 0.0;
+            for (std::size_t i = std::min<std::size_t>(aRow, iRowExtents.size()); i > 0u; i -= (i & (~i + 1u)))
+                result += iRowExtentTree[i];
+            return result;
+        }
+        item_presentation_model_index::row_type row_extent_find(double aPosition) const
+        {
+            // descend the tree for the number of rows whose combined height does not exceed the position
+            auto const n = iRowExtents.size();
+            std::size_t row = 0u;
+            double remaining = aPosition;
+            for (std::size_t step = std::bit_floor(n); step != 0u; step >>= 1u)
+            {
+                if (row + step <= n && iRowExtentTree[row + step] <= remaining)
+                {
+                    row += step;
+                    remaining -= iRowExtentTree[row];
+                }
+            }
+            return static_cast<item_presentation_model_index::row_type>(std::min(row, n - 1u));
+        }
     private:
         const_iterator cbegin() const
         {
@@ -1434,11 +2195,27 @@ namespace neogfx
         mutable std::optional<i_scrollbar::value_type> iTotalHeight;
         mutable neolib::segmented_array<optional_position, 256> iPositions;
         bool iAlternatingRowColor;
+        bool iVirtualizedRowExtents;
+        mutable std::optional<dimension> iEstimatedRowHeight;
+        mutable std::vector<dimension> iRowExtents;
+        mutable std::vector<bool> iRowMeasured;
+        mutable std::vector<double> iRowExtentTree;
+        mutable bool iRowExtentTreeValid = false;
         std::deque<sort_by_param> iSortOrder;
         std::vector<filter> iFilters;
         sink iSink;
         std::uint32_t iUpdating = 0u;
         bool iFiltering = false;
+        mutable std::map<item_model_index::column_type, std::shared_ptr<column_values>> iColumnValues;
+        mutable std::map<item_model_index::column_type, search_index> iSearchIndices;
+        std::uint64_t iRowsRevision = 0u;
+        std::uint64_t iRowPositionsRevision = 0u;
+        bool iSortStale = false;
+        std::optional<background_job<sort_result>> iSortJob;
+        std::optional<background_job<filter_result>> iFilterJob;
+        std::vector<background_job<sort_result>> iAbandonedSortJobs;
+        std::vector<background_job<filter_result>> iAbandonedFilterJobs;
+        std::optional<neolib::callback_timer> iSortFilterPump;
     };
 
     typedef basic_item_presentation_model<item_model> item_presentation_model;
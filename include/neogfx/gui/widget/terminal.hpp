@@ -20,6 +20,7 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <unordered_map>
 #include <neogfx/gui/widget/scrollable_widget.hpp>
 #include <neogfx/gui/widget/cursor.hpp>
 #include <neogfx/gui/widget/i_terminal.hpp>
@@ -50,6 +51,43 @@ namespace neogfx
             mutable optional_glyph_text glyphs;
             std::vector<attribute> attributes;
         };
+        // A code point shaped on its own with a given font; the glyph is empty if the code point has to be shaped
+        // together with its neighbours (emoji and anything that does not map to exactly one glyph).
+        struct cell_glyph
+        {
+            std::optional<glyph_char> glyph;
+            bool extendsCluster = false; // attaches to the preceding code point (combining marks, joiners, selectors)
+        };
+        // Fixed capacity ring of lines: once full, adding a line reuses the oldest so scrolling is O(1) however
+        // much scrollback is kept; lines are inserted and erased by moving the lines between the index and the
+        // end, which for screen edits is at most the height of the terminal.
+        class line_buffer
+        {
+        public:
+            line_buffer(std::size_t aCapacity = 250u);
+        public:
+            std::size_t size() const;
+            bool empty() const;
+            std::size_t capacity() const;
+            void set_capacity(std::size_t aCapacity);
+            buffer_line const& operator[](std::size_t aIndex) const;
+            buffer_line& operator[](std::size_t aIndex);
+            buffer_line& back();
+            buffer_line& emplace_back();
+            buffer_line& insert(std::size_t aIndex);
+            void erase(std::size_t aIndex);
+            void erase(std::size_t aFirst, std::size_t aLast);
+            void pop_front(std::size_t aCount = 1u);
+            void clear();
+        private:
+            std::size_t physical(std::size_t aIndex) const;
+            void linearize();
+        private:
+            std::vector<buffer_line> iLines;
+            std::size_t iHead = 0u;
+            std::size_t iSize = 0u;
+            std::size_t iCapacity;
+        };
         struct scrolling_region { coordinate_type top; coordinate_type bottom; };
         enum class character_set
         {
@@ -66,7 +104,7 @@ namespace neogfx
         {
             point_type bufferOrigin;
             std::optional<point_type> cursorPos;
-            std::vector<buffer_line> lines;
+            line_buffer lines;
             coordinate_type defaultTabStop = 8;
             std::optional<attribute> attribute;
             bool originMode = true;
@@ -117,6 +155,8 @@ namespace neogfx
         bool text_input(i_string const& aText) override;
     public:
         size_type terminal_size() const final;
+        dimension_type scrollback_limit() const final;
+        void set_scrollback_limit(dimension_type aLines) final;
     public:
         void output(i_string const& aOutput) final;
         neogfx::cursor& cursor() const;
@@ -134,11 +174,14 @@ namespace neogfx
         attribute active_attribute() const;
         size character_extents() const;
         void animate();
+        cell_glyph const& shape_cell(i_graphics_context const& aGc, neogfx::font const& aFont, char32_t aCharacter) const;
+        glyph_text shape_line(i_graphics_context const& aGc, buffer_line const& aLine) const;
         void erase_in_display(point_type const& aBufferPosStart, point_type const& aBufferPosEnd);
         char32_t to_unicode(char32_t aCharacter) const;
         buffer_line& line(coordinate_type aLine);
         char32_t& character(point_type const& aBufferPos);
         void output_character(char32_t aCharacter, std::optional<attribute> const& aAttribute = {});
+        void output_run(std::u32string_view aRun);
         point_type buffer_origin() const;
         void set_buffer_origin(point_type aBufferOrigin);
         point_type buffer_pos() const;
@@ -157,12 +200,15 @@ namespace neogfx
         mutable optional_font iItalicFont;
         mutable optional_font iBoldItalicFont;
         mutable optional_size iCharacterExtents;
+        mutable std::unordered_map<std::uint64_t, cell_glyph> iCellGlyphs;
+        mutable std::optional<std::pair<bool, logical_coordinate_system>> iCellGlyphsRendering;
         optional_text_format iTextFormat;
         buffer iPrimaryBuffer = {};
         buffer iAlternateBuffer = {};
         buffer* iActiveBuffer = &iPrimaryBuffer;
         std::optional<std::string> iEscapeSequence;
         mutable bool iOutputting = false;
+        bool iUpdatePending = false;
         uint64_t iCursorAnimationStartTime;
         widget_timer iAnimator;
         sink iSink;
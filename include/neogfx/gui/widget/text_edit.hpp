@@ -330,6 +330,7 @@ namespace neogfx
             glyph_paragraph_index, 
             boost::fast_pool_allocator<std::pair<glyph_paragraph, const glyph_paragraph_index>, boost::default_user_allocator_new_delete, boost::details::pool::null_mutex>> glyph_paragraphs;
 
+        struct paragraph_line;
         struct glyph_line;
         typedef std::vector<glyph_line> glyph_lines;
 
@@ -338,8 +339,28 @@ namespace neogfx
 
         struct position_info;
 
+        struct paragraph_shaping;
+
     private:
         class dragger;
+        // the paragraphs an edit reshaped, from refresh_edited_paragraphs to refresh_lines
+        struct lines_edit
+        {
+            glyph_paragraphs::iterator tail;
+            glyph_paragraphs::size_type paragraphs;
+            document_glyphs::size_type glyphStart;
+            document_glyphs::size_type oldGlyphEnd;
+            document_glyphs::size_type newGlyphEnd;
+        };
+        // what the current lines were laid out for
+        struct lines_layout
+        {
+            rect columnRect;
+            bool verticalScrollbar;
+            bool horizontalScrollbar;
+            bool wordWrap;
+            size extents;
+        };
 
     public:
         typedef document_text::size_type position_type;
@@ -488,6 +509,7 @@ namespace neogfx
         void set_tab_stops(std::optional<neogfx::tab_stops> const& aTabStops);
     public:
         position_type document_hit_test(const point& aPosition, bool aAdjustForScrollPosition = true) const;
+        uint32_t lines_visited_by_last_paint() const;
         virtual bool same_word(position_type aTextPositionLeft, position_type aTextPositionRight) const;
         virtual std::pair<position_type, position_type> word_at(position_type aTextPosition, bool aWordBreakIsWhitespace = false) const;
     public:
@@ -517,14 +539,20 @@ namespace neogfx
         document_glyphs::const_iterator to_glyph(document_text::const_iterator aWhere) const;
         std::pair<document_text::size_type, document_text::size_type> from_glyph(document_glyphs::const_iterator aWhere) const;
         void refresh_paragraph(document_text::const_iterator aWhere, ptrdiff_t aDelta);
+        bool refresh_edited_paragraphs(i_graphics_context const& aGc, document_text::const_iterator aWhere, ptrdiff_t aDelta);
+        void shape_paragraphs(i_graphics_context const& aGc, document_text::size_type aTextBegin, document_text::size_type aTextEnd, std::vector<paragraph_shaping>& aParagraphs) const;
+        document_glyphs::size_type insert_paragraph(glyph_paragraphs::const_iterator aBefore, document_glyphs::size_type aGlyphPos, paragraph_shaping const& aParagraph);
         void refresh_columns();
         void refresh_lines();
+        bool refresh_edited_lines(lines_edit const& aEdit);
+        coordinate layout_paragraph_lines(glyph_paragraphs::iterator aParagraph, glyph_column const& aColumn, dimension aAvailableWidth, coordinate aTop, glyph_lines& aLines, dimension& aWidth);
+        coordinate layout_paragraph(glyph_paragraph& aParagraph, style const& aParagraphStyle, dimension aAvailableWidth, bool aLastParagraph, std::vector<paragraph_line>& aLines);
         void animate();
         void update_cursor();
         void make_cursor_visible(bool aForcePreviewScroll = false);
         void make_visible(position_info const& aGlyphPosition, point const& aPreview = {});
         style glyph_style(document_glyphs::const_iterator aGlyphChar, const glyph_column& aColumn) const;
-        void draw_glyphs(i_graphics_context const& aGc, const point& aPosition, const glyph_column& aColumn, glyph_lines::const_iterator aLine) const;
+        void draw_glyphs(i_graphics_context const& aGc, const point& aPosition, const rect& aVisibleRect, const glyph_column& aColumn, glyph_lines::const_iterator aLine) const;
         void draw_cursor(i_graphics_context const& aGc) const;
         rect cursor_rect() const;
         double calc_padding_adjust(style const& aStyle) const;
@@ -548,6 +576,8 @@ namespace neogfx
         glyph_paragraphs iGlyphParagraphs;
         glyph_columns iGlyphColumns;
         optional_size iTextExtents;
+        std::optional<lines_layout> iLinesLayout;
+        std::optional<lines_edit> iLinesEdit;
         uint64_t iCursorAnimationStartTime;
         typedef std::pair<position_type, position_type> find_span;
         typedef std::map<
@@ -573,6 +603,7 @@ namespace neogfx
         std::optional<std::pair<text_edit::position_type, text_edit::position_type>> iSelectedUri;
         std::optional<password_bits> iPasswordBits;
         bool iOutOfMemory;
+        mutable uint32_t iLinesVisited;
     public:
         define_property(property_category::other, bool, ReadOnly, read_only, false)
         define_property(property_category::other, bool, WordWrap, word_wrap, (iCaps & text_edit_caps::MultiLine) == text_edit_caps::MultiLine)
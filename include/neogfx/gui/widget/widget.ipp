@@ -1166,6 +1166,8 @@ namespace neogfx
     template <typename Interface>
     bool widget<Interface>::requires_update() const
     {
+        // while rendering, invalidated_area() is the current pass rect; a parent fills the whole of it so every
+        // widget it touches must paint, not only those touching the raw damage
         return surface().has_invalidated_area() && !surface().invalidated_area().intersection(non_client_rect()).empty();
     }
 
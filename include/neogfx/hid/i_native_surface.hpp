@@ -23,6 +23,7 @@
 #include <neogfx/hid/mouse.hpp>
 #include <neogfx/core/event.hpp>
 #include <neogfx/core/i_property.hpp>
+#include <neogfx/core/region.hpp>
 #include <neogfx/gfx/i_graphics_context.hpp>
 #include <neogfx/gfx/i_render_target.hpp>
 
@@ -32,6 +33,15 @@ namespace neogfx
     class i_rendering_context;
     class i_widget;
 
+    struct damage_statistics
+    {
+        uint32_t rects;
+        uint64_t pixels;
+        uint64_t boundingPixels;
+        uint32_t renderPasses;
+        uint64_t renderedPixels;
+    };
+
     class i_native_surface : public i_render_target, public i_property_owner, public i_reference_counted
     {
     public:
@@ -49,7 +59,9 @@ namespace neogfx
         virtual void invalidate(const rect& aInvalidatedRect) = 0;
         virtual bool has_invalidated_area() const = 0;
         virtual const rect& invalidated_area() const = 0;
+        virtual const region& invalidated_region() const = 0;
         virtual rect validate() = 0;
+        virtual damage_statistics const& last_frame_damage() const = 0;
         virtual bool can_render() const = 0;
         virtual void render(bool aOOBRequest = false) = 0;
         virtual void pause() = 0;
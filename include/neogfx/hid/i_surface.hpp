@@ -92,6 +92,7 @@ namespace neogfx
         virtual void invalidate_surface(const rect& aInvalidatedRect, bool aInternal = true) = 0;
         virtual bool has_invalidated_area() const = 0;
         virtual const rect& invalidated_area() const = 0;
+        virtual const region& invalidated_region() const = 0;
         virtual rect validate() = 0;
         virtual double rendering_priority() const = 0;
         virtual void render_surface() = 0;
@@ -78,6 +78,7 @@ namespace neogfx
         void invalidate_surface(const rect& aInvalidatedRect, bool aInternal = true) final;
         bool has_invalidated_area() const final;
         const rect& invalidated_area() const final;
+        const region& invalidated_region() const final;
         rect validate() final;
         double rendering_priority() const final;
         void render_surface() final;
@@ -34,7 +34,8 @@ namespace neogfx::game
 {
     animator::animator(game::i_ecs& aEcs) :
         system<entity_info, animation_filter, mesh_renderer, mesh_render_cache>{ aEcs },
-        iLock{ aEcs, neolib::ecs::dont_lock }
+        iLock{ aEcs, neolib::ecs::dont_lock },
+        iLiveFilters{ aEcs }
     {
         Animate.set_trigger_type(neolib::trigger_type::SynchronousDontQueue);
         start_thread_if();
@@ -79,14 +80,13 @@ namespace neogfx::game
         auto& cache = ecs().component<mesh_render_cache>();
         auto const& worldClock = ecs().shared_component<game::clock>()[0];
 
-        for (auto entity : filters.entities())
+        iLiveFilters.refresh();
+        for (auto const& live : iLiveFilters)
         {
-            auto const& info = infos.entity_record(entity);
-            if (info.destroyed)
-                continue;
-            auto& filter = filters.entity_record(entity);
+            auto const entity = live.entity;
+            auto& filter = filters.component_data()[live.index];
             if (!filter.currentFrameStartTime)
-                filter.currentFrameStartTime = info.creationTime;
+                filter.currentFrameStartTime = infos.entity_record(entity).creationTime;
             auto const& frames = (filter.animation ? filter.animation->frames : filter.sharedAnimation.ptr->frames);
             while (*filter.currentFrameStartTime + to_step_time(frames[filter.currentFrame].duration, worldClock.timestep) < now)
             {
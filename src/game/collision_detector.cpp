@@ -18,6 +18,8 @@
 */
 
 #include <neogfx/neogfx.hpp>
+#include <numeric>
+#include <execution>
 #include <neogfx/core/async_thread.hpp>
 #include <neogfx/game/ecs.hpp>
 #include <neogfx/game/ecs_helpers.hpp>
@@ -27,11 +29,108 @@
 
 namespace neogfx::game
 {
+    namespace
+    {
+        std::size_t constexpr COLLIDER_BATCH_SIZE = 256u;
+
+        // Recomputes the AABBs of colliders whose rigid body, mesh filter or animation filter inputs have changed
+        // since the last cycle; the work is sharded across threads as each collider is only written by one batch.
+        template <typename Collider, typename Inputs>
+        uint32_t update_colliders(i_ecs& aEcs, live_entity_view<Collider>& aLiveColliders, std::unordered_map<entity_id, Inputs>& aInputs, uint32_t aGeneration)
+        {
+            auto const& meshFilters = aEcs.component<mesh_filter>();
+            auto const& animatedMeshFilters = aEcs.component<animation_filter>();
+            auto const& rigidBodies = aEcs.component<rigid_body>();
+            auto& colliders = aEcs.component<Collider>();
+
+            std::vector<std::pair<entity_id, Inputs*>> work;
+            work.reserve(aInputs.size());
+            aLiveColliders.refresh();
+            for (auto const& live : aLiveColliders)
+            {
+                auto& inputs = aInputs[live.entity];
+                inputs.generation = aGeneration;
+                work.emplace_back(live.entity, &inputs);
+            }
+            if (work.size() != aInputs.size())
+                std::erase_if(aInputs, [&](auto const& aEntry) { return aEntry.second.generation != aGeneration; });
+
+            std::vector<std::size_t> batches((work.size() + COLLIDER_BATCH_SIZE - 1u) / COLLIDER_BATCH_SIZE);
+            std::iota(batches.begin(), batches.end(), 0u);
+
+            std::atomic<uint32_t> updated = 0u;
+            std::for_each(std::execution::par, batches.begin(), batches.end(), [&](std::size_t aBatch)
+            {
+                uint32_t batchUpdated = 0u;
+                auto const first = aBatch * COLLIDER_BATCH_SIZE;
+                auto const last = std::min(first + COLLIDER_BATCH_SIZE, work.size());
+                for (auto index = first; index < last; ++index)
+                {
+                    auto const entity = work[index].first;
+                    auto& previousInputs = *work[index].second;
+                    auto const hasAnimation = animatedMeshFilters.has_entity_record_no_lock(entity);
+                    auto const hasRigidBody = rigidBodies.has_entity_record_no_lock(entity);
+                    auto const& meshFilter = meshFilters.has_entity_record_no_lock(entity) ?
+                        meshFilters.entity_record_no_lock(entity) : current_animation_frame(animatedMeshFilters.entity_record_no_lock(entity));
+                    Inputs inputs;
+                    inputs.generation = aGeneration;
+                    inputs.meshFilter = &meshFilter;
+                    inputs.meshFilterTransformation = meshFilter.transformation;
+                    if (hasAnimation)
+                        inputs.animationTransformation = animatedMeshFilters.entity_record_no_lock(entity).transformation;
+                    if (hasRigidBody)
+                    {
+                        auto const& rigidBody = rigidBodies.entity_record_no_lock(entity);
+                        inputs.position = rigidBody.position;
+                        inputs.angle = rigidBody.angle.z;
+                    }
+                    auto& collider = colliders.entity_record_no_lock(entity);
+                    collider.previousAabb = collider.currentAabb;
+                    if (collider.currentAabb && previousInputs.same_as(inputs))
+                        continue;
+                    previousInputs = inputs;
+                    auto const& untransformed = (meshFilter.mesh != std::nullopt ?
+                        *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
+                    if (!collider.untransformedAabb)
+                    {
+                        if constexpr (std::is_same_v<Collider, box_collider_2d>)
+                            collider.untransformedAabb = to_aabb_2d(untransformed.vertices);
+                        else
+                            collider.untransformedAabb = to_aabb(untransformed.vertices);
+                    }
+                    collider.currentAabb = aabb_transform(*collider.untransformedAabb,
+                        (hasAnimation ?
+                            to_transformation_matrix(animatedMeshFilters.entity_record_no_lock(entity)) : mat44::identity()),
+                        (meshFilter.transformation ?
+                            *meshFilter.transformation : mat44::identity()),
+                        (hasRigidBody ?
+                            to_transformation_matrix(rigidBodies.entity_record_no_lock(entity)) : mat44::identity()));
+                    if (!collider.previousAabb)
+                        collider.previousAabb = collider.currentAabb;
+                    ++batchUpdated;
+                }
+                updated += batchUpdated;
+            });
+            return updated;
+        }
+    }
+
     collision_detector::collision_detector(i_ecs& aEcs) :
         system<entity_info, box_collider, box_collider_2d>{ aEcs },
         iBroadphaseTree{ aEcs },
         iBroadphase2dTree{ aEcs },
-        iCollidersUpdated{ false }
+        iBroadphaseHash{ aEcs },
+        iBroadphase2dHash{ aEcs },
+        iBroadphaseSweep{ aEcs },
+        iBroadphase2dSweep{ aEcs },
+        iStrategy{ broadphase_strategy::Tree },
+        iCollidersUpdated{ false },
+        iLiveColliders{ aEcs },
+        iLiveColliders2d{ aEcs },
+        iColliderGeneration{ 0 },
+        iColliderUpdateCount{ 0 },
+        iTreesUpdated{ false },
+        iUpdateMode{ broadphase_update_mode::Full }
     {
         Collision.set_trigger_type(neolib::trigger_type::SynchronousDontQueue);
         start_thread_if();
@@ -58,7 +157,18 @@ namespace neogfx::game
             scoped_component_lock<entity_info, box_collider> lock{ ecs() };
             thread_local std::vector<entity_id> hits;
             hits.clear();
-            iBroadphaseTree.pick(aPoint, hits);
+            switch (broadphase())
+            {
+            case broadphase_strategy::Tree:
+                iBroadphaseTree.pick(aPoint, hits);
+                break;
+            case broadphase_strategy::SpatialHash:
+                iBroadphaseHash.pick(aPoint, hits);
+                break;
+            case broadphase_strategy::SweepAndPrune:
+                iBroadphaseSweep.pick(aPoint, hits);
+                break;
+            }
             if (!hits.empty())
                 return hits[0];
         }
@@ -68,7 +178,18 @@ namespace neogfx::game
             scoped_component_lock<entity_info, box_collider_2d> lock{ ecs() };
             thread_local std::vector<entity_id> hits;
             hits.clear();
-            iBroadphase2dTree.pick(aPoint.xy, hits);
+            switch (broadphase())
+            {
+            case broadphase_strategy::Tree:
+                iBroadphase2dTree.pick(aPoint.xy, hits);
+                break;
+            case broadphase_strategy::SpatialHash:
+                iBroadphase2dHash.pick(aPoint.xy, hits);
+                break;
+            case broadphase_strategy::SweepAndPrune:
+                iBroadphase2dSweep.pick(aPoint.xy, hits);
+                break;
+            }
             if (!hits.empty())
                 return hits[0];
         }
@@ -107,114 +228,152 @@ namespace neogfx::game
 
     void collision_detector::update_colliders()
     {
+        if (++iColliderGeneration == 0)
+            iColliderGeneration = 1;
+        iColliderUpdateCount = 0;
+
         if (ecs().component_instantiated<box_collider>())
         {
             scoped_component_lock<entity_info, box_collider, mesh_filter, animation_filter, rigid_body> lock{ ecs() };
-            auto const& meshFilters = ecs().component<mesh_filter>();
-            auto const& animatedMeshFilters = ecs().component<animation_filter>();
-            auto const& rigidBodies = ecs().component<rigid_body>();
-            auto& boxColliders = ecs().component<box_collider>();
-            for (auto entity : boxColliders.entities())
-            {
-                auto const& info = ecs().component<entity_info>().entity_record(entity);
-                if (info.destroyed)
-                    continue; // todo: add support for skip iterators
-                // todo: only update collider AABBs if rigid_body changes require it
-                auto const& meshFilter = meshFilters.has_entity_record(entity) ?
-                    meshFilters.entity_record(entity) : current_animation_frame(animatedMeshFilters.entity_record(entity));
-                auto& collider = boxColliders.entity_record(entity);
-                collider.previousAabb = collider.currentAabb;
-                auto const& untransformed = (meshFilter.mesh != std::nullopt ?
-                    *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
-                if (!collider.untransformedAabb)
-                    collider.untransformedAabb = to_aabb(untransformed.vertices);
-                collider.currentAabb = aabb_transform(*collider.untransformedAabb,
-                    (animatedMeshFilters.has_entity_record(entity) ?
-                        to_transformation_matrix(animatedMeshFilters.entity_record(entity)) : mat44::identity()),
-                    (meshFilter.transformation ?
-                        *meshFilter.transformation : mat44::identity()),
-                    (rigidBodies.has_entity_record(entity) ?
-                        to_transformation_matrix(rigidBodies.entity_record(entity)) : mat44::identity()));
-                if (!collider.previousAabb)
-                    collider.previousAabb = collider.currentAabb;
-            }
+            iColliderUpdateCount += update_colliders<box_collider>(ecs(), iLiveColliders, iColliderInputs, iColliderGeneration);
         }
 
         if (ecs().component_instantiated<box_collider_2d>())
         {
             scoped_component_lock<entity_info, box_collider_2d, mesh_filter, animation_filter, rigid_body> lock{ ecs() };
-            auto const& meshFilters = ecs().component<mesh_filter>();
-            auto const& animatedMeshFilters = ecs().component<animation_filter>();
-            auto const& rigidBodies = ecs().component<rigid_body>();
-            auto& boxColliders2d = ecs().component<box_collider_2d>();
-            for (auto entity : boxColliders2d.entities())
-            {
-                auto const& info = ecs().component<entity_info>().entity_record(entity);
-                if (info.destroyed)
-                    continue; // todo: add support for skip iterators
-                // todo: only update collider AABBs if rigid_body changes require it
-                auto const& meshFilter = meshFilters.has_entity_record(entity) ?
-                    meshFilters.entity_record(entity) : current_animation_frame(animatedMeshFilters.entity_record(entity));
-                auto& collider = boxColliders2d.entity_record(entity);
-                collider.previousAabb = collider.currentAabb;
-                auto const& untransformed = (meshFilter.mesh != std::nullopt ?
-                    *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
-                if (!collider.untransformedAabb)
-                    collider.untransformedAabb = to_aabb_2d(untransformed.vertices);
-                collider.currentAabb = aabb_transform(*collider.untransformedAabb, 
-                    (animatedMeshFilters.has_entity_record(entity) ?
-                        to_transformation_matrix(animatedMeshFilters.entity_record(entity)) : mat44::identity()),
-                    (meshFilter.transformation ?
-                        *meshFilter.transformation : mat44::identity()),
-                    (rigidBodies.has_entity_record(entity) ?
-                        to_transformation_matrix(rigidBodies.entity_record(entity)) : mat44::identity()));
-                if (!collider.previousAabb)
-                    collider.previousAabb = collider.currentAabb;
-            }
+            iColliderUpdateCount += update_colliders<box_collider_2d>(ecs(), iLiveColliders2d, iCollider2dInputs, iColliderGeneration);
         }
 
         iCollidersUpdated = true;
+        iTreesUpdated = false;
     }
 
     void collision_detector::update_trees()
     {
+        bool const incremental = (update_mode() == broadphase_update_mode::Incremental);
+
         if (ecs().component_instantiated<box_collider>())
         {
             scoped_component_lock<entity_info, box_collider> lock{ ecs() };
-            iBroadphaseTree.full_update();
+            switch (broadphase())
+            {
+            case broadphase_strategy::Tree:
+                if (incremental)
+                    iBroadphaseTree.incremental_update();
+                else
+                    iBroadphaseTree.full_update();
+                break;
+            case broadphase_strategy::SpatialHash:
+                iBroadphaseHash.full_update();
+                break;
+            case broadphase_strategy::SweepAndPrune:
+                iBroadphaseSweep.full_update();
+                break;
+            }
         }
 
         if (ecs().component_instantiated<box_collider_2d>())
         {
             scoped_component_lock<entity_info, box_collider_2d> lock{ ecs() };
-            iBroadphase2dTree.full_update();
+            switch (broadphase())
+            {
+            case broadphase_strategy::Tree:
+                if (incremental)
+                    iBroadphase2dTree.incremental_update();
+                else
+                    iBroadphase2dTree.full_update();
+                break;
+            case broadphase_strategy::SpatialHash:
+                iBroadphase2dHash.full_update();
+                break;
+            case broadphase_strategy::SweepAndPrune:
+                iBroadphase2dSweep.full_update();
+                break;
+            }
         }
+
+        iTreesUpdated = true;
     }
 
     void collision_detector::detect_collisions()
     {
+        if (!iTreesUpdated)
+            update_trees();
+
         if (ecs().component_instantiated<box_collider>())
         {
             scoped_component_lock<entity_info, box_collider> lock{ ecs() };
-            iBroadphaseTree.collisions([this](entity_id e1, entity_id e2)
+            auto const collision = [this](entity_id e1, entity_id e2)
             {
                 Collision.trigger(e1, e2);
-            });
+            };
+            switch (broadphase())
+            {
+            case broadphase_strategy::Tree:
+                iBroadphaseTree.collisions(collision);
+                break;
+            case broadphase_strategy::SpatialHash:
+                iBroadphaseHash.collisions(collision);
+                break;
+            case broadphase_strategy::SweepAndPrune:
+                iBroadphaseSweep.collisions(collision);
+                break;
+            }
         }
 
         if (ecs().component_instantiated<box_collider_2d>())
         {
             scoped_component_lock<entity_info, box_collider_2d> lock{ ecs() };
-            iBroadphase2dTree.full_update();
-            iBroadphase2dTree.collisions([this](entity_id e1, entity_id e2)
+            auto const collision = [this](entity_id e1, entity_id e2)
             {
                 Collision.trigger(e1, e2);
-            });
+            };
+            switch (broadphase())
+            {
+            case broadphase_strategy::Tree:
+                iBroadphase2dTree.collisions(collision);
+                break;
+            case broadphase_strategy::SpatialHash:
+                iBroadphase2dHash.collisions(collision);
+                break;
+            case broadphase_strategy::SweepAndPrune:
+                iBroadphase2dSweep.collisions(collision);
+                break;
+            }
         }
 
         iCollidersUpdated = false;
     }
 
+    uint32_t collision_detector::last_collider_update_count() const
+    {
+        return iColliderUpdateCount;
+    }
+
+    broadphase_strategy collision_detector::broadphase() const
+    {
+        return iStrategy;
+    }
+
+    void collision_detector::set_broadphase(broadphase_strategy aStrategy)
+    {
+        if (iStrategy != aStrategy)
+        {
+            iStrategy = aStrategy;
+            iTreesUpdated = false;
+        }
+    }
+
+    broadphase_update_mode collision_detector::update_mode() const
+    {
+        return iUpdateMode;
+    }
+
+    void collision_detector::set_update_mode(broadphase_update_mode aMode)
+    {
+        iUpdateMode = aMode;
+    }
+
     const aabb_octree<box_collider>& collision_detector::broadphase_tree() const
     {
         return iBroadphaseTree;
@@ -27,13 +27,17 @@
 #include <neogfx/game/animator.hpp>
 #include <neogfx/game/time.hpp>
 #include <neogfx/game/mesh_render_cache.hpp>
+#include <neogfx/game/mesh_renderer.hpp>
 #include <neogfx/gfx/i_rendering_engine.hpp>
 
 namespace neogfx
 {
     namespace game
     {
-        ecs::ecs(ecs_flags aCreationFlags) : base_type{ aCreationFlags }
+        ecs::ecs(ecs_flags aCreationFlags) :
+            base_type{ aCreationFlags },
+            iDestructionSequence{ 0u },
+            iReorderSequence{ 0u }
         {
             service<i_rendering_engine>().allocate_vertex_buffer(*this, vertex_buffer_type::DefaultECS);
         }
@@ -59,11 +63,54 @@ namespace neogfx
             if (component<mesh_render_cache>().has_entity_record(aEntityId) && service<i_rendering_engine>().vertex_buffer_allocated(*this))
             {
                 auto const& cacheEntry = component<mesh_render_cache>().entity_record(aEntityId);
-                service<i_rendering_engine>().vertex_buffer(*this).reclaim(cacheEntry.meshVertexArrayIndices[0], cacheEntry.meshVertexArrayIndices[1]);
-                for (auto& indices : cacheEntry.patchVertexArrayIndices)
-                    service<i_rendering_engine>().vertex_buffer(*this).reclaim(indices[0], indices[1]);
+                auto& vertexBuffer = service<i_rendering_engine>().vertex_buffer(*this);
+                // vertices from before the buffer was last emptied are not this entity's to give back
+                if (cacheEntry.state != cache_state::Invalid && cacheEntry.generation == vertexBuffer.generation())
+                {
+                    vertexBuffer.reclaim(cacheEntry.meshVertexArrayIndices[0], cacheEntry.meshVertexArrayIndices[1]);
+                    for (auto& indices : cacheEntry.patchVertexArrayIndices)
+                        vertexBuffer.reclaim(indices[0], indices[1]);
+                }
             }
+            iRenderIndex.remove(aEntityId);
+            std::optional<std::size_t> renderers;
+            if (component_registered<mesh_renderer>())
+                renderers = component<mesh_renderer>().entities().size();
             base_type::destroy_entity(aEntityId, aNotify);
+            // a destroyed renderer has already left the render index so it must not force the index to be rebuilt
+            if (renderers && iRenderIndex.source_count() == *renderers)
+                iRenderIndex.set_source_count(component<mesh_renderer>().entities().size());
+            std::scoped_lock<std::mutex> journalLock{ iDestructionJournalMutex };
+            iDestructionJournal.push_back(aEntityId);
+            if (iDestructionJournal.size() > DestructionJournalCapacity)
+                iDestructionJournal.pop_front();
+            ++iDestructionSequence;
+        }
+
+        uint64_t ecs::destruction_sequence() const
+        {
+            return iDestructionSequence;
+        }
+
+        bool ecs::destroyed_entities(uint64_t& aCursor, std::vector<entity_id>& aDestroyed) const
+        {
+            std::scoped_lock<std::mutex> journalLock{ iDestructionJournalMutex };
+            auto const first = iDestructionSequence - iDestructionJournal.size();
+            bool const covered = (aCursor >= first && aCursor <= iDestructionSequence);
+            if (covered)
+                aDestroyed.insert(aDestroyed.end(), std::next(iDestructionJournal.begin(), aCursor - first), iDestructionJournal.end());
+            aCursor = iDestructionSequence;
+            return covered;
+        }
+
+        uint64_t ecs::reorder_sequence() const
+        {
+            return iReorderSequence;
+        }
+
+        void ecs::component_reordered()
+        {
+            ++iReorderSequence;
         }
 
         bool ecs::cacheable() const
@@ -80,5 +127,25 @@ namespace neogfx
         {
             return component<game::mesh_render_cache>();
         }
+
+        const game::mesh_render_index& ecs::render_index() const
+        {
+            return iRenderIndex;
+        }
+
+        game::mesh_render_index& ecs::render_index()
+        {
+            return iRenderIndex;
+        }
+
+        const entity_culling_statistics& ecs::culling_statistics() const
+        {
+            return iCullingStatistics;
+        }
+
+        entity_culling_statistics& ecs::culling_statistics()
+        {
+            return iCullingStatistics;
+        }
     }
 }
\ No newline at end of file
@@ -18,6 +18,8 @@
 */
 
 #include <neogfx/neogfx.hpp>
+#include <numeric>
+#include <execution>
 #include <neogfx/core/async_thread.hpp>
 #include <neogfx/game/ecs.hpp>
 #include <neogfx/game/entity_info.hpp>
@@ -29,11 +31,69 @@
 #include <neogfx/game/simple_physics.hpp>
 #include <neogfx/game/time.hpp>
 #include <neogfx/game/physics.hpp>
+#include <neogfx/game/barnes_hut_tree.hpp>
 
 namespace neogfx::game
 {
+    namespace
+    {
+        std::size_t constexpr INTEGRATION_BATCH_SIZE = 1024u;
+
+        inline vec3 direct_field(scalar aX, scalar aY, scalar aZ, const scalar* aSourceX, const scalar* aSourceY, const scalar* aSourceZ, const scalar* aSourceMass, std::size_t aSourceCount)
+        {
+            scalar fieldX = 0.0, fieldY = 0.0, fieldZ = 0.0;
+            for (std::size_t j = 0; j < aSourceCount; ++j)
+            {
+                scalar const dx = aX - aSourceX[j];
+                scalar const dy = aY - aSourceY[j];
+                scalar const dz = aZ - aSourceZ[j];
+                scalar const r2 = dx * dx + dy * dy + dz * dz;
+                if (r2 > 0.0) // avoid division by zero or rigidBody1 == rigidBody2
+                {
+                    scalar const k = aSourceMass[j] / (r2 * std::sqrt(r2));
+                    fieldX += dx * k;
+                    fieldY += dy * k;
+                    fieldZ += dz * k;
+                }
+            }
+            return vec3{ fieldX, fieldY, fieldZ };
+        }
+    }
+
+    // Struct-of-arrays snapshot of the live rigid bodies taken at the start of each step.
+    struct simple_physics::integration_data
+    {
+        std::vector<rigid_body*> bodies;
+        std::vector<entity_id> entities;
+        std::vector<scalar> positionX;
+        std::vector<scalar> positionY;
+        std::vector<scalar> positionZ;
+        std::vector<scalar> sourceX;
+        std::vector<scalar> sourceY;
+        std::vector<scalar> sourceZ;
+        std::vector<scalar> sourceMass;
+        std::vector<uint8_t> moved;
+        std::vector<std::size_t> batches;
+        barnes_hut_tree tree;
+
+        void clear()
+        {
+            bodies.clear();
+            entities.clear();
+            positionX.clear();
+            positionY.clear();
+            positionZ.clear();
+            sourceX.clear();
+            sourceY.clear();
+            sourceZ.clear();
+            sourceMass.clear();
+        }
+    };
+
     simple_physics::simple_physics(i_ecs& aEcs) :
-        system<entity_info, box_collider, box_collider_2d, mesh_filter, rigid_body, mesh_render_cache>{ aEcs }
+        system<entity_info, box_collider, box_collider_2d, mesh_filter, rigid_body, mesh_render_cache>{ aEcs },
+        iLiveRigidBodies{ aEcs },
+        iIntegrationData{ std::make_unique<integration_data>() }
     {
         if (!ecs().shared_component_registered<physics>())
             ecs().register_shared_component<physics>();
@@ -91,44 +151,54 @@ namespace neogfx::game
             ecs().system<game_world>().ApplyingPhysics.trigger(worldClock.time);
             start_update(2);
             bool useUniversalGravitation = (universal_gravitation_enabled() && physicalConstants.gravitationalConstant != 0.0);
-            if (useUniversalGravitation)
-                rigidBodies.sort([](const rigid_body& lhs, const rigid_body& rhs) { return lhs.mass > rhs.mass; });
-            auto firstMassless = useUniversalGravitation ?
-                std::find_if(rigidBodies.component_data().begin(), rigidBodies.component_data().end(), [](const rigid_body& body) { return body.mass == 0.0; }) :
-                rigidBodies.component_data().begin();
-            for (auto& rigidBody1 : rigidBodies.component_data())
+            if (parallel_integration_enabled())
+                integrate_parallel(from_step_time(nextTime - worldClock.time), uniformGravity, 
+                    useUniversalGravitation ? physicalConstants.gravitationalConstant : 0.0);
+            else
             {
-                auto entity1 = rigidBodies.entity(rigidBody1);
-                auto const& entity1Info = ecs().component<entity_info>().entity_record(entity1);
-                if (entity1Info.destroyed)
-                    continue; // todo: add support for skip iterators
-                vec3 totalForce = rigidBody1.mass * uniformGravity;
-                if (useUniversalGravitation)
+                auto const byMass = [](const rigid_body& lhs, const rigid_body& rhs) { return lhs.mass > rhs.mass; };
+                if (useUniversalGravitation && !std::is_sorted(rigidBodies.component_data().begin(), rigidBodies.component_data().end(), byMass))
+                {
+                    rigidBodies.sort(byMass);
+                    if (auto gameEcs = dynamic_cast<game::ecs*>(&ecs()))
+                        gameEcs->component_reordered();
+                    else
+                        iLiveRigidBodies.invalidate();
+                }
+                iLiveRigidBodies.refresh();
+                auto& bodies = rigidBodies.component_data();
+                auto const firstMassless = useUniversalGravitation ?
+                    static_cast<uint32_t>(std::find_if(bodies.begin(), bodies.end(), [](const rigid_body& body) { return body.mass == 0.0; }) - bodies.begin()) : 0u;
+                for (auto const& live1 : iLiveRigidBodies)
                 {
-                    for (auto iterRigidBody2 = rigidBodies.component_data().begin(); iterRigidBody2 != firstMassless; ++iterRigidBody2)
+                    auto& rigidBody1 = bodies[live1.index];
+                    auto entity1 = live1.entity;
+                    vec3 totalForce = rigidBody1.mass * uniformGravity;
+                    if (useUniversalGravitation)
                     {
-                        auto& rigidBody2 = *iterRigidBody2;
-                        auto entity2 = rigidBodies.entity(rigidBody2);
-                        auto const& entity2Info = ecs().component<entity_info>().entity_record(entity2);
-                        if (entity2Info.destroyed)
-                            continue; // todo: add support for skip iterators
-                        vec3 distance = rigidBody1.position - rigidBody2.position;
-                        if (distance.magnitude() > 0.0) // avoid division by zero or rigidBody1 == rigidBody2
-                            totalForce += -physicalConstants.gravitationalConstant * rigidBody2.mass * rigidBody1.mass * distance / std::pow(distance.magnitude(), 3.0);
+                        for (auto const& live2 : iLiveRigidBodies)
+                        {
+                            if (live2.index >= firstMassless)
+                                break;
+                            auto& rigidBody2 = bodies[live2.index];
+                            vec3 distance = rigidBody1.position - rigidBody2.position;
+                            if (distance.magnitude() > 0.0) // avoid division by zero or rigidBody1 == rigidBody2
+                                totalForce += -physicalConstants.gravitationalConstant * rigidBody2.mass * rigidBody1.mass * distance / std::pow(distance.magnitude(), 3.0);
+                        }
                     }
+                    // GCSE-level physics (Newtonian) going on here... :)
+                    // v = u + at
+                    // F = ma; a = F/m
+                    auto v0 = rigidBody1.velocity;
+                    auto p0 = rigidBody1.position;
+                    auto a0 = rigidBody1.angle;
+                    auto elapsedTime = from_step_time(nextTime - worldClock.time);
+                    rigidBody1.velocity = v0 + ((rigidBody1.mass == 0 ? vec3{} : totalForce / rigidBody1.mass) + (rotation_matrix(rigidBody1.angle) * rigidBody1.acceleration)).scale(vec3{ elapsedTime, elapsedTime, elapsedTime });
+                    rigidBody1.position = rigidBody1.position + vec3{ 1.0, 1.0, 1.0 }.scale(elapsedTime * (v0 + rigidBody1.velocity) / 2.0);
+                    rigidBody1.angle = (rigidBody1.angle + rigidBody1.spin * elapsedTime) % (2.0 * boost::math::constants::pi<scalar>());
+                    if (p0 != rigidBody1.position || a0 != rigidBody1.angle)
+                        set_render_cache_dirty(ecs(), entity1);
                 }
-                // GCSE-level physics (Newtonian) going on here... :)
-                // v = u + at
-                // F = ma; a = F/m
-                auto v0 = rigidBody1.velocity;
-                auto p0 = rigidBody1.position;
-                auto a0 = rigidBody1.angle;
-                auto elapsedTime = from_step_time(nextTime - worldClock.time);
-                rigidBody1.velocity = v0 + ((rigidBody1.mass == 0 ? vec3{} : totalForce / rigidBody1.mass) + (rotation_matrix(rigidBody1.angle) * rigidBody1.acceleration)).scale(vec3{ elapsedTime, elapsedTime, elapsedTime });
-                rigidBody1.position = rigidBody1.position + vec3{ 1.0, 1.0, 1.0 }.scale(elapsedTime * (v0 + rigidBody1.velocity) / 2.0);
-                rigidBody1.angle = (rigidBody1.angle + rigidBody1.spin * elapsedTime) % (2.0 * boost::math::constants::pi<scalar>());
-                if (p0 != rigidBody1.position || a0 != rigidBody1.angle)
-                    set_render_cache_dirty(ecs(), entity1);
             }
             end_update(2);
             if (ecs().system_instantiated<collision_detector>() && !ecs().system<collision_detector>().paused())
@@ -166,8 +236,107 @@ namespace neogfx::game
         return ecs().system<game_world>().disable_universal_gravitation();
     }
 
+    bool simple_physics::parallel_integration_enabled() const
+    {
+        return iParallelIntegration;
+    }
+
+    void simple_physics::enable_parallel_integration()
+    {
+        iParallelIntegration = true;
+    }
+
+    void simple_physics::disable_parallel_integration()
+    {
+        iParallelIntegration = false;
+    }
+
+    bool simple_physics::barnes_hut_enabled() const
+    {
+        return iBarnesHutTheta != std::nullopt;
+    }
+
+    void simple_physics::enable_barnes_hut(scalar aTheta)
+    {
+        iBarnesHutTheta = aTheta;
+    }
+
+    void simple_physics::disable_barnes_hut()
+    {
+        iBarnesHutTheta = std::nullopt;
+    }
+
     void simple_physics::yield_after(std::chrono::duration<double, std::milli> aTime)
     {
         iYieldTime = aTime;
     }
+
+    void simple_physics::integrate_parallel(scalar aElapsedTime, const vec3& aUniformGravity, scalar aGravitationalConstant)
+    {
+        auto& data = *iIntegrationData;
+        auto& rigidBodies = ecs().component<rigid_body>();
+        bool const useUniversalGravitation = (aGravitationalConstant != 0.0);
+
+        data.clear();
+        iLiveRigidBodies.refresh();
+        for (auto const& live : iLiveRigidBodies)
+        {
+            auto& rigidBody = rigidBodies.component_data()[live.index];
+            data.bodies.push_back(&rigidBody);
+            data.entities.push_back(live.entity);
+            data.positionX.push_back(rigidBody.position.x);
+            data.positionY.push_back(rigidBody.position.y);
+            data.positionZ.push_back(rigidBody.position.z);
+            if (useUniversalGravitation && rigidBody.mass != 0.0)
+            {
+                data.sourceX.push_back(rigidBody.position.x);
+                data.sourceY.push_back(rigidBody.position.y);
+                data.sourceZ.push_back(rigidBody.position.z);
+                data.sourceMass.push_back(rigidBody.mass);
+            }
+        }
+
+        auto const bodyCount = data.bodies.size();
+        auto const sourceCount = data.sourceMass.size();
+        bool const useBarnesHut = useUniversalGravitation && barnes_hut_enabled();
+        if (useBarnesHut)
+        {
+            data.tree.set_theta(*iBarnesHutTheta);
+            data.tree.build(data.sourceX.data(), data.sourceY.data(), data.sourceZ.data(), data.sourceMass.data(), sourceCount);
+        }
+
+        data.moved.assign(bodyCount, false);
+        data.batches.resize((bodyCount + INTEGRATION_BATCH_SIZE - 1u) / INTEGRATION_BATCH_SIZE);
+        std::iota(data.batches.begin(), data.batches.end(), 0u);
+
+        std::for_each(std::execution::par, data.batches.begin(), data.batches.end(), [&](std::size_t aBatch)
+        {
+            auto const first = aBatch * INTEGRATION_BATCH_SIZE;
+            auto const last = std::min(first + INTEGRATION_BATCH_SIZE, bodyCount);
+            for (auto index = first; index != last; ++index)
+            {
+                auto& rigidBody = *data.bodies[index];
+                vec3 totalForce = rigidBody.mass * aUniformGravity;
+                if (useUniversalGravitation && rigidBody.mass != 0.0)
+                {
+                    auto const field = useBarnesHut ?
+                        data.tree.field(data.positionX[index], data.positionY[index], data.positionZ[index]) :
+                        direct_field(data.positionX[index], data.positionY[index], data.positionZ[index],
+                            data.sourceX.data(), data.sourceY.data(), data.sourceZ.data(), data.sourceMass.data(), sourceCount);
+                    totalForce += -aGravitationalConstant * rigidBody.mass * field;
+                }
+                auto v0 = rigidBody.velocity;
+                auto p0 = rigidBody.position;
+                auto a0 = rigidBody.angle;
+                rigidBody.velocity = v0 + ((rigidBody.mass == 0 ? vec3{} : totalForce / rigidBody.mass) + (rotation_matrix(rigidBody.angle) * rigidBody.acceleration)).scale(vec3{ aElapsedTime, aElapsedTime, aElapsedTime });
+                rigidBody.position = rigidBody.position + vec3{ 1.0, 1.0, 1.0 }.scale(aElapsedTime * (v0 + rigidBody.velocity) / 2.0);
+                rigidBody.angle = (rigidBody.angle + rigidBody.spin * aElapsedTime) % (2.0 * boost::math::constants::pi<scalar>());
+                data.moved[index] = (p0 != rigidBody.position || a0 != rigidBody.angle);
+            }
+        });
+
+        for (std::size_t index = 0u; index < bodyCount; ++index)
+            if (data.moved[index])
+                set_render_cache_dirty(ecs(), data.entities[index]);
+    }
 }
\ No newline at end of file
@@ -1082,7 +1082,7 @@ namespace neogfx
 
     glyph_text graphics_context::to_glyph_text(std::string::const_iterator aTextBegin, std::string::const_iterator aTextEnd, const font& aFont) const
     {
-        return to_glyph_text(aTextBegin, aTextEnd, [&aFont](std::size_t) { return aFont; });
+        return service<i_font_manager>().glyph_text_factory().to_glyph_text(*this, std::string_view{ aTextBegin, aTextEnd }, aFont);
     }
 
     glyph_text graphics_context::to_glyph_text(std::string::const_iterator aTextBegin, std::string::const_iterator aTextEnd, std::function<font(std::size_t)> aFontSelector) const
@@ -1112,7 +1112,7 @@ namespace neogfx
 
     glyph_text graphics_context::to_glyph_text(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, const font& aFont) const
     {
-        return to_glyph_text(aTextBegin, aTextEnd, [&aFont](std::size_t) { return aFont; });
+        return service<i_font_manager>().glyph_text_factory().to_glyph_text(*this, std::u32string_view{ aTextBegin, aTextEnd }, aFont);
     }
 
     glyph_text graphics_context::to_glyph_text(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, std::function<font(std::size_t)> aFontSelector) const
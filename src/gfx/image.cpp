@@ -18,7 +18,11 @@
 */
 
 #include <neogfx/neogfx.hpp>
+#include <cstdio>
+#include <csetjmp>
+#include <thread>
 #include <libpng/png.h>
+#include <jpeglib.h>
 #include <openssl/sha.h>
 #include <neolib/core/vecarray.hpp>
 #include <neolib/core/string_utils.hpp>
@@ -27,6 +31,241 @@
 
 namespace neogfx
 {
+    // Decodes a JPEG from a prefix of its data that may grow between calls: libjpeg is given a suspending data
+    // source so decoding stops, and later resumes, wherever the data runs out.
+    class image::jpeg_decoder
+    {
+    public:
+        enum class status
+        {
+            Suspended,
+            Complete,
+            Failed
+        };
+    private:
+        enum class stage
+        {
+            Header,
+            Start,
+            Rows,
+            Finish,
+            Done,
+            Failed
+        };
+        struct error_manager
+        {
+            jpeg_error_mgr base;
+            std::jmp_buf jump;
+            char message[JMSG_LENGTH_MAX];
+        };
+        struct source_manager
+        {
+            jpeg_source_mgr base;
+            bool final;
+            std::size_t skip;
+        };
+    public:
+        jpeg_decoder(const optional_size& aTargetExtents) :
+            iTargetExtents{ aTargetExtents },
+            iInfo{},
+            iStage{ stage::Header },
+            iConsumed{ 0u }
+        {
+            iInfo.err = jpeg_std_error(&iError.base);
+            iError.base.error_exit = &error_exit;
+            iError.base.output_message = &output_message;
+            iError.message[0] = '\0';
+            // libjpeg reports a failure to create the decompressor (e.g. a library version mismatch) through
+            // error_exit so the jump target must be set first; the failure is reported by decode()
+            if (setjmp(iError.jump) != 0)
+            {
+                iStage = stage::Failed;
+                return;
+            }
+            jpeg_create_decompress(&iInfo);
+            iSource.base.init_source = &init_source;
+            iSource.base.fill_input_buffer = &fill_input_buffer;
+            iSource.base.skip_input_data = &skip_input_data;
+            iSource.base.resync_to_restart = &jpeg_resync_to_restart;
+            iSource.base.term_source = &term_source;
+            iSource.base.next_input_byte = nullptr;
+            iSource.base.bytes_in_buffer = 0u;
+            iSource.final = false;
+            iSource.skip = 0u;
+            iInfo.src = &iSource.base;
+        }
+        ~jpeg_decoder()
+        {
+            jpeg_destroy_decompress(&iInfo);
+        }
+    public:
+        // Decodes as far as the first aAvailable bytes allow; aFinal indicates that no more data will arrive.
+        // Rows are written into aPixels (RGBA8) as they are decoded; rows not yet decoded are transparent.
+        status decode(const uint8_t* aData, std::size_t aAvailable, bool aFinal, data_type& aPixels, neogfx::size& aExtents, std::optional<string>& aError)
+        {
+            if (iStage == stage::Done)
+                return status::Complete;
+            if (iStage == stage::Failed)
+            {
+                aError = string{ iError.message };
+                return status::Failed;
+            }
+            auto const skipped = std::min(iSource.skip, aAvailable - iConsumed);
+            iConsumed += skipped;
+            iSource.skip -= skipped;
+            iSource.base.next_input_byte = aData + iConsumed;
+            iSource.base.bytes_in_buffer = aAvailable - iConsumed;
+            iSource.final = aFinal;
+            if (setjmp(iError.jump) != 0)
+            {
+                iStage = stage::Failed;
+                aError = string{ iError.message };
+                return status::Failed;
+            }
+            if (iStage == stage::Header)
+            {
+                if (jpeg_read_header(&iInfo, TRUE) == JPEG_SUSPENDED)
+                    return suspended(aData);
+                configure();
+                iStage = stage::Start;
+            }
+            if (iStage == stage::Start)
+            {
+                // progressive JPEGs are buffered in their entirety by libjpeg so only start once complete
+                if (!jpeg_start_decompress(&iInfo))
+                    return suspended(aData);
+                aExtents = neogfx::size{ static_cast<dimension>(iInfo.output_width), static_cast<dimension>(iInfo.output_height) };
+                aPixels.clear();
+                aPixels.resize(static_cast<std::size_t>(iInfo.output_width) * iInfo.output_height * 4u);
+                iRow.resize(static_cast<std::size_t>(iInfo.output_width) * iInfo.output_components);
+                iStage = stage::Rows;
+            }
+            while (iStage == stage::Rows && iInfo.output_scanline < iInfo.output_height)
+            {
+                JSAMPROW row = iRow.data();
+                if (jpeg_read_scanlines(&iInfo, &row, 1) == 0)
+                    return suspended(aData);
+                convert_row(iInfo.output_scanline - 1u, aPixels);
+            }
+            if (iStage == stage::Rows)
+                iStage = stage::Finish;
+            if (iStage == stage::Finish)
+            {
+                if (!jpeg_finish_decompress(&iInfo))
+                    return suspended(aData);
+                iStage = stage::Done;
+            }
+            return status::Complete;
+        }
+    private:
+        status suspended(const uint8_t* aData)
+        {
+            // libjpeg leaves the source positioned at the start of the unit it could not complete
+            iConsumed = static_cast<std::size_t>(iSource.base.next_input_byte - aData);
+            return status::Suspended;
+        }
+        void configure()
+        {
+            if (iInfo.jpeg_color_space == JCS_CMYK || iInfo.jpeg_color_space == JCS_YCCK)
+                iInfo.out_color_space = JCS_CMYK;
+            else
+                iInfo.out_color_space = JCS_RGB;
+            if (iTargetExtents)
+            {
+                iInfo.scale_num = 8u;
+                iInfo.scale_denom = 8u;
+                for (unsigned int n = 1u; n < 8u; ++n)
+                    if (std::ceil(iInfo.image_width * n / 8.0) >= iTargetExtents->cx && std::ceil(iInfo.image_height * n / 8.0) >= iTargetExtents->cy)
+                    {
+                        iInfo.scale_num = n;
+                        break;
+                    }
+            }
+        }
+        void convert_row(JDIMENSION aRow, data_type& aPixels) const
+        {
+            auto destination = &aPixels[static_cast<std::size_t>(aRow) * iInfo.output_width * 4u];
+            auto source = iRow.data();
+            if (iInfo.out_color_space == JCS_CMYK)
+            {
+                // Adobe applications write inverted CMYK
+                bool const inverted = !!iInfo.saw_Adobe_marker;
+                for (JDIMENSION x = 0u; x < iInfo.output_width; ++x, source += 4, destination += 4)
+                {
+                    auto const k = inverted ? source[3] : 255u - source[3];
+                    for (uint32_t c = 0u; c < 3u; ++c)
+                        destination[c] = static_cast<uint8_t>((inverted ? source[c] : 255u - source[c]) * k / 255u);
+                    destination[3] = 0xFFu;
+                }
+            }
+            else
+            {
+                for (JDIMENSION x = 0u; x < iInfo.output_width; ++x, source += 3, destination += 4)
+                {
+                    destination[0] = source[0];
+                    destination[1] = source[1];
+                    destination[2] = source[2];
+                    destination[3] = 0xFFu;
+                }
+            }
+        }
+    private:
+        static void error_exit(j_common_ptr aInfo)
+        {
+            auto& error = *reinterpret_cast<error_manager*>(aInfo->err);
+            error.base.format_message(aInfo, error.message);
+            std::longjmp(error.jump, 1);
+        }
+        static void output_message(j_common_ptr)
+        {
+            // warnings about corrupt data are not reported
+        }
+        static void init_source(j_decompress_ptr)
+        {
+        }
+        static boolean fill_input_buffer(j_decompress_ptr aInfo)
+        {
+            auto& source = *reinterpret_cast<source_manager*>(aInfo->src);
+            if (!source.final)
+                return FALSE;
+            // truncated data: insert an end of image marker so that what has been decoded is kept
+            static const JOCTET sEndOfImage[] = { 0xFF, JPEG_EOI };
+            source.base.next_input_byte = sEndOfImage;
+            source.base.bytes_in_buffer = sizeof(sEndOfImage);
+            return TRUE;
+        }
+        static void skip_input_data(j_decompress_ptr aInfo, long aCount)
+        {
+            auto& source = *reinterpret_cast<source_manager*>(aInfo->src);
+            if (aCount <= 0)
+                return;
+            auto const count = static_cast<std::size_t>(aCount);
+            if (count <= source.base.bytes_in_buffer)
+            {
+                source.base.next_input_byte += count;
+                source.base.bytes_in_buffer -= count;
+            }
+            else
+            {
+                // skip the rest when it arrives
+                source.skip += count - source.base.bytes_in_buffer;
+                source.base.next_input_byte += source.base.bytes_in_buffer;
+                source.base.bytes_in_buffer = 0u;
+            }
+        }
+        static void term_source(j_decompress_ptr)
+        {
+        }
+    private:
+        optional_size iTargetExtents;
+        jpeg_decompress_struct iInfo;
+        error_manager iError;
+        source_manager iSource;
+        stage iStage;
+        std::size_t iConsumed;
+        std::vector<JSAMPLE> iRow;
+    };
+
     image::image(dimension aDpiScaleFactor, texture_sampling aSampling, neogfx::color_space aColorSpace) :
         iDpiScaleFactor{ aDpiScaleFactor }, 
         iColorSpace{ aColorSpace },
@@ -48,15 +287,26 @@ namespace neogfx
     }
 
     image::image(std::string const& aUri, dimension aDpiScaleFactor, texture_sampling aSampling, neogfx::color_space aColorSpace) :
+        image{ aUri, image_decode_options{}, aDpiScaleFactor, aSampling, aColorSpace }
+    {
+    }
+
+    image::image(std::string const& aUri, image_decode_options const& aDecodeOptions, dimension aDpiScaleFactor, texture_sampling aSampling, neogfx::color_space aColorSpace) :
         iResource{ service<i_resource_manager>().load_resource(aUri) },
         iUri{ aUri },
         iDpiScaleFactor{ aDpiScaleFactor },
         iColorSpace{ aColorSpace },
         iColorFormat{ neogfx::color_format::RGBA8 },
-        iSampling{ aSampling }
+        iSampling{ aSampling },
+        iDecodeOptions{ aDecodeOptions }
     {
         if (available())
             load();
+        else if (downloading())
+        {
+            watch_download();
+            decode_available();
+        }
     }
 
     image::image(std::string const& aImagePattern, const std::unordered_map<std::string, color>& aColorMap, dimension aDpiScaleFactor, texture_sampling aSampling, neogfx::color_space aColorSpace) :
@@ -125,8 +375,18 @@ namespace neogfx
         iColorFormat{ aOther.iColorFormat },
         iData{ aOther.iData },
         iSampling{ aOther.iSampling },
-        iSize{ aOther.iSize }
+        iSize{ aOther.iSize },
+        iDecodeOptions{ aOther.iDecodeOptions },
+        iBackgroundDecode{ aOther.iBackgroundDecode }
     {
+        // a copy made mid-decode waits for the same background decode, or repeats a streaming decode as data arrives
+        if (iBackgroundDecode)
+        {
+            ++iBackgroundDecode->waiting;
+            start_background_decode_pump();
+        }
+        if (aOther.iStreamingDecoder)
+            watch_download();
     }
 
     image::image(image&& aOther) :
@@ -138,8 +398,19 @@ namespace neogfx
         iColorFormat{ std::move(aOther.iColorFormat) },
         iData{ std::move(aOther.iData) },
         iSampling{ std::move(aOther.iSampling) },
-        iSize{ std::move(aOther.iSize) }
+        iSize{ std::move(aOther.iSize) },
+        iDecodeOptions{ std::move(aOther.iDecodeOptions) },
+        iStreamingDecoder{ std::move(aOther.iStreamingDecoder) },
+        iBackgroundDecode{ std::move(aOther.iBackgroundDecode) }
     {
+        // a decode in progress continues for this image
+        aOther.iBackgroundDecodePump = std::nullopt;
+        aOther.iBackgroundDecode = nullptr;
+        aOther.iSink.clear();
+        if (iBackgroundDecode)
+            start_background_decode_pump();
+        if (iStreamingDecoder)
+            watch_download();
     }
 
     image::image(image const& aOther, texture_sampling aSampling) :
@@ -156,6 +427,9 @@ namespace neogfx
 
     image::~image()
     {
+        // the detached worker is never waited for; it stops early once no image is waiting for its result
+        if (iBackgroundDecode && --iBackgroundDecode->waiting == 0u)
+            iBackgroundDecode->cancelled = true;
     }
 
     bool image::available() const
@@ -327,6 +601,41 @@ namespace neogfx
         }
     }
 
+    bool image::decoding() const
+    {
+        return iStreamingDecoder != nullptr || iBackgroundDecode != nullptr;
+    }
+
+    bool image::decode_available()
+    {
+        if (iBackgroundDecode || !has_resource() || resource().is_empty())
+            return false;
+        if (iStreamingDecoder == nullptr)
+        {
+            if (!is_empty() && available())
+                return true;
+            if (recognize() != JpegImage)
+            {
+                // only JPEGs are decoded incrementally; other formats are decoded once downloaded
+                if (!available())
+                    return false;
+                bool const loaded = load();
+                if (iDecodeOptions.background)
+                    return false;
+                Decoded.trigger();
+                return loaded;
+            }
+            iStreamingDecoder = std::make_unique<jpeg_decoder>(iDecodeOptions.targetExtents);
+        }
+        auto const status = iStreamingDecoder->decode(static_cast<const uint8_t*>(resource().cdata()), resource().size(), available(), iData, iSize, iError);
+        iHash = std::nullopt;
+        if (status == jpeg_decoder::status::Suspended)
+            return false;
+        iStreamingDecoder.reset();
+        Decoded.trigger();
+        return status == jpeg_decoder::status::Complete;
+    }
+
     bool image::has_resource() const
     {
         return iResource != nullptr;
@@ -351,6 +660,12 @@ namespace neogfx
                     if (magic[0] == 0x89 && magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G')
                         return PngImage;
                 }
+                if (resource().size() >= 3)
+                {
+                    const uint8_t* magic = static_cast<const uint8_t*>(resource().data());
+                    if (magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF)
+                        return JpegImage;
+                }
             }
         }
         return UnknownImage;
@@ -360,42 +675,139 @@ namespace neogfx
     {
         if (!available())
             throw not_available();
-        switch (recognize())
+        auto const type = recognize();
+        if (type == UnknownImage)
+            throw unknown_image_format();
+        if (iDecodeOptions.background)
+        {
+            auto job = std::make_shared<background_decode>();
+            job->resource = iResource;
+            iBackgroundDecode = job;
+            std::thread{ [job, type, targetExtents = iDecodeOptions.targetExtents]()
+            {
+                decode_result result;
+                try
+                {
+                    result = decode(type, *job->resource, targetExtents, &job->cancelled);
+                }
+                catch (std::exception const& e)
+                {
+                    result.error = string{ e.what() };
+                }
+                if (!job->cancelled)
+                    job->result = std::move(result);
+                job->finished = true;
+            } }.detach();
+            start_background_decode_pump();
+            return true;
+        }
+        auto result = decode(type, resource(), iDecodeOptions.targetExtents);
+        bool const decoded = (result.error == std::nullopt);
+        apply(std::move(result));
+        return decoded;
+    }
+
+    void image::apply(decode_result&& aResult)
+    {
+        if (aResult.error != std::nullopt)
+        {
+            iError = aResult.error;
+            return;
+        }
+        iData = std::move(aResult.pixels);
+        iSize = aResult.extents;
+        iHash = std::nullopt;
+    }
+
+    void image::start_background_decode_pump()
+    {
+        iBackgroundDecodePump.emplace(service<i_async_task>(), [this](neolib::callback_timer& aTimer)
+        {
+            if (!iBackgroundDecode->finished)
+            {
+                aTimer.again();
+                return;
+            }
+            auto job = std::move(iBackgroundDecode);
+            iBackgroundDecode = nullptr;
+            if (--job->waiting == 0u)
+                apply(std::move(job->result));
+            else
+                apply(decode_result{ job->result });
+            Decoded.trigger();
+        }, std::chrono::milliseconds{ 10 });
+    }
+
+    void image::watch_download()
+    {
+        iSink = iResource->downloaded([this]()
+        {
+            decode_available();
+        });
+    }
+
+    image::decode_result image::decode(image_type_e aType, const i_resource& aResource, const optional_size& aTargetExtents, std::atomic<bool> const* aCancelled)
+    {
+        decode_result result;
+        switch (aType)
         {
         case PngImage:
-            return load_png();
+            decode_png(aResource, result);
+            break;
+        case JpegImage:
+            decode_jpeg(aResource, aTargetExtents, result, aCancelled);
+            break;
         default:
             throw unknown_image_format();
         }
+        return result;
     }
 
-    bool image::load_png()
+    bool image::decode_png(const i_resource& aResource, decode_result& aResult)
     {
         png_image image;
         std::memset(&image, 0, (sizeof image));
         image.version = PNG_IMAGE_VERSION;
-        if (png_image_begin_read_from_memory(&image, resource().data(), resource().size()) != 0)
+        if (png_image_begin_read_from_memory(&image, aResource.cdata(), aResource.size()) != 0)
         {
             image.format = PNG_FORMAT_RGBA;
-            iData.resize(PNG_IMAGE_SIZE(image));
-            if (png_image_finish_read(&image, NULL, data(), 0, NULL) != 0)
+            aResult.pixels.resize(PNG_IMAGE_SIZE(image));
+            if (png_image_finish_read(&image, NULL, &aResult.pixels[0], 0, NULL) != 0)
             {
-                iSize = neogfx::size(image.width, image.height);
+                aResult.extents = neogfx::size(image.width, image.height);
                 png_image_free(&image);
                 return true;
             }
             else
             {
                 png_image_free(&image);
-                iError = image.message;
+                aResult.error = string{ image.message };
                 return false;
             }
         }
         else
         {
-            iError = image.message;
+            aResult.error = string{ image.message };
             return false;
         }
     }
 
+    bool image::decode_jpeg(const i_resource& aResource, const optional_size& aTargetExtents, decode_result& aResult, std::atomic<bool> const* aCancelled)
+    {
+        // a cancellable decode is fed to the streaming decoder in slices so that it can stop between them
+        std::size_t constexpr CancellableSlice = 64u * 1024u;
+        auto const data = static_cast<const uint8_t*>(aResource.cdata());
+        auto const length = aResource.size();
+        auto const slice = (aCancelled != nullptr ? CancellableSlice : length);
+        jpeg_decoder decoder{ aTargetExtents };
+        for (std::size_t available = std::min(slice, length);; available = std::min(available + slice, length))
+        {
+            if (aCancelled != nullptr && *aCancelled)
+                return false;
+            auto const status = decoder.decode(data, available, available == length, aResult.pixels, aResult.extents, aResult.error);
+            if (status != jpeg_decoder::status::Suspended || available == length)
+                return status == jpeg_decoder::status::Complete;
+        }
+    }
+
 }
\ No newline at end of file
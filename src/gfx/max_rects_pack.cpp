@@ -0,0 +1,218 @@
+// max_rects_pack.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+#include <neogfx/gfx/max_rects_pack.hpp>
+
+namespace neogfx
+{
+    namespace
+    {
+        inline bool contains(const rect& aOuter, const rect& aInner)
+        {
+            return aInner.x >= aOuter.x && aInner.y >= aOuter.y &&
+                aInner.x + aInner.cx <= aOuter.x + aOuter.cx && aInner.y + aInner.cy <= aOuter.y + aOuter.cy;
+        }
+
+        inline bool overlaps(const rect& aLhs, const rect& aRhs)
+        {
+            return aLhs.x < aRhs.x + aRhs.cx && aRhs.x < aLhs.x + aLhs.cx &&
+                aLhs.y < aRhs.y + aRhs.cy && aRhs.y < aLhs.y + aLhs.cy;
+        }
+    }
+
+    max_rects_pack::max_rects_pack(const size& aDimensions) :
+        iDimensions{ aDimensions }, iUsedArea{ 0.0 }, iExact{ true }
+    {
+        iFree.push_back(rect{ point{}, aDimensions });
+    }
+
+    const size& max_rects_pack::dimensions() const
+    {
+        return iDimensions;
+    }
+
+    bool max_rects_pack::insert(const size& aElementSize, rect& aResult)
+    {
+        if (!find_position(aElementSize, aResult))
+        {
+            if (iExact)
+                return false;
+            rebuild();
+            if (!find_position(aElementSize, aResult))
+                return false;
+        }
+        place(aResult);
+        return true;
+    }
+
+    void max_rects_pack::remove(const rect& aElement)
+    {
+        auto existing = std::find(iUsed.begin(), iUsed.end(), aElement);
+        if (existing == iUsed.end())
+            return;
+        iUsed.erase(existing);
+        iUsedArea -= aElement.cx * aElement.cy;
+        if (iUsed.empty())
+        {
+            iFree.assign(1u, rect{ point{}, iDimensions });
+            iExact = true;
+            return;
+        }
+        // grow the freed space across free neighbours that share a complete edge with it
+        rect freed = aElement;
+        for (bool merged = true; merged;)
+        {
+            merged = false;
+            for (auto const& neighbour : iFree)
+            {
+                if (neighbour.y == freed.y && neighbour.cy == freed.cy &&
+                    (neighbour.x + neighbour.cx == freed.x || freed.x + freed.cx == neighbour.x))
+                {
+                    freed = rect{ point{ std::min(freed.x, neighbour.x), freed.y }, size{ freed.cx + neighbour.cx, freed.cy } };
+                    merged = true;
+                }
+                else if (neighbour.x == freed.x && neighbour.cx == freed.cx &&
+                    (neighbour.y + neighbour.cy == freed.y || freed.y + freed.cy == neighbour.y))
+                {
+                    freed = rect{ point{ freed.x, std::min(freed.y, neighbour.y) }, size{ freed.cx, freed.cy + neighbour.cy } };
+                    merged = true;
+                }
+                if (merged)
+                    break;
+            }
+            if (merged)
+                std::erase_if(iFree, [&](const rect& aFree) { return contains(freed, aFree); });
+        }
+        iFree.push_back(freed);
+        iExact = false;
+    }
+
+    void max_rects_pack::rebuild()
+    {
+        iFree.assign(1u, rect{ point{}, iDimensions });
+        for (auto const& used : iUsed)
+            split(used);
+        iExact = true;
+    }
+
+    bool max_rects_pack::empty() const
+    {
+        return iUsed.empty();
+    }
+
+    std::size_t max_rects_pack::used_count() const
+    {
+        return iUsed.size();
+    }
+
+    std::size_t max_rects_pack::free_count() const
+    {
+        return iFree.size();
+    }
+
+    dimension max_rects_pack::used_area() const
+    {
+        return iUsedArea;
+    }
+
+    dimension max_rects_pack::free_area() const
+    {
+        return iDimensions.cx * iDimensions.cy - iUsedArea;
+    }
+
+    dimension max_rects_pack::largest_free_area() const
+    {
+        dimension largest = 0.0;
+        for (auto const& free : iFree)
+            largest = std::max(largest, free.cx * free.cy);
+        return largest;
+    }
+
+    bool max_rects_pack::find_position(const size& aElementSize, rect& aResult) const
+    {
+        // best short side fit
+        bool found = false;
+        dimension bestShortSide = 0.0;
+        dimension bestLongSide = 0.0;
+        for (auto const& free : iFree)
+        {
+            if (free.cx < aElementSize.cx || free.cy < aElementSize.cy)
+                continue;
+            auto const leftoverX = free.cx - aElementSize.cx;
+            auto const leftoverY = free.cy - aElementSize.cy;
+            auto const shortSide = std::min(leftoverX, leftoverY);
+            auto const longSide = std::max(leftoverX, leftoverY);
+            if (!found || shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+            {
+                aResult = rect{ free.top_left(), aElementSize };
+                bestShortSide = shortSide;
+                bestLongSide = longSide;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    void max_rects_pack::place(const rect& aElement)
+    {
+        iUsed.push_back(aElement);
+        iUsedArea += aElement.cx * aElement.cy;
+        split(aElement);
+    }
+
+    void max_rects_pack::split(const rect& aUsed)
+    {
+        iSplit.clear();
+        for (auto const& free : iFree)
+            if (!overlaps(free, aUsed))
+                iSplit.push_back(free);
+        auto const firstNew = iSplit.size();
+        for (auto const& free : iFree)
+        {
+            if (!overlaps(free, aUsed))
+                continue;
+            if (aUsed.x > free.x)
+                iSplit.push_back(rect{ point{ free.x, free.y }, size{ aUsed.x - free.x, free.cy } });
+            if (aUsed.x + aUsed.cx < free.x + free.cx)
+                iSplit.push_back(rect{ point{ aUsed.x + aUsed.cx, free.y }, size{ free.x + free.cx - (aUsed.x + aUsed.cx), free.cy } });
+            if (aUsed.y > free.y)
+                iSplit.push_back(rect{ point{ free.x, free.y }, size{ free.cx, aUsed.y - free.y } });
+            if (aUsed.y + aUsed.cy < free.y + free.cy)
+                iSplit.push_back(rect{ point{ free.x, aUsed.y + aUsed.cy }, size{ free.cx, free.y + free.cy - (aUsed.y + aUsed.cy) } });
+        }
+        iFree.swap(iSplit);
+        prune(firstNew);
+    }
+
+    void max_rects_pack::prune(std::size_t aFirstNew)
+    {
+        // new rectangles are carved from existing ones so only they can be redundant; of any duplicates keep the first
+        for (auto i = std::next(iFree.begin(), aFirstNew); i != iFree.end();)
+        {
+            bool redundant = false;
+            for (auto j = iFree.begin(); j != iFree.end() && !redundant; ++j)
+                redundant = (j != i && contains(*j, *i) && (*j != *i || j < i));
+            if (redundant)
+                i = iFree.erase(i);
+            else
+                ++i;
+        }
+    }
+}
\ No newline at end of file
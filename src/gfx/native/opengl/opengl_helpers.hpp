@@ -187,6 +187,12 @@ namespace neogfx
         void clear()
         {
             iSize = 0;
+            iReclaimedSpace.clear();
+            ++iGeneration;
+        }
+        uint32_t generation() const
+        {
+            return iGeneration;
         }
     public:
         GLuint handle() const
@@ -256,6 +262,7 @@ namespace neogfx
             std::swap(iSize, temp.iSize);
             std::swap(iMemory, temp.iMemory);
             std::swap(iReclaimedSpace, temp.iReclaimedSpace);
+            std::swap(iGeneration, temp.iGeneration);
             iOwner->buffer_grown();
         }
     private:
@@ -265,6 +272,7 @@ namespace neogfx
         mutable pointer iMemory = nullptr;
         opengl_buffer_owner* iOwner = nullptr;
         std::vector<std::pair<std::size_t, std::size_t>> iReclaimedSpace;
+        uint32_t iGeneration = 0u;
     };
 
     template <typename T>
@@ -468,6 +476,10 @@ namespace neogfx
             vertex_buffer::detach_shader();
         }
     public:
+        uint32_t generation() const override
+        {
+            return iBuffer.generation();
+        }
         void reclaim(std::size_t aStartIndex, std::size_t aEndIndex)
         {
             vertices().reclaim(aStartIndex, aEndIndex);
@@ -295,6 +295,8 @@ namespace neogfx
             buffer.flush();
             buffer.execute();
         }
+        // glyphs drawn so far have been submitted so may now be evicted
+        font_manager().end_glyph_cache_frame();
     }
 
     i_texture& opengl_renderer::ping_pong_buffer1(const size& aExtents, size& aPreviousExtents, texture_sampling aSampling)
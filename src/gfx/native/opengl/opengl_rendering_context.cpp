@@ -28,6 +28,7 @@
 #include <neogfx/gfx/i_rendering_engine.hpp>
 #include <neogfx/gfx/text/i_glyph.hpp>
 #include <neogfx/gfx/shapes.hpp>
+#include <neogfx/gfx/vertex_transform.hpp>
 #include <neogfx/gui/widget/i_widget.hpp>
 #include <neogfx/game/rectangle.hpp>
 #include <neogfx/game/text_mesh.hpp>
@@ -245,6 +246,45 @@ namespace neogfx
             }
             return aValue.as<float>().to_vec4();
         }
+
+        inline aabb transformed_bounds(aabb const& aBounds, mat44 const& aTransformation)
+        {
+            std::optional<aabb> result;
+            for (std::size_t corner = 0u; corner < 8u; ++corner)
+            {
+                vec3 const point = aTransformation * vec3{
+                    (corner & 1u) ? aBounds.max.x : aBounds.min.x,
+                    (corner & 2u) ? aBounds.max.y : aBounds.min.y,
+                    (corner & 4u) ? aBounds.max.z : aBounds.min.z };
+                if (!result)
+                    result = aabb{ point, point };
+                else
+                    result = aabb{ result->min.min(point), result->max.max(point) };
+            }
+            return *result;
+        }
+
+        inline game::mesh_filter const& entity_mesh_filter(game::i_ecs& aEcs, game::entity_id aEntity)
+        {
+            auto const& meshFilters = aEcs.component<game::mesh_filter>();
+            return meshFilters.has_entity_record_no_lock(aEntity) ?
+                meshFilters.entity_record_no_lock(aEntity) :
+                game::current_animation_frame(aEcs.component<game::animation_filter>().entity_record_no_lock(aEntity));
+        }
+
+        // rigid body x mesh filter x animation filter, skipping the multiplications by identity
+        inline mat44 entity_transformation(game::i_ecs& aEcs, game::entity_id aEntity, game::mesh_filter const& aMeshFilter)
+        {
+            auto const& rigidBodies = aEcs.component<game::rigid_body>();
+            auto const& animatedMeshFilters = aEcs.component<game::animation_filter>();
+            mat44 result = (rigidBodies.has_entity_record_no_lock(aEntity) ?
+                to_transformation_matrix(rigidBodies.entity_record_no_lock(aEntity)) : mat44::identity());
+            if (aMeshFilter.transformation)
+                result = result * *aMeshFilter.transformation;
+            if (animatedMeshFilters.has_entity_record_no_lock(aEntity))
+                result = result * to_transformation_matrix(animatedMeshFilters.entity_record_no_lock(aEntity));
+            return result;
+        }
     }
 
     opengl_rendering_context::opengl_rendering_context(const i_render_target& aTarget, neogfx::blending_mode aBlendingMode) :
@@ -1336,45 +1376,111 @@ namespace neogfx
             for (auto& d : drawables)
                 d.clear();
             lock.emplace(aEcs);
-            auto const& rigidBodies = aEcs.component<game::rigid_body>();
-            auto const& animatedMeshFilters = aEcs.component<game::animation_filter>();
             auto const& infos = aEcs.component<game::entity_info>();
             auto const& meshRenderers = aEcs.component<game::mesh_renderer>();
-            auto const& meshFilters = aEcs.component<game::mesh_filter>();
-            auto const& cache = aEcs.component<game::mesh_render_cache>();
-            for (auto entity : meshRenderers.entities())
+            auto& cache = aEcs.component<game::mesh_render_cache>();
+            auto& vertexProvider = dynamic_cast<i_vertex_provider&>(aEcs);
+            auto& index = vertexProvider.render_index();
+            auto& statistics = vertexProvider.culling_statistics();
+            statistics = {};
+            // world bounds are cached with the entity's vertices and bucketed in the render index; they are only
+            // recomputed for entities whose render cache is not clean and the index is only rebuilt when the set of
+            // renderers changes
+            auto const update_bounds = [&](game::entity_id aEntity)
+            {
+                auto const& meshFilter = entity_mesh_filter(aEcs, aEntity);
+                auto const& mesh = (meshFilter.mesh != std::nullopt ? *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
+                auto const& renderCache = cache.entity_record_no_lock(aEntity, true);
+                renderCache.bounds = !mesh.vertices.empty() ?
+                    transformed_bounds(to_aabb(mesh.vertices.begin(), mesh.vertices.end()), entity_transformation(aEcs, aEntity, meshFilter)) :
+                    std::optional<aabb>{};
+                index.update(aEntity, renderCache.bounds);
+            };
+            if (index.source_count() != meshRenderers.entities().size())
+            {
+                index.clear();
+                for (auto entity : meshRenderers.entities())
+                {
+                    if (infos.entity_record_no_lock(entity).destroyed)
+                        continue;
+                    if (game::is_render_cache_clean_no_lock(cache, entity))
+                        index.update(entity, cache.entity_record_no_lock(entity).bounds);
+                    else
+                        update_bounds(entity);
+                }
+                index.set_source_count(meshRenderers.entities().size());
+            }
+            else
+            {
+                auto const& cachedEntities = cache.entities();
+                auto const& cacheEntries = cache.component_data();
+                for (std::size_t cacheIndex = 0u; cacheIndex < cacheEntries.size(); ++cacheIndex)
+                {
+                    auto const entity = cachedEntities[cacheIndex];
+                    if (cacheEntries[cacheIndex].state != game::cache_state::Clean &&
+                        meshRenderers.has_entity_record_no_lock(entity) && !infos.entity_record_no_lock(entity).destroyed)
+                        update_bounds(entity);
+                }
+            }
+            // entities are culled against the render target in logical coordinates; the grid is queried with the
+            // view taken back into world space, which is exact for the scale and translation draw transformations
+            // are built from, otherwise every cell is visited and the per entity test does the culling
+            auto const logicalCoordinates = logical_coordinates();
+            vec2 const viewMin{
+                std::min(logicalCoordinates.bottomLeft.x, logicalCoordinates.topRight.x),
+                std::min(logicalCoordinates.bottomLeft.y, logicalCoordinates.topRight.y) };
+            vec2 const viewMax{
+                std::max(logicalCoordinates.bottomLeft.x, logicalCoordinates.topRight.x),
+                std::max(logicalCoordinates.bottomLeft.y, logicalCoordinates.topRight.y) };
+            auto const visible = [&](aabb const& aBounds)
             {
+                auto const bounds = transformed_bounds(aBounds, aTransformation);
+                return bounds.max.x >= viewMin.x && bounds.min.x <= viewMax.x &&
+                    bounds.max.y >= viewMin.y && bounds.min.y <= viewMax.y;
+            };
+            aabb_2d worldView{
+                vec2{ std::numeric_limits<scalar>::lowest(), std::numeric_limits<scalar>::lowest() },
+                vec2{ std::numeric_limits<scalar>::max(), std::numeric_limits<scalar>::max() } };
+            vec3 const origin = aTransformation * vec3{ 0.0, 0.0, 0.0 };
+            vec3 const xAxis = aTransformation * vec3{ 1.0, 0.0, 0.0 } - origin;
+            vec3 const yAxis = aTransformation * vec3{ 0.0, 1.0, 0.0 } - origin;
+            vec3 const zAxis = aTransformation * vec3{ 0.0, 0.0, 1.0 } - origin;
+            if (xAxis.x != 0.0 && yAxis.y != 0.0 && xAxis.y == 0.0 && yAxis.x == 0.0 && zAxis.x == 0.0 && zAxis.y == 0.0)
+            {
+                vec2 const corner1{ (viewMin.x - origin.x) / xAxis.x, (viewMin.y - origin.y) / yAxis.y };
+                vec2 const corner2{ (viewMax.x - origin.x) / xAxis.x, (viewMax.y - origin.y) / yAxis.y };
+                worldView = aabb_2d{ corner1.min(corner2), corner1.max(corner2) };
+            }
+            // hits are drawn in the order they were indexed (renderer order) so painting order within a layer is kept
+            thread_local std::vector<std::pair<uint64_t, game::entity_id>> hits;
+            hits.clear();
+            index.query(worldView, [&](game::entity_id aEntity, uint64_t aOrdinal) { hits.emplace_back(aOrdinal, aEntity); });
+            std::sort(hits.begin(), hits.end());
+            for (auto const& hit : hits)
+            {
+                auto const entity = hit.second;
 #if defined(NEOGFX_DEBUG) && !defined(NDEBUG)
                 if (infos.entity_record(entity).debug)
                     service<debug::logger>() << neolib::logger::severity::Debug << "Rendering debug::layoutItem entity..." << endl;
 #endif // NEOGFX_DEBUG
-                auto const& info = infos.entity_record_no_lock(entity);
-                if (info.destroyed)
+                if (infos.entity_record_no_lock(entity).destroyed || !meshRenderers.has_entity_record_no_lock(entity))
+                    continue;
+                auto const& bounds = cache.entity_record_no_lock(entity).bounds;
+                if (bounds && !visible(*bounds))
                     continue;
                 auto const& meshRenderer = meshRenderers.entity_record_no_lock(entity);
                 maxLayer = std::max(maxLayer, meshRenderer.layer);
                 if (drawables.size() <= maxLayer)
                     drawables.resize(maxLayer + 1);
-                auto const& meshFilter = meshFilters.has_entity_record_no_lock(entity) ?
-                    meshFilters.entity_record_no_lock(entity) :
-                    game::current_animation_frame(animatedMeshFilters.entity_record_no_lock(entity));
+                ++statistics.drawn;
+                // the transformation is only needed to write vertices so draw_meshes works it out if the cache is not clean
                 drawables[meshRenderer.layer].emplace_back(
-                    meshFilter,
+                    entity_mesh_filter(aEcs, entity),
                     meshRenderer,
                     optional_mat44{},
                     entity);
-                if (!game::is_render_cache_clean_no_lock(cache, entity))
-                {
-                    auto const& rigidBodyTransformation = (rigidBodies.has_entity_record_no_lock(entity) ?
-                        to_transformation_matrix(rigidBodies.entity_record_no_lock(entity)) : mat44::identity());
-                    auto const& meshFilterTransformation = (meshFilter.transformation ?
-                        *meshFilter.transformation : mat44::identity());
-                    auto const& animationMeshFilterTransformation = (animatedMeshFilters.has_entity_record_no_lock(entity) ?
-                        to_transformation_matrix(animatedMeshFilters.entity_record_no_lock(entity)) : mat44::identity());
-                    auto const& transformation = rigidBodyTransformation * meshFilterTransformation * animationMeshFilterTransformation;
-                    drawables[meshRenderer.layer].back().transformation = transformation;
-                }
             }
+            statistics.culled = static_cast<uint32_t>(index.count() - statistics.drawn);
         }
         if (!drawables[aLayer].empty())
             draw_meshes(lock, dynamic_cast<i_vertex_provider&>(aEcs), &*drawables[aLayer].begin(), &*drawables[aLayer].begin() + drawables[aLayer].size(), aTransformation);
@@ -2154,6 +2260,9 @@ namespace neogfx
 
         auto cache = aVertexProvider.cacheable() ? &aVertexProvider.cache() : nullptr;
 
+        auto& vertexBuffer = static_cast<opengl_vertex_buffer<>&>(service<i_rendering_engine>().vertex_buffer(aVertexProvider));
+        auto& vertices = vertexBuffer.vertices();
+
         std::size_t vertexCount = 0;
         std::size_t cachedVertexCount = 0;
         for (auto md = aFirst; md != aLast; ++md)
@@ -2161,6 +2270,10 @@ namespace neogfx
             auto& meshDrawable = *md;
             auto& meshRenderer = *meshDrawable.renderer;
             auto& meshFilter = *meshDrawable.filter;
+            // vertices cached before the buffer was last emptied have been overwritten
+            if (meshDrawable.entity != null_entity && game::is_render_cache_valid_no_lock(*cache, meshDrawable.entity) &&
+                cache->entity_record_no_lock(meshDrawable.entity).generation != vertices.generation())
+                game::set_render_cache_invalid_no_lock(*cache, meshDrawable.entity);
             bool const cached = meshDrawable.entity != null_entity &&
                 game::is_render_cache_valid_no_lock(*cache, meshDrawable.entity);
             auto& mesh = (meshFilter.mesh != std::nullopt ? *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
@@ -2176,8 +2289,6 @@ namespace neogfx
             }
         }
 
-        auto& vertexBuffer = static_cast<opengl_vertex_buffer<>&>(service<i_rendering_engine>().vertex_buffer(aVertexProvider));
-        auto& vertices = vertexBuffer.vertices();
         if (!vertices.room_for(vertexCount - cachedVertexCount))
         {
             vertexBuffer.execute();
@@ -2199,9 +2310,18 @@ namespace neogfx
             ignore = {};
             auto const& meshRenderCache = (meshDrawable.entity != null_entity ? cache->entity_record_no_lock(meshDrawable.entity, true) : ignore);
             auto& mesh = (meshFilter.mesh != std::nullopt ? *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
+            if (meshRenderCache.state != game::cache_state::Clean && meshDrawable.entity != null_entity && !meshDrawable.transformation)
+                meshDrawable.transformation = entity_transformation(dynamic_cast<game::i_ecs&>(aVertexProvider), meshDrawable.entity, meshFilter);
             auto const& transformation = meshDrawable.transformation;
             auto const& faces = mesh.faces;
             auto const& material = meshRenderer.material;
+            // each mesh vertex is transformed once, in bulk, rather than once for every face that references it
+            thread_local std::vector<vec3f> transformedVertices;
+            if (meshRenderCache.state != game::cache_state::Clean)
+            {
+                transformedVertices.resize(mesh.vertices.size());
+                transform_vertices(transformation, mesh.vertices.data(), mesh.vertices.size(), transformedVertices.data());
+            }
             vec2 textureStorageExtents;
             vec2 uvFixupCoefficient;
             vec2 uvFixupOffset;
@@ -2247,7 +2367,7 @@ namespace neogfx
                     {
                         for (auto faceVertexIndex : face)
                         {
-                            auto const& xyz = (transformation? *transformation * mesh.vertices[faceVertexIndex] : mesh.vertices[faceVertexIndex]);
+                            auto const& xyz = transformedVertices[faceVertexIndex];
                             auto const& rgba = (material.color != std::nullopt ? material.color->rgba.as<float>() : vec4f{ 1.0f, 1.0f, 1.0f, 1.0f });
                             auto const& uv = (patch_drawable::has_texture(meshRenderer, material) ?
                                 (mesh.uv[faceVertexIndex].scale(uvFixupCoefficient) + uvFixupOffset).scale(1.0 / textureStorageExtents) : vec2{});
@@ -2287,6 +2407,7 @@ namespace neogfx
                 add_item(meshRenderCache.patchVertexArrayIndices[patchIndex], mesh, patch.material, patch.faces);
             }
             meshRenderCache.state = game::cache_state::Clean;
+            meshRenderCache.generation = vertices.generation();
         }
 
         draw_patch(patchDrawable, aTransformation);
@@ -61,6 +61,24 @@ namespace neogfx
             {
                 throw not_cacheable();
             }
+            const game::mesh_render_index& render_index() const override
+            {
+                throw not_cacheable();
+            }
+            game::mesh_render_index& render_index() override
+            {
+                throw not_cacheable();
+            }
+            const entity_culling_statistics& culling_statistics() const override
+            {
+                return iCullingStatistics;
+            }
+            entity_culling_statistics& culling_statistics() override
+            {
+                return iCullingStatistics;
+            }
+        private:
+            entity_culling_statistics iCullingStatistics = {};
         };
         class scoped_anti_alias
         {
@@ -159,9 +159,15 @@ namespace neogfx
         GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0 };
         glCheck(glDrawBuffers(sizeof(drawBuffers) / sizeof(drawBuffers[0]), drawBuffers));
 
-        glCheck(surface_window().native_window_render(invalidated_area()));
-
-        rendering_engine().execute_vertex_buffers();
+        // one pass per (coalesced) damaged rectangle: widgets outside it skip rendering and the rest are scissored to it
+        auto const damaged = rendering_region().rects();
+        for (auto const& damagedRect : damaged)
+        {
+            set_rendering_area(damagedRect);
+            glCheck(surface_window().native_window_render(damagedRect));
+            rendering_engine().execute_vertex_buffers();
+        }
+        set_rendering_area(std::nullopt);
 
         glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
         glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, iFrameBuffer));
@@ -19,6 +19,10 @@
 
 #include <neogfx/neogfx.hpp>
 #include <filesystem>
+#include <list>
+#include <mutex>
+#include <boost/functional/hash.hpp>
+#include <neolib/core/scoped.hpp>
 #include <neolib/core/string_utils.hpp>
 #include <neolib/core/string_utf.hpp>
 #include <ft2build.h>
@@ -42,6 +46,8 @@
 #endif
 #include <neolib/file/file.hpp>
 #include <neogfx/app/i_app.hpp>
+#include <neogfx/core/async_task.hpp>
+#include <neogfx/hid/i_surface_manager.hpp>
 #include <neogfx/gfx/i_rendering_engine.hpp>
 #include <neogfx/gfx/i_graphics_context.hpp>
 #include <neogfx/gfx/text/font_manager.hpp>
@@ -49,6 +55,7 @@
 #include <neogfx/gfx/text/glyph_text.ipp>
 #include "../../gfx/text/native/native_font_face.hpp"
 #include "../../gfx/text/native/native_font.hpp"
+#include "../../gfx/text/native/glyph_rasteriser.hpp"
 
 template <>
 neogfx::i_font_manager& services::start_service<neogfx::i_font_manager>()
@@ -166,6 +173,23 @@ namespace neogfx
         return *f;
     }
 
+    namespace
+    {
+        struct gui_thread_required {};
+
+        bool& concurrent_shaping()
+        {
+            thread_local bool tConcurrentShaping = false;
+            return tConcurrentShaping;
+        }
+
+        hb_buffer_t* concurrent_shaping_buffer()
+        {
+            thread_local std::unique_ptr<hb_buffer_t, decltype(&hb_buffer_destroy)> tBuffer{ hb_buffer_create(), &hb_buffer_destroy };
+            return tBuffer.get();
+        }
+    }
+
     class glyph_text_factory : public i_glyph_text_factory
     {
     public:
@@ -177,11 +201,68 @@ namespace neogfx
         typedef std::vector<cluster> cluster_map_t;
         typedef std::tuple<const char32_t*, const char32_t*, text_direction, bool, hb_script_t> glyph_run;
         typedef std::vector<glyph_run> run_list;
+    private:
+        // everything shaping reads from the graphics context is part of the key
+        struct shaped_text_key
+        {
+            std::u32string text;
+            font textFont;
+            std::optional<std::string> passwordMask;
+            std::optional<char> mnemonic;
+            bool subpixel;
+            std::optional<scalar> tabStop;
+            neogfx::logical_coordinate_system coordinateSystem;
+            bool alignBaselines;
+
+            bool operator==(shaped_text_key const& aOther) const
+            {
+                return text == aOther.text && textFont == aOther.textFont && passwordMask == aOther.passwordMask &&
+                    mnemonic == aOther.mnemonic && subpixel == aOther.subpixel && tabStop == aOther.tabStop &&
+                    coordinateSystem == aOther.coordinateSystem && alignBaselines == aOther.alignBaselines;
+            }
+        };
+        struct shaped_text_key_hash
+        {
+            std::size_t operator()(shaped_text_key const& aKey) const
+            {
+                std::size_t seed = std::hash<std::u32string>{}(aKey.text);
+                boost::hash_combine(seed, aKey.textFont.id());
+                boost::hash_combine(seed, aKey.textFont.underline());
+                boost::hash_combine(seed, aKey.textFont.kerning());
+                boost::hash_combine(seed, aKey.mnemonic.value_or('\0'));
+                boost::hash_combine(seed, aKey.subpixel);
+                boost::hash_combine(seed, aKey.alignBaselines);
+                return seed;
+            }
+        };
+        typedef std::list<shaped_text_key> shaped_text_lru;
+        typedef std::unordered_map<shaped_text_key, std::pair<glyph_text, shaped_text_lru::iterator>, shaped_text_key_hash> shaped_text_cache;
+    public:
+        static constexpr uint32_t DefaultGlyphTextCacheCapacity = 1024u;
+        static constexpr std::size_t MaxCachedTextLength = 256u;
+    public:
+        glyph_text_factory();
     public:
         glyph_text create_glyph_text() override;
         glyph_text create_glyph_text(font const& aFont) override;
         glyph_text to_glyph_text(i_graphics_context const& aGc, char const* aUtf8Begin, char const* aUtf8End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) override;
         glyph_text to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) override;
+        glyph_text to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, font const& aFont, bool aAlignBaselines = true) override;
+        glyph_text to_glyph_text(i_graphics_context const& aGc, char const* aUtf8Begin, char const* aUtf8End, font const& aFont, bool aAlignBaselines = true) override;
+        optional_glyph_text to_glyph_text_concurrent(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) override;
+    public:
+        uint32_t glyph_text_cache_capacity() const override;
+        void set_glyph_text_cache_capacity(uint32_t aEntries) override;
+        neogfx::glyph_text_cache_statistics glyph_text_cache_statistics() const override;
+        void clear_glyph_text_cache() override;
+    private:
+        void trim_glyph_text_cache();
+    private:
+        mutable std::mutex iCacheMutex;
+        uint32_t iCacheCapacity;
+        shaped_text_cache iCache;
+        shaped_text_lru iCacheOrder;
+        neogfx::glyph_text_cache_statistics iCacheStatistics;
     };
 
     class glyph_shapes
@@ -196,7 +277,7 @@ namespace neogfx
                 iParent{ aParent },
                 iFont{ static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzFont },
                 iGlyphRun{ aGlyphRun },
-                iBuf{ static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzBuf },
+                iBuf{ concurrent_shaping() ? concurrent_shaping_buffer() : static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzBuf },
                 iGlyphCount{ 0u }
             {
                 hb_buffer_set_direction(iBuf, std::get<2>(aGlyphRun) == text_direction::RTL ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
@@ -260,6 +341,11 @@ namespace neogfx
             iGlyphsList.emplace_back(glyphs{ aParent, tryFont, aGlyphRun });
             while (iGlyphsList.back().needs_fallback_font())
             {
+                if (concurrent_shaping())
+                {
+                    fontsTried.clear();
+                    throw gui_thread_required{};
+                }
                 if (tryFont.has_fallback() && std::find(fontsTried.begin(), fontsTried.end(), tryFont.fallback()) == fontsTried.end())
                 {
                     tryFont = tryFont.fallback();
@@ -339,6 +425,12 @@ namespace neogfx
         result_type iResults;
     };
 
+    glyph_text_factory::glyph_text_factory() :
+        iCacheCapacity{ DefaultGlyphTextCacheCapacity },
+        iCacheStatistics{}
+    {
+    }
+
     glyph_text glyph_text_factory::create_glyph_text()
     {
         return *make_ref<glyph_text_content>();
@@ -372,6 +464,108 @@ namespace neogfx
         } }, aAlignBaselines);
     }
 
+    glyph_text glyph_text_factory::to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, font const& aFont, bool aAlignBaselines)
+    {
+        auto const shape = [&]()
+        {
+            return to_glyph_text(aGc, aUtf32Begin, aUtf32End, font_selector{ [&aFont](std::size_t) { return aFont; } }, aAlignBaselines);
+        };
+
+        std::size_t const length = static_cast<std::size_t>(aUtf32End - aUtf32Begin);
+        if (length == 0u || length > MaxCachedTextLength || iCacheCapacity == 0u)
+            return shape();
+
+        shaped_text_key key{ std::u32string{ aUtf32Begin, aUtf32End }, aFont };
+        key.passwordMask = aGc.password() ? std::optional<std::string>{ aGc.password_mask() } : std::nullopt;
+        key.mnemonic = aGc.mnemonic_set() && key.text.find(static_cast<char32_t>(aGc.mnemonic())) != std::u32string::npos ?
+            std::optional<char>{ aGc.mnemonic() } : std::nullopt;
+        key.subpixel = aGc.is_subpixel_rendering_on();
+        key.tabStop = aGc.has_tab_stops() && key.text.find(U'\t') != std::u32string::npos ?
+            std::optional<scalar>{ aGc.tab_stops().default_stop().pos } : std::nullopt;
+        key.coordinateSystem = aGc.logical_coordinate_system();
+        key.alignBaselines = aAlignBaselines;
+
+        {
+            std::scoped_lock lock{ iCacheMutex };
+            auto existing = iCache.find(key);
+            if (existing != iCache.end())
+            {
+                ++iCacheStatistics.hits;
+                iCacheOrder.splice(iCacheOrder.begin(), iCacheOrder, existing->second.second);
+                return existing->second.first;
+            }
+            ++iCacheStatistics.misses;
+        }
+
+        auto result = shape();
+
+        std::scoped_lock lock{ iCacheMutex };
+        if (iCache.find(key) == iCache.end())
+        {
+            iCacheOrder.push_front(key);
+            iCache.emplace(key, std::make_pair(result, iCacheOrder.begin()));
+            trim_glyph_text_cache();
+        }
+        return result;
+    }
+
+    glyph_text glyph_text_factory::to_glyph_text(i_graphics_context const& aGc, char const* aUtf8Begin, char const* aUtf8End, font const& aFont, bool aAlignBaselines)
+    {
+        thread_local std::u32string codePoints;
+        codePoints = neolib::utf8_to_utf32(std::string_view{ aUtf8Begin, aUtf8End });
+        return to_glyph_text(aGc, codePoints.data(), codePoints.data() + codePoints.size(), aFont, aAlignBaselines);
+    }
+
+    optional_glyph_text glyph_text_factory::to_glyph_text_concurrent(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines)
+    {
+        neolib::scoped_flag sf{ concurrent_shaping() };
+        try
+        {
+            return to_glyph_text(aGc, aUtf32Begin, aUtf32End, aFontSelector, aAlignBaselines);
+        }
+        catch (gui_thread_required const&)
+        {
+            return {};
+        }
+    }
+
+    uint32_t glyph_text_factory::glyph_text_cache_capacity() const
+    {
+        return iCacheCapacity;
+    }
+
+    void glyph_text_factory::set_glyph_text_cache_capacity(uint32_t aEntries)
+    {
+        std::scoped_lock lock{ iCacheMutex };
+        iCacheCapacity = aEntries;
+        trim_glyph_text_cache();
+    }
+
+    neogfx::glyph_text_cache_statistics glyph_text_factory::glyph_text_cache_statistics() const
+    {
+        std::scoped_lock lock{ iCacheMutex };
+        auto result = iCacheStatistics;
+        result.entries = iCache.size();
+        return result;
+    }
+
+    void glyph_text_factory::clear_glyph_text_cache()
+    {
+        std::scoped_lock lock{ iCacheMutex };
+        iCache.clear();
+        iCacheOrder.clear();
+    }
+
+    void glyph_text_factory::trim_glyph_text_cache()
+    {
+        while (iCacheOrder.size() > iCacheCapacity)
+        {
+            iCache.erase(iCacheOrder.back());
+            iCacheOrder.pop_back();
+            ++iCacheStatistics.evictions;
+        }
+    }
+
     glyph_text glyph_text_factory::to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines)
     {
         auto const& emojiAtlas = service<i_font_manager>().emoji_atlas();
@@ -565,6 +759,9 @@ namespace neogfx
             previousFont = currentFont;
         }
 
+        if (hasEmojis && concurrent_shaping())
+            throw gui_thread_required{};
+
         float lineStart = 0.0f;
         vec2f previousAdvance = {};
         quadf_2d previousCell = {};
@@ -667,7 +864,10 @@ namespace neogfx
 
                 if (category(newGlyph) != text_category::Emoji)
                 {
-                    auto const& glyphTexture = font.glyph(newGlyph);
+                    i_glyph const* const existingGlyph = concurrent_shaping() ? font.native_font_face().find_glyph(newGlyph) : &font.glyph(newGlyph);
+                    if (existingGlyph == nullptr)
+                        throw gui_thread_required{};
+                    auto const& glyphTexture = *existingGlyph;
                     auto const& glyphTextureExtents = glyphTexture.texture().extents().as<float>();
                     float const cellWidth = (category(newGlyph) != text_category::Whitespace ? std::max(advance.x, glyphTextureExtents.cx) : advance.x);
                     auto const& glyphMetrics = glyphTexture.metrics();
@@ -795,7 +995,13 @@ namespace neogfx
     font_manager::font_manager() :
         iGlyphTextFactory{ std::make_unique<neogfx::glyph_text_factory>() },
         iGlyphAtlas{ size{1024.0, 1024.0} },
-        iEmojiAtlas{}
+        iEmojiAtlas{},
+        iGlyphCacheHand{ iGlyphCache.end() },
+        iGlyphCacheBudget{ 0u },
+        iGlyphCacheFrame{ 0u },
+        iGlyphCacheStatistics{},
+        iGlyphRasteriserGeneration{ 0u },
+        iGlyphPlaceholderPolicy{ neogfx::glyph_placeholder_policy::Synchronous }
     {
         FT_Error error = FT_Init_FreeType(&iFontLib);
         if (error)
@@ -868,6 +1074,8 @@ namespace neogfx
 
     font_manager::~font_manager()
     {
+        iGlyphRasteriserPump.reset();
+        iGlyphTextFactory->clear_glyph_text_cache();
         iIdCache.clear();
         iFontFamilies.clear();
         iNativeFonts.clear();
@@ -1116,6 +1324,90 @@ namespace neogfx
         return iEmojiAtlas;
     }
 
+    uint64_t font_manager::glyph_cache_budget() const
+    {
+        return iGlyphCacheBudget;
+    }
+
+    void font_manager::set_glyph_cache_budget(uint64_t aBytes)
+    {
+        iGlyphCacheBudget = aBytes;
+        trim_glyph_cache();
+    }
+
+    neogfx::glyph_cache_statistics font_manager::glyph_cache_statistics() const
+    {
+        return iGlyphCacheStatistics;
+    }
+
+    void font_manager::end_glyph_cache_frame()
+    {
+        ++iGlyphCacheFrame;
+        trim_glyph_cache();
+    }
+
+    void font_manager::pin_glyph(texture_id aGlyphTexture)
+    {
+        ++iPinnedGlyphs[aGlyphTexture];
+    }
+
+    void font_manager::unpin_glyph(texture_id aGlyphTexture)
+    {
+        auto existing = iPinnedGlyphs.find(aGlyphTexture);
+        if (existing != iPinnedGlyphs.end() && --existing->second == 0u)
+            iPinnedGlyphs.erase(existing);
+    }
+
+    bool font_manager::async_glyph_rasterisation_enabled() const
+    {
+        return iGlyphRasteriser != nullptr;
+    }
+
+    void font_manager::enable_async_glyph_rasterisation(uint32_t aThreadCount)
+    {
+        if (aThreadCount == 0u)
+            aThreadCount = std::max(std::thread::hardware_concurrency() / 2u, 1u);
+        if (iGlyphRasteriser != nullptr && iGlyphRasteriser->thread_count() == aThreadCount)
+            return;
+        disable_async_glyph_rasterisation();
+        iGlyphRasteriser = std::make_unique<glyph_rasteriser>(aThreadCount);
+        ++iGlyphRasteriserGeneration;
+        iGlyphRasteriserPump.emplace(service<i_async_task>(), [this](neolib::callback_timer& aTimer)
+        {
+            aTimer.again();
+            process_rasterised_glyphs();
+        }, std::chrono::milliseconds{ 10 });
+    }
+
+    void font_manager::disable_async_glyph_rasterisation()
+    {
+        if (iGlyphRasteriser == nullptr)
+            return;
+        iGlyphRasteriserPump.reset();
+        process_rasterised_glyphs();
+        iGlyphRasteriser.reset();
+    }
+
+    neogfx::glyph_placeholder_policy font_manager::glyph_placeholder_policy() const
+    {
+        return iGlyphPlaceholderPolicy;
+    }
+
+    void font_manager::set_glyph_placeholder_policy(neogfx::glyph_placeholder_policy aPolicy)
+    {
+        iGlyphPlaceholderPolicy = aPolicy;
+    }
+
+    void font_manager::prefetch_glyphs(font const& aFont, char32_t aFirst, char32_t aLast)
+    {
+        static_cast<native_font_face const&>(aFont.native_font_face()).prefetch(aFirst, aLast);
+    }
+
+    uint64_t font_manager::pending_glyph_count() const
+    {
+        return iGlyphRasteriser != nullptr ? iGlyphRasteriser->pending() : 0u;
+    }
+
     void font_manager::add_ref(font_id aId)
     {
         font_from_id(aId).native_font_face().add_ref();
@@ -1260,4 +1552,99 @@ namespace neogfx
                 ++i;
         }
     }
+
+    font_manager::glyph_cache::iterator font_manager::glyph_cached(native_font_face& aFace, uint32_t aGlyph, texture_id aTexture, uint64_t aBytes)
+    {
+        // new entries go just behind the clock hand so that they are the last to be considered for eviction
+        auto newEntry = iGlyphCache.insert(iGlyphCacheHand, cached_glyph{ &aFace, aGlyph, aTexture, aBytes, iGlyphCacheFrame, false });
+        ++iGlyphCacheStatistics.misses;
+        ++iGlyphCacheStatistics.glyphs;
+        iGlyphCacheStatistics.bytes += aBytes;
+        trim_glyph_cache();
+        return newEntry;
+    }
+
+    void font_manager::glyph_cache_hit(glyph_cache::iterator aEntry)
+    {
+        aEntry->referenced = true;
+        aEntry->lastUsedFrame = iGlyphCacheFrame;
+        ++iGlyphCacheStatistics.hits;
+    }
+
+    void font_manager::glyphs_released(native_font_face& aFace)
+    {
+        for (auto entry = iGlyphCache.begin(); entry != iGlyphCache.end();)
+        {
+            if (entry->face != &aFace)
+            {
+                ++entry;
+                continue;
+            }
+            --iGlyphCacheStatistics.glyphs;
+            iGlyphCacheStatistics.bytes -= entry->bytes;
+            if (entry == iGlyphCacheHand)
+                iGlyphCacheHand = std::next(iGlyphCacheHand);
+            entry = iGlyphCache.erase(entry);
+        }
+    }
+
+    void font_manager::trim_glyph_cache()
+    {
+        if (iGlyphCacheBudget == 0u)
+            return;
+        // CLOCK sweep; glyphs used during the current frame may already be referenced by unflushed vertex
+        // batches and pinned glyphs are baked into live ECS text meshes so neither are evicted, which makes
+        // the budget a soft limit
+        std::size_t skipped = 0u;
+        while (iGlyphCacheStatistics.bytes > iGlyphCacheBudget && skipped < iGlyphCache.size() * 2u)
+        {
+            if (iGlyphCacheHand == iGlyphCache.end())
+                iGlyphCacheHand = iGlyphCache.begin();
+            auto& entry = *iGlyphCacheHand;
+            if (entry.lastUsedFrame == iGlyphCacheFrame || entry.referenced || iPinnedGlyphs.contains(entry.texture))
+            {
+                entry.referenced = false;
+                ++iGlyphCacheHand;
+                ++skipped;
+                continue;
+            }
+            skipped = 0u;
+            auto const face = entry.face;
+            auto const glyph = entry.glyph;
+            ++iGlyphCacheStatistics.evictions;
+            --iGlyphCacheStatistics.glyphs;
+            iGlyphCacheStatistics.bytes -= entry.bytes;
+            iGlyphCacheHand = iGlyphCache.erase(iGlyphCacheHand);
+            face->evict_glyph(glyph);
+        }
+    }
+
+    glyph_rasteriser& font_manager::rasteriser()
+    {
+        return *iGlyphRasteriser;
+    }
+
+    uint32_t font_manager::rasteriser_generation() const
+    {
+        return iGlyphRasteriserGeneration;
+    }
+
+    void font_manager::glyph_rasterisation_cancelled(native_font_face const& aFace)
+    {
+        if (iGlyphRasteriser != nullptr)
+            iGlyphRasteriser->cancel(aFace);
+    }
+
+    void font_manager::process_rasterised_glyphs()
+    {
+        thread_local std::vector<glyph_rasteriser::result> tResults;
+        if (iGlyphRasteriser == nullptr || !iGlyphRasteriser->take(tResults))
+            return;
+        bool uploaded = false;
+        for (auto const& result : tResults)
+            uploaded = result.face->glyph_rasterised(result.ok, result.glyph) || uploaded;
+        tResults.clear();
+        if (uploaded)
+            service<i_surface_manager>().invalidate_surfaces();
+    }
 }
\ No newline at end of file
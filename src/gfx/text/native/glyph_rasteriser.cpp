@@ -0,0 +1,307 @@
+// glyph_rasteriser.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+#include <algorithm>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_BITMAP_H
+#include FT_LCD_FILTER_H
+#include "native_font_face.hpp"
+#include "glyph_rasteriser.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        inline glyph_pixel_mode to_glyph_pixel_mode(unsigned char aFreeTypePixelMode)
+        {
+            switch (aFreeTypePixelMode)
+            {
+            default:
+            case FT_PIXEL_MODE_NONE:
+                return glyph_pixel_mode::None;
+            case FT_PIXEL_MODE_MONO:
+                return glyph_pixel_mode::Mono;
+            case FT_PIXEL_MODE_GRAY:
+                return glyph_pixel_mode::Gray;
+            case FT_PIXEL_MODE_GRAY2:
+                return glyph_pixel_mode::Gray2Bit;
+            case FT_PIXEL_MODE_GRAY4:
+                return glyph_pixel_mode::Gray4Bit;
+            case FT_PIXEL_MODE_LCD:
+                return glyph_pixel_mode::LCD;
+            case FT_PIXEL_MODE_LCD_V:
+                return glyph_pixel_mode::LCD_V;
+            case FT_PIXEL_MODE_BGRA:
+                return glyph_pixel_mode::BGRA;
+            }
+        }
+    }
+
+    glyph_rasteriser::glyph_rasteriser(uint32_t aThreadCount) :
+        iStopping{ false }
+    {
+        aThreadCount = std::max(aThreadCount, 1u);
+        try
+        {
+            for (uint32_t i = 0u; i < aThreadCount; ++i)
+            {
+                FT_Library fontLib;
+                if (FT_Init_FreeType(&fontLib) != FT_Err_Ok)
+                    throw error_initializing_font_library();
+                iFontLibs.push_back(fontLib);
+                if (FT_Library_SetLcdFilter(fontLib, FT_LCD_FILTER_NONE) != FT_Err_Ok)
+                    throw error_initializing_font_library();
+            }
+        }
+        catch (...)
+        {
+            for (auto fontLib : iFontLibs)
+                FT_Done_FreeType(fontLib);
+            throw;
+        }
+        iInFlight.resize(aThreadCount, nullptr);
+        for (auto fontLib : iFontLibs)
+            iThreads.emplace_back([this, fontLib]() { work(fontLib); });
+    }
+
+    glyph_rasteriser::~glyph_rasteriser()
+    {
+        {
+            std::scoped_lock lock{ iMutex };
+            iStopping = true;
+        }
+        iWork.notify_all();
+        for (auto& thread : iThreads)
+            thread.join();
+        for (auto fontLib : iFontLibs)
+            FT_Done_FreeType(fontLib);
+    }
+
+    uint32_t glyph_rasteriser::thread_count() const
+    {
+        return static_cast<uint32_t>(iThreads.size());
+    }
+
+    std::size_t glyph_rasteriser::pending() const
+    {
+        std::scoped_lock lock{ iMutex };
+        return iRequests.size() + std::count_if(iInFlight.begin(), iInFlight.end(), [](native_font_face const* aFace) { return aFace != nullptr; });
+    }
+
+    void glyph_rasteriser::post(request const& aRequest)
+    {
+        {
+            std::scoped_lock lock{ iMutex };
+            iRequests.push_back(aRequest);
+        }
+        iWork.notify_one();
+    }
+
+    void glyph_rasteriser::cancel(native_font_face const& aFace)
+    {
+        std::unique_lock lock{ iMutex };
+        std::erase_if(iRequests, [&](request const& aRequest) { return aRequest.face == &aFace; });
+        iIdle.wait(lock, [&]() { return std::find(iInFlight.begin(), iInFlight.end(), &aFace) == iInFlight.end(); });
+        std::erase_if(iResults, [&](result const& aResult) { return aResult.face == &aFace; });
+    }
+
+    bool glyph_rasteriser::take(std::vector<result>& aResults)
+    {
+        aResults.clear();
+        std::scoped_lock lock{ iMutex };
+        std::swap(aResults, iResults);
+        return !aResults.empty();
+    }
+
+    void glyph_rasteriser::rasterise(FT_Library aFontLib, FT_Face aFace, glyph_index_t aGlyph, FT_Pos aEmboldenStrength, rasterised_glyph& aResult)
+    {
+        // todo: investigate why turning off sub-pixel doesn't produce same grayscale bitmap as Windows with ClearType disabled
+        bool useSubpixelFiltering = true;
+
+        try
+        {
+            if (useSubpixelFiltering)
+            {
+                freetypeCheck(FT_Load_Glyph(aFace, aGlyph, FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_LCD | FT_LOAD_NO_BITMAP));
+            }
+            else
+            {
+                freetypeCheck(FT_Load_Glyph(aFace, aGlyph, FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_NORMAL | FT_LOAD_NO_BITMAP));
+            }
+        }
+        catch (freetype_error fe)
+        {
+            throw native_font_face::freetype_load_glyph_error(fe.what());
+        }
+        try
+        {
+            if (useSubpixelFiltering)
+            {
+                freetypeCheck(FT_Render_Glyph(aFace->glyph, FT_RENDER_MODE_LCD));
+            }
+            else
+            {
+                freetypeCheck(FT_Render_Glyph(aFace->glyph, FT_RENDER_MODE_NORMAL));
+            }
+        }
+        catch (freetype_error fe)
+        {
+            throw native_font_face::freetype_render_glyph_error(fe.what());
+        }
+
+        FT_Bitmap& bitmap = aFace->glyph->bitmap;
+
+        if (aEmboldenStrength != 0)
+            FT_Bitmap_Embolden(aFontLib, &bitmap, aEmboldenStrength, 0);
+
+        auto pixelMode = to_glyph_pixel_mode(bitmap.pixel_mode);
+
+        if (pixelMode != glyph_pixel_mode::LCD)
+            useSubpixelFiltering = false;
+
+        auto const width = bitmap.width / (useSubpixelFiltering ? 3 : 1);
+
+        aResult.glyph = aGlyph;
+        aResult.subpixel = useSubpixelFiltering;
+        aResult.pixelMode = pixelMode;
+        aResult.metrics = glyph_metrics{
+            vec2{ aFace->glyph->metrics.width / 64.0, aFace->glyph->metrics.height / 64.0 }.round(),
+            vec2{ aFace->glyph->metrics.horiBearingX / 64.0, aFace->glyph->metrics.horiBearingY / 64.0 }.round() };
+        aResult.width = width;
+        aResult.height = bitmap.rows;
+        aResult.pixels.clear();
+
+        if (width == 0)
+            return;
+
+        if (useSubpixelFiltering)
+        {
+            aResult.pixels.resize(static_cast<std::size_t>(width) * bitmap.rows * 4u);
+            // sub-pixel FIR filter.
+            static double coefficients[] = { 1.5 / 16.0, 3.5 / 16.0, 6.0 / 16.0, 3.5 / 16.0, 1.5 / 16.0 };
+            for (uint32_t y = 0; y < bitmap.rows; y++)
+            {
+                for (uint32_t x = 0; x < bitmap.width; x++)
+                {
+                    uint8_t alpha = 0;
+                    for (int32_t z = -2; z <= 2; ++z)
+                    {
+                        int32_t const s = x + z;
+                        if (s >= 0 && s <= static_cast<int32_t>(bitmap.width) - 1)
+                            alpha += static_cast<uint8_t>(bitmap.buffer[s + bitmap.pitch * y] * coefficients[z + 2]);
+                    }
+                    aResult.pixels[((x / 3) + (bitmap.rows - 1 - y) * static_cast<std::size_t>(width)) * 4u + x % 3] = alpha;
+                }
+            }
+        }
+        else
+        {
+            aResult.pixels.resize(static_cast<std::size_t>(width) * bitmap.rows);
+            for (uint32_t y = 0; y < bitmap.rows; y++)
+                switch (bitmap.pixel_mode)
+                {
+                case FT_PIXEL_MODE_MONO: // 1 bit per pixel monochrome
+                    for (uint32_t x = 0; x < bitmap.width; x += 8)
+                        for (uint32_t b = 0; b < std::min(bitmap.width - x, 8u); ++b)
+                            aResult.pixels[(x + b) + (bitmap.rows - 1 - y) * static_cast<std::size_t>(width)] =
+                                (x >= bitmap.width || y >= bitmap.rows) ? 0x00 : ((bitmap.buffer[x / 8 + bitmap.pitch * y] & (1 << (7 - b))) != 0 ? 0xFF : 0x00);
+                    break;
+                case FT_PIXEL_MODE_GRAY:
+                default:
+                    for (uint32_t x = 0; x < bitmap.width; x++)
+                        aResult.pixels[x + (bitmap.rows - 1 - y) * static_cast<std::size_t>(width)] =
+                            (x >= bitmap.width || y >= bitmap.rows) ? 0x00 : bitmap.buffer[x + bitmap.pitch * y];
+                    break;
+                }
+        }
+    }
+
+    void glyph_rasteriser::work(FT_Library aFontLib)
+    {
+        std::vector<worker_face> faces;
+        auto const face_for = [&](request const& aRequest) -> FT_Face
+        {
+            auto existing = std::find_if(faces.begin(), faces.end(), [&](worker_face const& aFace) { return aFace.serial == aRequest.faceSerial; });
+            if (existing != faces.end())
+            {
+                std::rotate(faces.begin(), existing, std::next(existing));
+                return faces.front().face;
+            }
+            FT_Face newFace;
+            freetypeCheck(FT_New_Memory_Face(aFontLib, static_cast<const FT_Byte*>(aRequest.fontData), static_cast<FT_Long>(aRequest.fontDataSize), aRequest.faceIndex, &newFace));
+            try
+            {
+                if (aRequest.size.strike)
+                {
+                    freetypeCheck(FT_Select_Size(newFace, *aRequest.size.strike));
+                }
+                else
+                {
+                    freetypeCheck(FT_Set_Char_Size(newFace, 0, aRequest.size.charHeight, aRequest.size.horizontalDpi, aRequest.size.verticalDpi));
+                }
+            }
+            catch (...)
+            {
+                FT_Done_Face(newFace);
+                throw;
+            }
+            if (faces.size() == WorkerFaceCacheSize)
+            {
+                FT_Done_Face(faces.back().face);
+                faces.pop_back();
+            }
+            faces.insert(faces.begin(), worker_face{ aRequest.faceSerial, newFace });
+            return newFace;
+        };
+        auto const slot = static_cast<std::size_t>(std::distance(iFontLibs.begin(), std::find(iFontLibs.begin(), iFontLibs.end(), aFontLib)));
+        for (;;)
+        {
+            request next;
+            {
+                std::unique_lock lock{ iMutex };
+                iWork.wait(lock, [&]() { return iStopping || !iRequests.empty(); });
+                if (iStopping)
+                    break;
+                next = iRequests.front();
+                iRequests.pop_front();
+                iInFlight[slot] = next.face;
+            }
+            result completed{ next.face, true };
+            try
+            {
+                rasterise(aFontLib, face_for(next), next.glyph, next.emboldenStrength, completed.glyph);
+            }
+            catch (...)
+            {
+                completed.ok = false;
+                completed.glyph.glyph = next.glyph;
+            }
+            {
+                std::scoped_lock lock{ iMutex };
+                iInFlight[slot] = nullptr;
+                iResults.push_back(std::move(completed));
+            }
+            iIdle.notify_all();
+        }
+        for (auto& face : faces)
+            FT_Done_Face(face.face);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+// glyph_rasteriser.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <neogfx/gfx/text/i_glyph.hpp>
+#include "i_native_font_face.hpp"
+
+namespace neogfx
+{
+    class native_font_face;
+
+    // FreeType sizing of a face; recorded by the face so that a worker can size its own copy identically.
+    struct glyph_raster_size
+    {
+        FT_F26Dot6 charHeight;
+        FT_UInt horizontalDpi;
+        FT_UInt verticalDpi;
+        std::optional<FT_Int> strike;
+    };
+
+    // A rendered glyph bitmap ready for upload: rows are stored bottom-up, one byte per pixel
+    // (four for sub-pixel) with no padding.
+    struct rasterised_glyph
+    {
+        i_native_font_face::glyph_index_t glyph;
+        bool subpixel;
+        glyph_pixel_mode pixelMode;
+        glyph_metrics metrics;
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> pixels;
+    };
+
+    // Renders glyph bitmaps on worker threads; each worker owns its own FreeType library and faces
+    // (FreeType objects are not thread safe) created over the same font data as the requesting face.
+    // Completed bitmaps are collected by the owner on the GUI thread and uploaded to the glyph atlas there.
+    class glyph_rasteriser
+    {
+    public:
+        typedef i_native_font_face::glyph_index_t glyph_index_t;
+    public:
+        struct request
+        {
+            native_font_face* face;
+            uint64_t faceSerial;
+            const void* fontData;
+            std::size_t fontDataSize;
+            FT_Long faceIndex;
+            glyph_raster_size size;
+            FT_Pos emboldenStrength;
+            glyph_index_t glyph;
+        };
+        struct result
+        {
+            native_font_face* face;
+            bool ok;
+            rasterised_glyph glyph;
+        };
+    private:
+        struct worker_face
+        {
+            uint64_t serial;
+            FT_Face face;
+        };
+        static constexpr std::size_t WorkerFaceCacheSize = 8u;
+    public:
+        struct error_initializing_font_library : std::runtime_error { error_initializing_font_library() : std::runtime_error("neogfx::glyph_rasteriser::error_initializing_font_library") {} };
+    public:
+        glyph_rasteriser(uint32_t aThreadCount);
+        ~glyph_rasteriser();
+    public:
+        uint32_t thread_count() const;
+        std::size_t pending() const;
+        void post(request const& aRequest);
+        void cancel(native_font_face const& aFace);
+        bool take(std::vector<result>& aResults);
+    public:
+        static void rasterise(FT_Library aFontLib, FT_Face aFace, glyph_index_t aGlyph, FT_Pos aEmboldenStrength, rasterised_glyph& aResult);
+    private:
+        void work(FT_Library aFontLib);
+    private:
+        mutable std::mutex iMutex;
+        std::condition_variable iWork;
+        std::condition_variable iIdle;
+        std::deque<request> iRequests;
+        std::vector<result> iResults;
+        std::vector<native_font_face const*> iInFlight;
+        bool iStopping;
+        std::vector<FT_Library> iFontLibs;
+        std::vector<std::thread> iThreads;
+    };
+}
\ No newline at end of file
@@ -77,5 +77,8 @@ namespace neogfx
         virtual void* handle() const = 0;
         virtual glyph_index_t glyph_index(char32_t aCodePoint) const = 0;
         virtual i_glyph& glyph(const glyph_char& aGlyphChar) const = 0;
+        // Returns the glyph only if it is already rasterised; never rasterises so may be called by a shaping worker
+        // thread whilst the GUI thread waits.
+        virtual i_glyph const* find_glyph(const glyph_char& aGlyphChar) const = 0;
     };
 }
\ No newline at end of file
@@ -19,6 +19,7 @@
 
 #include <neogfx/neogfx.hpp>
 #include <unordered_map>
+#include <atomic>
 #include <boost/functional/hash.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -29,6 +30,7 @@
 #include FT_ADVANCES_H
 #include "../../native/i_native_texture.hpp"
 #include "native_font_face.hpp"
+#include "glyph_rasteriser.hpp"
 #include <neogfx/gfx/text/i_font_manager.hpp>
 #include <neogfx/gfx/i_texture_atlas.hpp>
 #include <neogfx/gfx/i_rendering_engine.hpp>
@@ -59,13 +61,22 @@ namespace neogfx
         kerning_enabled_flag() = aEnableKerning;
     }
 
+    namespace
+    {
+        uint64_t next_face_serial()
+        {
+            static std::atomic<uint64_t> sNextSerial;
+            return ++sNextSerial;
+        }
+    }
+
     hb_position_t hb_kerning_func(hb_font_t* font, void* font_data, hb_codepoint_t first_glyph, hb_codepoint_t second_glyph, void* user_data)
     {
         return static_cast<hb_position_t>(static_cast<font_face_handle*>(user_data)->owner.kerning(first_glyph, second_glyph));
     }
 
     native_font_face::native_font_face(FT_Library aFontLib, font_id aId, i_native_font& aFont, font_style aStyle, font::point_size aSize, neogfx::size aDpiResolution, FT_Face aFreetypeFace, hb_face_t* aHarfbuzzFace) :
-        iFontLib{ aFontLib }, iId { aId }, iFont{ aFont }, iStyle{ aStyle }, iStyleName{ aFreetypeFace->style_name }, iSize{ aSize }, iPixelDensityDpi{ aDpiResolution }, iHandle{ *this, aFreetypeFace, aHarfbuzzFace }, iHasKerning{ !!FT_HAS_KERNING(iHandle.freetypeFace) }
+        iFontManager{ static_cast<font_manager&>(service<i_font_manager>()) }, iSerial{ next_face_serial() }, iFontLib{ aFontLib }, iId { aId }, iFont{ aFont }, iStyle{ aStyle }, iStyleName{ aFreetypeFace->style_name }, iSize{ aSize }, iPixelDensityDpi{ aDpiResolution }, iHandle{ *this, aFreetypeFace, aHarfbuzzFace }, iHasKerning{ !!FT_HAS_KERNING(iHandle.freetypeFace) }
     {
         switch (aStyle)
         {
@@ -85,6 +96,14 @@ namespace neogfx
 
     native_font_face::~native_font_face()
     {
+        iFontManager.glyph_rasterisation_cancelled(*this);
+        iFontManager.glyphs_released(*this);
+        for (auto& glyph : iGlyphs)
+            iFontManager.glyph_atlas().destroy_sub_texture(iFontManager.glyph_atlas().sub_texture(glyph.second.glyph.texture().atlas_id()));
+        if (iInvalidGlyph)
+            iFontManager.glyph_atlas().destroy_sub_texture(iFontManager.glyph_atlas().sub_texture(iInvalidGlyph->texture().atlas_id()));
+        if (iBlankGlyph)
+            iFontManager.glyph_atlas().destroy_sub_texture(iFontManager.glyph_atlas().sub_texture(iBlankGlyph->texture().atlas_id()));
         if (iHandle.freetypeFace != nullptr)
             sGetAdvanceCache.erase(sGetAdvanceCache.find(iHandle.freetypeFace));
         FT_Done_Face(iHandle.freetypeFace);
@@ -198,6 +217,7 @@ namespace neogfx
     void native_font_face::set_kerning_method(neogfx::kerning_method aKerningMethod)
     {
         iKerningMethod = aKerningMethod;
+        std::scoped_lock lock{ iKerningMutex };
         iKerningTable.clear();
     }
 
@@ -205,6 +225,7 @@ namespace neogfx
     {
         if (!iHasKerning)
             return 0.0;
+        std::scoped_lock lock{ iKerningMutex };
         auto existing = iKerningTable.find(std::make_pair(aLeftGlyphIndex, aRightGlyphIndex));
         if (existing != iKerningTable.end())
             return existing->second;
@@ -271,171 +292,167 @@ namespace neogfx
         return FT_Get_Char_Index(iHandle.freetypeFace, aCodePoint);
     }
 
-    inline glyph_pixel_mode to_glyph_pixel_mode(unsigned char aFreeTypePixelMode)
+    i_glyph& native_font_face::glyph(const glyph_char& aGlyphChar) const
+    {
+        return find_or_rasterise(aGlyphChar.value, true);
+    }
+
+    i_glyph const* native_font_face::find_glyph(const glyph_char& aGlyphChar) const
     {
-        switch (aFreeTypePixelMode)
+        auto existingGlyph = iGlyphs.find(aGlyphChar.value);
+        if (existingGlyph != iGlyphs.end())
+            return &existingGlyph->second.glyph;
+        return nullptr;
+    }
+
+    void native_font_face::prefetch(char32_t aFirst, char32_t aLast) const
+    {
+        bool const async = iFontManager.async_glyph_rasterisation_enabled();
+        for (auto codePoint = aFirst; codePoint <= aLast && codePoint >= aFirst; ++codePoint)
         {
-        default:
-        case FT_PIXEL_MODE_NONE:
-            return glyph_pixel_mode::None;
-        case FT_PIXEL_MODE_MONO:
-            return glyph_pixel_mode::Mono;
-        case FT_PIXEL_MODE_GRAY:
-            return glyph_pixel_mode::Gray;
-        case FT_PIXEL_MODE_GRAY2:
-            return glyph_pixel_mode::Gray2Bit;
-        case FT_PIXEL_MODE_GRAY4:
-            return glyph_pixel_mode::Gray4Bit;
-        case FT_PIXEL_MODE_LCD:
-            return glyph_pixel_mode::LCD;
-        case FT_PIXEL_MODE_LCD_V:
-            return glyph_pixel_mode::LCD_V;
-        case FT_PIXEL_MODE_BGRA:
-            return glyph_pixel_mode::BGRA;
+            auto const glyphIndex = glyph_index(codePoint);
+            if (glyphIndex == 0 || iGlyphs.find(glyphIndex) != iGlyphs.end())
+                continue;
+            if (async)
+                request_glyph(glyphIndex);
+            else
+                find_or_rasterise(glyphIndex, false);
         }
     }
-         
-    i_glyph& native_font_face::glyph(const glyph_char& aGlyphChar) const
-    {
-        // todo: investigate why turning off sub-pixel doesn't produce same grayscale bitmap as Windows with ClearType disabled
-        bool useSubpixelFiltering = true;
 
-        auto existingGlyph = iGlyphs.find(aGlyphChar.value);
+    i_glyph& native_font_face::find_or_rasterise(glyph_index_t aGlyph, bool aAllowPlaceholder) const
+    {
+        auto existingGlyph = iGlyphs.find(aGlyph);
         if (existingGlyph != iGlyphs.end())
-            return existingGlyph->second;
+        {
+            iFontManager.glyph_cache_hit(existingGlyph->second.cacheEntry);
+            return existingGlyph->second.glyph;
+        }
+        if (aAllowPlaceholder &&
+            iFontManager.glyph_placeholder_policy() != glyph_placeholder_policy::Synchronous &&
+            iFontManager.async_glyph_rasterisation_enabled() &&
+            iUnrasterisableGlyphs.find(aGlyph) == iUnrasterisableGlyphs.end())
+        {
+            request_glyph(aGlyph);
+            return placeholder_glyph();
+        }
+        thread_local rasterised_glyph tRasterisedGlyph;
         try
         {
-            try
-            {
-                if (useSubpixelFiltering)
-                {
-                    freetypeCheck(FT_Load_Glyph(iHandle.freetypeFace, aGlyphChar.value, FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_LCD | FT_LOAD_NO_BITMAP));
-                }
-                else
-                {
-                    freetypeCheck(FT_Load_Glyph(iHandle.freetypeFace, aGlyphChar.value, FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_NORMAL | FT_LOAD_NO_BITMAP));
-                }
-            }
-            catch (freetype_error fe)
-            {
-                service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot load font glyph" << endl;
-                throw freetype_load_glyph_error(fe.what());
-            }
-            try
-            {
-                if (useSubpixelFiltering)
-                {
-                    freetypeCheck(FT_Render_Glyph(iHandle.freetypeFace->glyph, FT_RENDER_MODE_LCD));
-                }
-                else
-                {
-                    freetypeCheck(FT_Render_Glyph(iHandle.freetypeFace->glyph, FT_RENDER_MODE_NORMAL));
-                }
-            }
-            catch (freetype_error fe)
-            {
-                service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot render font glyph" << endl;
-                throw freetype_render_glyph_error(fe.what());
-            }
+            glyph_rasteriser::rasterise(iFontLib, iHandle.freetypeFace, aGlyph, embolden_strength(), tRasterisedGlyph);
+        }
+        catch (freetype_load_glyph_error const&)
+        {
+            service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot load font glyph" << endl;
+            return replacement_glyph(aGlyph, aAllowPlaceholder);
+        }
+        catch (freetype_render_glyph_error const&)
+        {
+            service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot render font glyph" << endl;
+            return replacement_glyph(aGlyph, aAllowPlaceholder);
         }
         catch (...)
         {
-            thread_local bool inHere = false;
-            if (!inHere)
-            {
-                neolib::scoped_flag sf{ inHere };
-                glyph_char invalid = aGlyphChar;
-                auto const replacementGlyph = FT_Get_Char_Index(iHandle.freetypeFace, 0xFFFD);
-                if (replacementGlyph != 0)
-                {
-                    invalid.value = replacementGlyph;
-                    return glyph(invalid);
-                }
-            }
-            return invalid_glyph();
+            return replacement_glyph(aGlyph, aAllowPlaceholder);
         }
+        return upload_glyph(tRasterisedGlyph);
+    }
 
-        FT_Bitmap& bitmap = iHandle.freetypeFace->glyph->bitmap;
+    i_glyph& native_font_face::replacement_glyph(glyph_index_t aGlyph, bool aAllowPlaceholder) const
+    {
+        thread_local bool inHere = false;
+        if (!inHere)
+        {
+            neolib::scoped_flag sf{ inHere };
+            auto const replacementGlyph = FT_Get_Char_Index(iHandle.freetypeFace, 0xFFFD);
+            if (replacementGlyph != 0 && replacementGlyph != aGlyph)
+                return find_or_rasterise(replacementGlyph, aAllowPlaceholder);
+        }
+        return invalid_glyph();
+    }
 
-        if ((style() & (font_style::EmulatedBold)) == font_style::EmulatedBold)
-            FT_Bitmap_Embolden(iFontLib, &bitmap, static_cast<FT_F26Dot6>(xn_dpi_scale_factor(iPixelDensityDpi.cx) * 64), 0);
+    i_glyph& native_font_face::upload_glyph(rasterised_glyph const& aGlyph) const
+    {
+        auto& subTexture = iFontManager.glyph_atlas().create_sub_texture(
+            neogfx::size{ static_cast<dimension>(aGlyph.width), static_cast<dimension>(aGlyph.height) }.ceil(),
+            1.0, texture_sampling::Normal, aGlyph.pixelMode == glyph_pixel_mode::LCD ? texture_data_format::SubPixel : texture_data_format::Red);
 
-        auto pixelMode = to_glyph_pixel_mode(bitmap.pixel_mode);
+        rect glyphRect{ subTexture.atlas_location() };
+        auto& newGlyph = iGlyphs.insert(std::make_pair(aGlyph.glyph, cached_glyph{
+            neogfx::glyph{
+                subTexture,
+                aGlyph.subpixel,
+                aGlyph.metrics,
+                aGlyph.pixelMode } })).first->second;
+        i_glyph& glyphTexture = newGlyph.glyph;
 
-        if (pixelMode != glyph_pixel_mode::LCD)
-            useSubpixelFiltering = false;
+        if (aGlyph.width != 0)
+            static_cast<i_native_texture&>(glyphTexture.texture().native_texture()).set_pixels(glyphRect, aGlyph.pixels.data(), 1u);
 
-        auto subTextureWidth = bitmap.width / (useSubpixelFiltering ? 3 : 1);
+        auto const bytesPerPixel = (subTexture.data_format() == texture_data_format::Red ? 1u : 4u);
+        auto const storage = subTexture.atlas_location().extents() + size{ 2.0, 2.0 };
+        newGlyph.cacheEntry = iFontManager.glyph_cached(*this, aGlyph.glyph, subTexture.atlas_id(), static_cast<uint64_t>(storage.cx * storage.cy) * bytesPerPixel);
 
-        auto& subTexture = service<i_font_manager>().glyph_atlas().create_sub_texture(
-            neogfx::size{ static_cast<dimension>(subTextureWidth), static_cast<dimension>(bitmap.rows) }.ceil(),
-            1.0, texture_sampling::Normal, pixelMode == glyph_pixel_mode::LCD ? texture_data_format::SubPixel : texture_data_format::Red);
+        return glyphTexture;
+    }
 
-        rect glyphRect{ subTexture.atlas_location() };
-        i_glyph& glyphTexture = iGlyphs.insert(std::make_pair(aGlyphChar.value,
-            neogfx::glyph{
-                subTexture,
-                useSubpixelFiltering,
-                glyph_metrics{
-                    vec2{ iHandle.freetypeFace->glyph->metrics.width / 64.0, iHandle.freetypeFace->glyph->metrics.height / 64.0 }.round(),
-                    vec2{ iHandle.freetypeFace->glyph->metrics.horiBearingX / 64.0, iHandle.freetypeFace->glyph->metrics.horiBearingY / 64.0 }.round() },
-                pixelMode })).first->second;
-
-        thread_local std::vector<std::uint8_t> glyphTextureData;
-        thread_local std::vector<std::array<std::uint8_t, 4>> subpixelGlyphData;
-        glyphTextureData.clear();
-        subpixelGlyphData.clear();
-
-        const std::uint8_t* textureData = 0;
-        
-        if (subTextureWidth != 0)
+    void native_font_face::request_glyph(glyph_index_t aGlyph) const
+    {
+        if (iPendingGeneration != iFontManager.rasteriser_generation())
         {
-            if (useSubpixelFiltering)
-            {
-                subpixelGlyphData.resize(static_cast<std::size_t>(glyphRect.cx * glyphRect.cy));
-                // sub-pixel FIR filter.
-                static double coefficients[] = { 1.5 / 16.0, 3.5 / 16.0, 6.0 / 16.0, 3.5 / 16.0, 1.5 / 16.0 };
-                for (uint32_t y = 0; y < bitmap.rows; y++)
-                {
-                    for (uint32_t x = 0; x < bitmap.width; x++)
-                    {
-                        uint8_t alpha = 0;
-                        for (int32_t z = -2; z <= 2; ++z)
-                        {
-                            int32_t const s = x + z;
-                            if (s >= 0 && s <= static_cast<int32_t>(bitmap.width) - 1)
-                                alpha += static_cast<uint8_t>(bitmap.buffer[s + bitmap.pitch * y] * coefficients[z + 2]);
-                        }
-                        subpixelGlyphData[(x / 3) + (bitmap.rows - 1 - y) * static_cast<std::size_t>(glyphRect.cx)][x % 3] = alpha;
-                    }
-                }
-                textureData = &subpixelGlyphData[0][0];
-            }
-            else
-            {
-                glyphTextureData.resize(static_cast<std::size_t>(glyphRect.cx * glyphRect.cy));
-                for (uint32_t y = 0; y < bitmap.rows; y++)
-                    switch (bitmap.pixel_mode)
-                    {
-                    case FT_PIXEL_MODE_MONO: // 1 bit per pixel monochrome
-                        for (uint32_t x = 0; x < bitmap.width; x += 8)
-                            for (uint32_t b = 0; b < std::min(bitmap.width - x, 8u); ++b)
-                                glyphTextureData[(x + b) + (bitmap.rows - 1 - y) * static_cast<std::size_t>(glyphRect.cx)] =
-                                    (x >= bitmap.width || y >= bitmap.rows) ? 0x00 : ((bitmap.buffer[x / 8 + bitmap.pitch * y] & (1 << (7 - b))) != 0 ? 0xFF : 0x00);
-                        break;
-                    case FT_PIXEL_MODE_GRAY:
-                    default:
-                        for (uint32_t x = 0; x < bitmap.width; x++)
-                            glyphTextureData[x + (bitmap.rows - 1 - y) * static_cast<std::size_t>(glyphRect.cx)] =
-                                (x >= bitmap.width || y >= bitmap.rows) ? 0x00 : bitmap.buffer[x + bitmap.pitch * y];
-                        break;
-                    }
-                textureData = &glyphTextureData[0];
-            }
-            static_cast<i_native_texture&>(glyphTexture.texture().native_texture()).set_pixels(glyphRect, &textureData[0], 1u);
+            // requests made to a previous rasteriser were discarded with it
+            iPendingGlyphs.clear();
+            iPendingGeneration = iFontManager.rasteriser_generation();
         }
+        if (!iPendingGlyphs.insert(aGlyph).second)
+            return;
+        iFontManager.rasteriser().post(glyph_rasteriser::request{
+            const_cast<native_font_face*>(this),
+            iSerial,
+            iHandle.freetypeFace->stream->base,
+            static_cast<std::size_t>(iHandle.freetypeFace->stream->size),
+            iHandle.freetypeFace->face_index,
+            iRasterSize,
+            embolden_strength(),
+            aGlyph });
+    }
+
+    bool native_font_face::glyph_rasterised(bool aOk, rasterised_glyph const& aGlyph)
+    {
+        if (iPendingGlyphs.erase(aGlyph.glyph) == 0)
+            return false;
+        if (!aOk)
+        {
+            // leave it to the synchronous path to substitute a replacement glyph the next time it is asked for
+            iUnrasterisableGlyphs.insert(aGlyph.glyph);
+            return true;
+        }
+        if (iGlyphs.find(aGlyph.glyph) != iGlyphs.end())
+            return false;
+        upload_glyph(aGlyph);
+        return true;
+    }
 
-        return glyphTexture;
+    FT_Pos native_font_face::embolden_strength() const
+    {
+        if ((style() & (font_style::EmulatedBold)) == font_style::EmulatedBold)
+            return static_cast<FT_Pos>(xn_dpi_scale_factor(iPixelDensityDpi.cx) * 64);
+        return 0;
+    }
+
+    i_glyph& native_font_face::placeholder_glyph() const
+    {
+        if (iFontManager.glyph_placeholder_policy() == glyph_placeholder_policy::Invalid)
+            return invalid_glyph();
+        if (iBlankGlyph == std::nullopt)
+        {
+            auto& subTexture = iFontManager.glyph_atlas().create_sub_texture(
+                neogfx::size{ 1.0, 1.0 }, 1.0, texture_sampling::Normal, texture_data_format::Red);
+            iBlankGlyph.emplace(subTexture, false, glyph_metrics{}, glyph_pixel_mode::Gray);
+            std::uint8_t const blank = 0x00;
+            static_cast<i_native_texture&>(iBlankGlyph->texture().native_texture()).set_pixels(rect{ subTexture.atlas_location() }, &blank, 1u);
+        }
+        return *iBlankGlyph;
     }
 
     i_glyph& native_font_face::invalid_glyph() const
@@ -463,6 +480,16 @@ namespace neogfx
         return *iInvalidGlyph;
     }
 
+    void native_font_face::evict_glyph(glyph_index_t aGlyph)
+    {
+        auto existingGlyph = iGlyphs.find(aGlyph);
+        if (existingGlyph == iGlyphs.end())
+            return;
+        auto& atlas = iFontManager.glyph_atlas();
+        atlas.destroy_sub_texture(atlas.sub_texture(existingGlyph->second.glyph.texture().atlas_id()));
+        iGlyphs.erase(existingGlyph);
+    }
+
     void native_font_face::set_metrics()
     {
         auto const desiredSize = ((style() & (font_style::Superscript | font_style::Subscript)) == font_style::Invalid) ? iSize : iSize * 0.58;
@@ -474,6 +501,7 @@ namespace neogfx
         if (!is_bitmap_font())
         {
             freetypeCheck(FT_Set_Char_Size(iHandle.freetypeFace, 0, static_cast<FT_F26Dot6>(requestedSize * 64), static_cast<FT_UInt>(iPixelDensityDpi.cx), static_cast<FT_UInt>(iPixelDensityDpi.cy)));
+            iRasterSize = glyph_raster_size{ static_cast<FT_F26Dot6>(requestedSize * 64), static_cast<FT_UInt>(iPixelDensityDpi.cx), static_cast<FT_UInt>(iPixelDensityDpi.cy) };
             if (heightSpecified)
             {
                 double const gotHeight = iHandle.freetypeFace->size->metrics.height / 64.0;
@@ -482,6 +510,7 @@ namespace neogfx
                     correction = requestedHeight / gotHeight;
                     auto const corrected = static_cast<FT_F26Dot6>(requestedSize * correction * 64);
                     freetypeCheck(FT_Set_Char_Size(iHandle.freetypeFace, 0, corrected, static_cast<FT_UInt>(iPixelDensityDpi.cx), static_cast<FT_UInt>(iPixelDensityDpi.cy)));
+                    iRasterSize.charHeight = corrected;
                 }
             }
         }
@@ -499,6 +528,7 @@ namespace neogfx
                 }
             }
             freetypeCheck(FT_Select_Size(iHandle.freetypeFace, strikeIndex));
+            iRasterSize = glyph_raster_size{ 0, 0, 0, strikeIndex };
         }
         if (iMetrics == std::nullopt)
             iMetrics.emplace(iHandle.freetypeFace->size->metrics);
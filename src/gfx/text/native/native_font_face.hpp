@@ -21,6 +21,8 @@
 
 #include <neogfx/neogfx.hpp>
 #include <unordered_map>
+#include <unordered_set>
+#include <mutex>
 #include <boost/functional/hash.hpp>
 #include <boost/pool/pool_alloc.hpp>
 #include <ft2build.h>
@@ -40,8 +42,10 @@
 #include <neogfx/hid/i_surface.hpp>
 #include <neogfx/gfx/text/font.hpp>
 #include <neogfx/gfx/text/glyph_text.hpp>
+#include <neogfx/gfx/text/font_manager.hpp>
 #include "i_native_font.hpp"
 #include "i_native_font_face.hpp"
+#include "glyph_rasteriser.hpp"
 
 namespace neogfx
 {
@@ -103,8 +107,14 @@ namespace neogfx
 
     class native_font_face : public neolib::reference_counted<i_native_font_face>
     {
+        friend class font_manager;
     private:
-        typedef std::unordered_map<glyph_index_t, neogfx::glyph> glyph_map;
+        struct cached_glyph
+        {
+            neogfx::glyph glyph;
+            font_manager::glyph_cache::iterator cacheEntry;
+        };
+        typedef std::unordered_map<glyph_index_t, cached_glyph> glyph_map;
         typedef std::pair<glyph_index_t, glyph_index_t> kerning_pair;
         typedef std::unordered_map<kerning_pair, dimension, boost::hash<kerning_pair>, std::equal_to<kerning_pair>,
             boost::fast_pool_allocator<std::pair<const kerning_pair, dimension>>> kerning_table;
@@ -143,10 +153,23 @@ namespace neogfx
         void* handle() const final;
         glyph_index_t glyph_index(char32_t aCodePoint) const final;
         i_glyph& glyph(const glyph_char& aGlyphChar) const final;
+        i_glyph const* find_glyph(const glyph_char& aGlyphChar) const final;
+    public:
+        void prefetch(char32_t aFirst, char32_t aLast) const;
     private:
+        i_glyph& find_or_rasterise(glyph_index_t aGlyph, bool aAllowPlaceholder) const;
+        i_glyph& replacement_glyph(glyph_index_t aGlyph, bool aAllowPlaceholder) const;
+        i_glyph& upload_glyph(rasterised_glyph const& aGlyph) const;
+        void request_glyph(glyph_index_t aGlyph) const;
+        bool glyph_rasterised(bool aOk, rasterised_glyph const& aGlyph);
+        FT_Pos embolden_strength() const;
+        i_glyph& placeholder_glyph() const;
         i_glyph& invalid_glyph() const;
+        void evict_glyph(glyph_index_t aGlyph);
         void set_metrics();
     private:
+        font_manager& iFontManager;
+        uint64_t iSerial;
         FT_Library iFontLib;
         font_id iId;
         i_native_font& iFont;
@@ -156,13 +179,19 @@ namespace neogfx
         neogfx::size iPixelDensityDpi;
         mutable font_face_handle iHandle;
         std::optional<FT_Size_Metrics> iMetrics;
+        glyph_raster_size iRasterSize = {};
         mutable ref_ptr<i_native_font_face> iFallbackFont;
         mutable glyph_map iGlyphs;
+        mutable std::unordered_set<glyph_index_t> iPendingGlyphs;
+        mutable uint32_t iPendingGeneration = 0u;
+        mutable std::unordered_set<glyph_index_t> iUnrasterisableGlyphs;
         bool iHasKerning = false;
         neogfx::kerning_method iKerningMethod = neogfx::kerning_method::Harfbuzz;
+        mutable std::mutex iKerningMutex; // shaping may run on worker threads
         mutable kerning_table iKerningTable;
         mutable std::optional<bool> iHasFallback;
         mutable std::optional<neogfx::glyph> iInvalidGlyph;
+        mutable std::optional<neogfx::glyph> iBlankGlyph;
     };
 
     bool kerning_enabled();
@@ -25,6 +25,25 @@
 
 namespace neogfx
 {
+    namespace
+    {
+        // Zeroes a freed rect (padding ring included) so that space reused by a smaller sub-texture, or the
+        // padding sampled by bilinear filtering at its edges, never shows stale pixels of a previous occupant.
+        void clear_space(i_texture& aPage, const rect& aSpace)
+        {
+            auto const space = aSpace.intersection(rect{ point{}, aPage.extents() });
+            if (space.empty())
+                return;
+            std::size_t const bytesPerPixel = (aPage.data_format() == texture_data_format::Red ? 1u : 4u) *
+                (aPage.data_type() == texture_data_type::Float ? sizeof(float) : 1u);
+            std::size_t const bytes = static_cast<std::size_t>(space.cx) * static_cast<std::size_t>(space.cy) * bytesPerPixel;
+            thread_local std::vector<std::uint8_t> zeroes;
+            if (zeroes.size() < bytes)
+                zeroes.resize(bytes, 0u);
+            aPage.set_pixels(space, zeroes.data(), 1u);
+        }
+    }
+
     texture_atlas::texture_atlas(const size& aPageSize) :
         iTextureManager{ service<i_texture_manager>() }, iPageSize{ aPageSize }
     {
@@ -80,15 +99,53 @@ namespace neogfx
         auto iterEntry = iEntries.find(aSubTexture.atlas_id());
         if (iterEntry == iEntries.end() || &aSubTexture != &iterEntry->second.second)
             throw sub_texture_not_found();
-        auto rectEntry = iterEntry->second.second.atlas_location();
-        auto space = iterEntry->second.first->second.used.find(rectEntry);
-        if (space != iterEntry->second.first->second.used.end())
-            iterEntry->second.first->second.used.erase(space);
-        iterEntry->second.first->second.freed.insert(rectEntry);
+        auto& page = *iterEntry->second.first;
+        auto const space = iterEntry->second.second.atlas_location() + point{ -1.0, -1.0 } + size{ 2.0, 2.0 };
+        clear_space(page.first, space);
+        page.second.remove(space);
         iTextureManager.remove_sub_texture(aSubTexture);
         iEntries.erase(iterEntry);
     }
 
+    texture_atlas_statistics texture_atlas::statistics() const
+    {
+        texture_atlas_statistics result{};
+        dimension largestFreeAreaPerPage = 0.0;
+        for (auto const& page : iPages)
+        {
+            auto const& pack = page.second.pack;
+            ++result.pages;
+            result.subTextures += static_cast<uint32_t>(pack.used_count());
+            result.freeRects += static_cast<uint32_t>(pack.free_count());
+            result.totalArea += pack.dimensions().cx * pack.dimensions().cy;
+            result.usedArea += pack.used_area();
+            result.freeArea += pack.free_area();
+            largestFreeAreaPerPage += pack.largest_free_area();
+            result.largestFreeArea = std::max(result.largestFreeArea, pack.largest_free_area());
+        }
+        if (result.totalArea != 0.0)
+            result.occupancy = result.usedArea / result.totalArea;
+        if (result.freeArea != 0.0)
+            result.fragmentation = 1.0 - largestFreeAreaPerPage / result.freeArea;
+        return result;
+    }
+
+    void texture_atlas::compact()
+    {
+        // sub-textures are referenced by location (glyphs hold copies) so occupied space is never relocated;
+        // instead empty pages are released and the free space of the remaining pages is recomputed exactly
+        for (auto iterPage = iPages.begin(); iterPage != iPages.end();)
+        {
+            if (iterPage->second.pack.empty())
+                iterPage = iPages.erase(iterPage);
+            else
+            {
+                iterPage->second.pack.rebuild();
+                ++iterPage;
+            }
+        }
+    }
+
     const size& texture_atlas::page_size() const
     {
         return iPageSize;
@@ -0,0 +1,110 @@
+// vertex_transform.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+#include <neogfx/gfx/vertex_transform.hpp>
+
+#if defined(__AVX__)
+#define NEOGFX_VERTEX_TRANSFORM_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEOGFX_VERTEX_TRANSFORM_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace neogfx
+{
+    namespace
+    {
+        // Matrices are column major: aMatrix[column][row].
+        inline bool is_affine(mat44 const& aMatrix)
+        {
+            return aMatrix[0][3] == 0.0 && aMatrix[1][3] == 0.0 && aMatrix[2][3] == 0.0 && aMatrix[3][3] == 1.0;
+        }
+    }
+
+    void transform_vertices(optional_mat44 const& aTransformation, vec3 const* aInput, std::size_t aCount, vec3f* aOutput)
+    {
+        if (aTransformation == std::nullopt)
+        {
+            for (std::size_t index = 0; index < aCount; ++index)
+                aOutput[index] = aInput[index].as<float>();
+            return;
+        }
+
+        auto const& m = *aTransformation;
+        if (!is_affine(m))
+        {
+            for (std::size_t index = 0; index < aCount; ++index)
+                aOutput[index] = (m * aInput[index]).as<float>();
+            return;
+        }
+
+#if defined(NEOGFX_VERTEX_TRANSFORM_AVX)
+        __m256d const column0 = _mm256_loadu_pd(&m[0][0]);
+        __m256d const column1 = _mm256_loadu_pd(&m[1][0]);
+        __m256d const column2 = _mm256_loadu_pd(&m[2][0]);
+        __m256d const column3 = _mm256_loadu_pd(&m[3][0]);
+        for (std::size_t index = 0; index < aCount; ++index)
+        {
+            auto const& v = aInput[index];
+            __m256d const xy = _mm256_add_pd(_mm256_mul_pd(column0, _mm256_set1_pd(v.x)), _mm256_mul_pd(column1, _mm256_set1_pd(v.y)));
+            __m256d const zw = _mm256_add_pd(_mm256_mul_pd(column2, _mm256_set1_pd(v.z)), column3);
+            alignas(16) float result[4];
+            _mm_store_ps(result, _mm256_cvtpd_ps(_mm256_add_pd(xy, zw)));
+            aOutput[index] = vec3f{ result[0], result[1], result[2] };
+        }
+#elif defined(NEOGFX_VERTEX_TRANSFORM_SSE2)
+        // each column is held as two lanes of x and y and two lanes of z and w
+        __m128d const column0xy = _mm_loadu_pd(&m[0][0]);
+        __m128d const column0zw = _mm_loadu_pd(&m[0][2]);
+        __m128d const column1xy = _mm_loadu_pd(&m[1][0]);
+        __m128d const column1zw = _mm_loadu_pd(&m[1][2]);
+        __m128d const column2xy = _mm_loadu_pd(&m[2][0]);
+        __m128d const column2zw = _mm_loadu_pd(&m[2][2]);
+        __m128d const column3xy = _mm_loadu_pd(&m[3][0]);
+        __m128d const column3zw = _mm_loadu_pd(&m[3][2]);
+        for (std::size_t index = 0; index < aCount; ++index)
+        {
+            auto const& v = aInput[index];
+            __m128d const x = _mm_set1_pd(v.x);
+            __m128d const y = _mm_set1_pd(v.y);
+            __m128d const z = _mm_set1_pd(v.z);
+            __m128d const xy = _mm_add_pd(
+                _mm_add_pd(_mm_mul_pd(column0xy, x), _mm_mul_pd(column1xy, y)),
+                _mm_add_pd(_mm_mul_pd(column2xy, z), column3xy));
+            __m128d const zw = _mm_add_pd(
+                _mm_add_pd(_mm_mul_pd(column0zw, x), _mm_mul_pd(column1zw, y)),
+                _mm_add_pd(_mm_mul_pd(column2zw, z), column3zw));
+            alignas(16) float result[4];
+            _mm_store_ps(result, _mm_movelh_ps(_mm_cvtpd_ps(xy), _mm_cvtpd_ps(zw)));
+            aOutput[index] = vec3f{ result[0], result[1], result[2] };
+        }
+#else
+        for (std::size_t index = 0; index < aCount; ++index)
+        {
+            auto const& v = aInput[index];
+            aOutput[index] = vec3f{
+                static_cast<float>(m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z + m[3][0]),
+                static_cast<float>(m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z + m[3][1]),
+                static_cast<float>(m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z + m[3][2]) };
+        }
+#endif
+    }
+}
\ No newline at end of file
@@ -18,6 +18,7 @@
 */
 
 #include <neogfx/neogfx.hpp>
+#include <chrono>
 #include <neogfx/gui/layout/async_layout.hpp>
 
 template <> neogfx::i_async_layout& services::start_service<neogfx::i_async_layout>()
@@ -33,7 +34,10 @@ namespace neogfx
         {
             aTimer.again();
             process();
-        }, std::chrono::milliseconds{ 20 } }
+        }, std::chrono::milliseconds{ 20 } },
+        iQueued{ 0u },
+        iMerged{ 0u },
+        iLastTickStatistics{}
     {
     }
 
@@ -46,10 +50,24 @@ namespace neogfx
     {
         if (aWidget.has_root())
         {
+            ++iQueued;
             if (!exists(aWidget))
-                iPending.emplace_back(aWidget, &aWidget);
+            {
+                // a stale entry for a destroyed widget at the same address is reused
+                auto existing = iPendingIndex.find(&aWidget);
+                if (existing != iPendingIndex.end())
+                    iPending[existing->second] = entry{ aWidget, &aWidget };
+                else
+                {
+                    iPendingIndex.emplace(&aWidget, iPending.size());
+                    iPending.emplace_back(aWidget, &aWidget);
+                }
+            }
             else
+            {
+                ++iMerged;
                 invalidate(aWidget);
+            }
             return true;
         }
         return false;
@@ -71,50 +89,76 @@ namespace neogfx
             (**existing).validated = false;
     }
 
+    async_layout_statistics const& async_layout::last_tick_statistics() const
+    {
+        return iLastTickStatistics;
+    }
+
     std::optional<async_layout::entry_queue::const_iterator> async_layout::pending(i_widget& aWidget) const noexcept
     {
-        auto existing = std::find_if(iPending.begin(), iPending.end(), [&](auto const& e) { return !e.destroyed && e.widget == &aWidget; });
-        if (existing != iPending.end())
-            return existing;
-        else
-            return std::nullopt;
+        return find(iPending, iPendingIndex, aWidget);
     }
 
     std::optional<async_layout::entry_queue::iterator> async_layout::pending(i_widget& aWidget) noexcept
     {
-        auto existing = std::find_if(iPending.begin(), iPending.end(), [&](auto const& e) { return !e.destroyed && e.widget == &aWidget; });
-        if (existing != iPending.end())
-            return existing;
-        else
-            return std::nullopt;
+        return find(iPending, iPendingIndex, aWidget);
     }
 
     std::optional<async_layout::entry_queue::const_iterator> async_layout::processing(i_widget& aWidget) const noexcept
     {
-        auto existing = std::find_if(iProcessing.begin(), iProcessing.end(), [&](auto const& e) { return !e.destroyed && e.widget == &aWidget; });
-        if (existing != iProcessing.end())
-            return existing;
+        return find(iProcessing, iProcessingIndex, aWidget);
+    }
+
+    std::optional<async_layout::entry_queue::iterator> async_layout::processing(i_widget& aWidget) noexcept
+    {
+        return find(iProcessing, iProcessingIndex, aWidget);
+    }
+
+    std::optional<async_layout::entry_queue::const_iterator> async_layout::find(entry_queue const& aQueue, entry_index const& aIndex, i_widget& aWidget) noexcept
+    {
+        auto existing = aIndex.find(&aWidget);
+        if (existing != aIndex.end() && !aQueue[existing->second].destroyed)
+            return std::next(aQueue.begin(), existing->second);
         else
             return std::nullopt;
     }
 
-    std::optional<async_layout::entry_queue::iterator> async_layout::processing(i_widget& aWidget) noexcept
+    std::optional<async_layout::entry_queue::iterator> async_layout::find(entry_queue& aQueue, entry_index const& aIndex, i_widget& aWidget) noexcept
     {
-        auto existing = std::find_if(iProcessing.begin(), iProcessing.end(), [&](auto const& e) { return !e.destroyed && e.widget == &aWidget; });
-        if (existing != iProcessing.end())
-            return existing;
+        auto existing = aIndex.find(&aWidget);
+        if (existing != aIndex.end() && !aQueue[existing->second].destroyed)
+            return std::next(aQueue.begin(), existing->second);
         else
             return std::nullopt;
     }
 
     void async_layout::process()
     {
+        auto const start = std::chrono::steady_clock::now();
+
         std::swap(iPending, iProcessing);
+        std::swap(iPendingIndex, iProcessingIndex);
+
+        // lay out top-down so that a widget laid out as part of an ancestor's layout is validated (and
+        // skipped) before its own turn; each subtree is then laid out once per tick
+        for (auto& e : iProcessing)
+            if (!e.destroyed)
+                for (auto w = e.widget; w->has_parent(); w = &w->parent())
+                    ++e.depth;
+        std::stable_sort(iProcessing.begin(), iProcessing.end(), [](entry const& aLhs, entry const& aRhs) { return aLhs.depth < aRhs.depth; });
+        iProcessingIndex.clear();
+        for (std::size_t i = 0; i < iProcessing.size(); ++i)
+            iProcessingIndex[iProcessing[i].widget] = i;
 
+        uint32_t laidOut = 0u;
+        uint32_t skipped = 0u;
         for (auto& e : iProcessing)
         {
             if (e.validated || e.destroyed)
+            {
+                ++skipped;
                 continue;
+            }
             auto& next = *e.widget;
 #ifdef NEOGFX_DEBUG
             if (debug::layoutItem == &next)
@@ -125,9 +169,19 @@ namespace neogfx
                 neolib::scoped_optional_if soi{ next.layout_reason(), layout_reason::Async };
                 next.layout_items();
                 next.update();
+                ++laidOut;
             }
         }
 
+        iLastTickStatistics = async_layout_statistics{ 
+            iQueued, 
+            iMerged + skipped, 
+            laidOut, 
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start) };
+        iQueued = 0u;
+        iMerged = 0u;
+
         iProcessing.clear();
+        iProcessingIndex.clear();
     }
 }
\ No newline at end of file
@@ -18,17 +18,207 @@
 */
 
 #include <neogfx/neogfx.hpp>
+#include <bit>
 #include <neolib/task/thread.hpp>
 #include <neogfx/app/i_basic_services.hpp>
 #include <neolib/app/i_power.hpp>
 #include <neogfx/app/i_app.hpp>
+#include <neogfx/gfx/text/i_font_manager.hpp>
 #include <neogfx/gui/widget/scrollable_widget.ipp>
 #include <neogfx/gui/widget/terminal.hpp>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEOGFX_TERMINAL_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace neogfx
 {
+    namespace
+    {
+        inline bool is_printable(char32_t aCharacter)
+        {
+            return aCharacter >= U'\x20' && aCharacter != U'\x7F';
+        }
+
+        // Returns the end of the run of printable characters starting at aStart; control characters (including
+        // ESC) end a run. Four code points are tested at a time where SSE2 is available.
+        std::size_t printable_run_end(std::u32string const& aText, std::size_t aStart)
+        {
+            auto const size = aText.size();
+            auto next = aStart;
+#ifdef NEOGFX_TERMINAL_SSE2
+            __m128i const space = _mm_set1_epi32(0x20);
+            __m128i const del = _mm_set1_epi32(0x7F);
+            for (; next + 4u <= size; next += 4u)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(aText.data() + next));
+                __m128i const stop = _mm_or_si128(_mm_cmplt_epi32(block, space), _mm_cmpeq_epi32(block, del));
+                auto const mask = static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(stop)));
+                if (mask != 0u)
+                    return next + std::countr_zero(mask);
+            }
+#endif
+            while (next < size && is_printable(aText[next]))
+                ++next;
+            return next;
+        }
+
+        // Code points that attach to the preceding code point so must be shaped with it.
+        inline bool is_cluster_extender(char32_t aCharacter)
+        {
+            return (aCharacter >= U'\x0300' && aCharacter <= U'\x036F') ||
+                (aCharacter >= U'\x1AB0' && aCharacter <= U'\x1AFF') ||
+                (aCharacter >= U'\x1DC0' && aCharacter <= U'\x1DFF') ||
+                (aCharacter >= U'\x20D0' && aCharacter <= U'\x20FF') ||
+                aCharacter == U'\x200D' ||
+                (aCharacter >= U'\xFE00' && aCharacter <= U'\xFE0F') ||
+                (aCharacter >= U'\xFE20' && aCharacter <= U'\xFE2F') ||
+                (aCharacter >= U'\U0001F3FB' && aCharacter <= U'\U0001F3FF') ||
+                (aCharacter >= U'\U000E0020' && aCharacter <= U'\U000E007F') ||
+                (aCharacter >= U'\U000E0100' && aCharacter <= U'\U000E01EF');
+        }
+
+        inline void place_in_cell(glyph_char& aGlyph, float aX, float aWidth)
+        {
+            aGlyph.cell[0].x = aX;
+            aGlyph.cell[1].x = aX + aWidth;
+            aGlyph.cell[2].x = aX + aWidth;
+            aGlyph.cell[3].x = aX;
+        }
+    }
+
     template class scrollable_widget<framed_widget<widget<i_terminal>>>;
 
+    terminal::line_buffer::line_buffer(std::size_t aCapacity) :
+        iCapacity{ std::max<std::size_t>(aCapacity, 1u) }
+    {
+    }
+
+    std::size_t terminal::line_buffer::size() const
+    {
+        return iSize;
+    }
+
+    bool terminal::line_buffer::empty() const
+    {
+        return iSize == 0u;
+    }
+
+    std::size_t terminal::line_buffer::capacity() const
+    {
+        return iCapacity;
+    }
+
+    void terminal::line_buffer::set_capacity(std::size_t aCapacity)
+    {
+        aCapacity = std::max<std::size_t>(aCapacity, 1u);
+        if (iSize > aCapacity)
+            pop_front(iSize - aCapacity);
+        linearize();
+        if (iLines.size() > aCapacity)
+            iLines.resize(aCapacity);
+        iCapacity = aCapacity;
+    }
+
+    terminal::buffer_line const& terminal::line_buffer::operator[](std::size_t aIndex) const
+    {
+        return iLines[physical(aIndex)];
+    }
+
+    terminal::buffer_line& terminal::line_buffer::operator[](std::size_t aIndex)
+    {
+        return iLines[physical(aIndex)];
+    }
+
+    terminal::buffer_line& terminal::line_buffer::back()
+    {
+        return (*this)[iSize - 1u];
+    }
+
+    terminal::buffer_line& terminal::line_buffer::emplace_back()
+    {
+        if (iSize == iLines.size())
+        {
+            if (iLines.size() < iCapacity)
+            {
+                // storage only grows whilst the ring starts at the beginning of it
+                linearize();
+                iLines.emplace_back();
+                ++iSize;
+                return iLines.back();
+            }
+            pop_front();
+        }
+        // reuse a discarded line (and its allocations)
+        auto& result = iLines[physical(iSize++)];
+        result.text.clear();
+        result.glyphs = std::nullopt;
+        result.attributes.clear();
+        return result;
+    }
+
+    terminal::buffer_line& terminal::line_buffer::insert(std::size_t aIndex)
+    {
+        aIndex = std::min(aIndex, iSize);
+        if (iSize == iCapacity && aIndex > 0u)
+            --aIndex; // the oldest line is about to be discarded
+        emplace_back();
+        for (auto i = iSize - 1u; i > aIndex; --i)
+            std::swap((*this)[i], (*this)[i - 1u]);
+        return (*this)[aIndex];
+    }
+
+    void terminal::line_buffer::erase(std::size_t aIndex)
+    {
+        erase(aIndex, aIndex + 1u);
+    }
+
+    void terminal::line_buffer::erase(std::size_t aFirst, std::size_t aLast)
+    {
+        aLast = std::min(aLast, iSize);
+        if (aFirst >= aLast)
+            return;
+        if (aFirst == 0u)
+        {
+            pop_front(aLast);
+            return;
+        }
+        auto const count = aLast - aFirst;
+        for (auto i = aFirst; i + count < iSize; ++i)
+            std::swap((*this)[i], (*this)[i + count]);
+        iSize -= count;
+    }
+
+    void terminal::line_buffer::pop_front(std::size_t aCount)
+    {
+        aCount = std::min(aCount, iSize);
+        if (aCount == 0u)
+            return;
+        iHead = (iHead + aCount) % iLines.size();
+        iSize -= aCount;
+    }
+
+    void terminal::line_buffer::clear()
+    {
+        iHead = 0u;
+        iSize = 0u;
+    }
+
+    std::size_t terminal::line_buffer::physical(std::size_t aIndex) const
+    {
+        auto const index = iHead + aIndex;
+        return index < iLines.size() ? index : index - iLines.size();
+    }
+
+    void terminal::line_buffer::linearize()
+    {
+        if (iHead == 0u)
+            return;
+        std::rotate(iLines.begin(), std::next(iLines.begin(), iHead), iLines.end());
+        iHead = 0u;
+    }
+
     terminal::terminal() : 
         iTerminalSize{ 80, 25 },
         iBufferSize{ 80, 250 },
@@ -110,9 +300,8 @@ namespace neogfx
             auto overflow = std::min(static_cast<dimension_type>(active_buffer().lines.size()), -yDelta);
             if (active_buffer().scrollingRegion)
             {
-                auto eraseStart = std::next(active_buffer().lines.begin(), std::max(0, buffer_origin().y - overflow));
-                auto eraseEnd = std::next(eraseStart, std::min(overflow, static_cast<dimension_type>(std::distance(eraseStart, active_buffer().lines.end()))));
-                active_buffer().lines.erase(eraseStart, eraseEnd);
+                auto const eraseStart = static_cast<std::size_t>(std::max(0, buffer_origin().y - overflow));
+                active_buffer().lines.erase(eraseStart, eraseStart + overflow);
             }
             else
                 set_buffer_origin(buffer_origin() + point_type{ 0, overflow });
@@ -164,28 +353,18 @@ namespace neogfx
 
         scoped_scissor ss{ aGc, cr };
 
-        scalar y = -vertical_scrollbar().position();
+        auto const& lines = active_buffer().lines;
+        // start at the first visible row rather than walking the scrollback
+        auto const firstRow = static_cast<std::size_t>(std::max(0.0, std::floor((vertical_scrollbar().position() + cr.top()) / ce.cy) - 1.0));
+        scalar y = -vertical_scrollbar().position() + firstRow * ce.cy;
 
-        for (auto const& line : active_buffer().lines)
+        for (auto row = firstRow; row < lines.size() && y < cr.bottom(); ++row, y += ce.cy)
         {
+            auto const& line = lines[row];
+            if (y + ce.cy < cr.top())
+                continue;
             if (line.glyphs == std::nullopt)
-            {
-                line.glyphs = aGc.to_glyph_text(line.text,
-                    [&](std::size_t n) -> neogfx::font
-                    {
-                        return n < line.attributes.size() ? font(line.attributes[n].style) : normal_font();
-                    });
-                float xPrevious = 0.0f;
-                for (auto& g : *line.glyphs)
-                {
-                    g.cell[0].x = xPrevious;
-                    g.cell[1].x = xPrevious + static_cast<float>(ce.cx);
-                    g.cell[2].x = xPrevious + static_cast<float>(ce.cx);
-                    g.cell[3].x = xPrevious;
-                    xPrevious += static_cast<float>(ce.cx);
-                }
-            }
-            if (y + ce.cy >= cr.top() && y < cr.bottom())
+                line.glyphs = shape_line(aGc, line);
             {
                 thread_local text_format_spans attributes;
                 attributes.clear();
@@ -212,7 +391,6 @@ namespace neogfx
                 }
                 aGc.draw_glyphs(tl + point{ 0, y }, *line.glyphs, attributes);
             }
-            y += ce.cy;
         }
 
         if (has_focus())
@@ -236,6 +414,7 @@ namespace neogfx
         iItalicFont = std::nullopt;
         iBoldItalicFont = std::nullopt;
         iCharacterExtents = std::nullopt;
+        iCellGlyphs.clear();
         set_ideal_size(padding().size() + character_extents() * size { iTerminalSize } +
             size{ effective_frame_width() } + size{ vertical_scrollbar().width(), horizontal_scrollbar().width() });
         iPrimaryBuffer.cursor.set_width(character_extents().cx);
@@ -504,6 +683,29 @@ namespace neogfx
         return iTerminalSize;
     }
 
+    terminal::dimension_type terminal::scrollback_limit() const
+    {
+        return iBufferSize.cy;
+    }
+
+    void terminal::set_scrollback_limit(dimension_type aLines)
+    {
+        aLines = std::max(aLines, iTerminalSize.cy);
+        if (iBufferSize.cy == aLines)
+            return;
+        iBufferSize.cy = aLines;
+        for (auto buffer : { &iPrimaryBuffer, &iAlternateBuffer })
+        {
+            auto const discarded = static_cast<coordinate_type>(buffer->lines.size()) - aLines;
+            buffer->lines.set_capacity(static_cast<std::size_t>(aLines));
+            if (discarded > 0)
+                buffer->bufferOrigin.y = std::max(0, buffer->bufferOrigin.y - discarded);
+        }
+        update_scrollbar_visibility();
+        make_cursor_visible();
+        update();
+    }
+
     void terminal::output(i_string const& aOutput)
     {
         // todo: apply a bit of functional decomposition to this function which is getting a tad long...
@@ -511,8 +713,17 @@ namespace neogfx
         neolib::scoped_flag sf{ iOutputting };
 
         auto utf32 = neolib::utf8_to_utf32(aOutput.to_std_string_view());
-        for (auto ch : utf32)
+        for (std::size_t index = 0; index < utf32.size(); ++index)
         {
+            auto const ch = utf32[index];
+            // plain text is written a run at a time rather than a character at a time
+            if (!iEscapeSequence && is_printable(ch))
+            {
+                auto const runEnd = printable_run_end(utf32, index);
+                output_run(std::u32string_view{ utf32 }.substr(index, runEnd - index));
+                index = runEnd - 1;
+                continue;
+            }
 #if 0 // for debugging purposes...
             if (ch >= U' ')
                 std::cout << (char) ch << std::flush;
@@ -533,13 +744,13 @@ namespace neogfx
                     {
                         if (!active_buffer().scrollingRegion)
                         {
-                            active_buffer().lines.erase(std::next(active_buffer().lines.begin(), buffer_origin().y + iTerminalSize.cy - 1));
-                            active_buffer().lines.insert(std::next(active_buffer().lines.begin(), buffer_origin().y), buffer_line{});
+                            active_buffer().lines.erase(buffer_origin().y + iTerminalSize.cy - 1);
+                            active_buffer().lines.insert(buffer_origin().y);
                         }
                         else
                         {
-                            active_buffer().lines.erase(std::next(active_buffer().lines.begin(), buffer_origin().y + active_buffer().scrollingRegion.value().bottom));
-                            active_buffer().lines.insert(std::next(active_buffer().lines.begin(), buffer_origin().y + active_buffer().scrollingRegion.value().top), buffer_line{});
+                            active_buffer().lines.erase(buffer_origin().y + active_buffer().scrollingRegion.value().bottom);
+                            active_buffer().lines.insert(buffer_origin().y + active_buffer().scrollingRegion.value().top);
                         }
                     }
                     iEscapeSequence = std::nullopt;
@@ -634,7 +845,7 @@ namespace neogfx
                                 auto lines = (params.empty() ? 1 : std::stoi(params[0]));
                                 while (lines--)
                                 {
-                                    active_buffer().lines.erase(std::next(active_buffer().lines.begin(), buffer_origin().y));
+                                    active_buffer().lines.erase(buffer_origin().y);
                                     (void)line(buffer_origin().y + iTerminalSize.cy - 1);
                                 }
                             }
@@ -646,8 +857,8 @@ namespace neogfx
                                 auto lines = (params.empty() ? 1 : std::stoi(params[0]));
                                 while (lines--)
                                 {
-                                    active_buffer().lines.erase(std::next(active_buffer().lines.begin(), buffer_origin().y + iTerminalSize.cy - 1));
-                                    active_buffer().lines.insert(std::next(active_buffer().lines.begin(), buffer_origin().y), buffer_line{});
+                                    active_buffer().lines.erase(buffer_origin().y + iTerminalSize.cy - 1);
+                                    active_buffer().lines.insert(buffer_origin().y);
                                 }
                             }
                             catch (...) {}
@@ -715,10 +926,10 @@ namespace neogfx
                                 bottom += buffer_origin().y;
                                 while (lines--)
                                 {
-                                    auto inserted = active_buffer().lines.insert(std::next(active_buffer().lines.begin(), buffer_pos().y), buffer_line{});
-                                    inserted->text.reserve(iBufferSize.cx);
-                                    inserted->attributes.reserve(iBufferSize.cx);
-                                    active_buffer().lines.erase(std::next(active_buffer().lines.begin(), bottom + 1));
+                                    active_buffer().lines.erase(bottom);
+                                    auto& inserted = active_buffer().lines.insert(buffer_pos().y);
+                                    inserted.text.reserve(iBufferSize.cx);
+                                    inserted.attributes.reserve(iBufferSize.cx);
                                 }
                                 set_cursor_pos(cursor_pos().with_x(0));
                             }
@@ -1070,8 +1281,8 @@ namespace neogfx
                         set_cursor_pos(cursor_pos().with_y(cursor_pos().y + 1));
                     else
                     {
-                        active_buffer().lines.erase(std::next(active_buffer().lines.begin(), active_buffer().scrollingRegion.value().top + buffer_origin().y));
-                        active_buffer().lines.insert(std::next(active_buffer().lines.begin(), active_buffer().scrollingRegion.value().bottom + buffer_origin().y), buffer_line{});
+                        active_buffer().lines.erase(active_buffer().scrollingRegion.value().top + buffer_origin().y);
+                        active_buffer().lines.insert(active_buffer().scrollingRegion.value().bottom + buffer_origin().y);
                     }
                     break;
                 case U'\0':
@@ -1093,7 +1304,9 @@ namespace neogfx
                 }
             }
         }
-        update_cursor();
+        // repainting is deferred to the next animation tick so a flood of output is parsed at full speed
+        // but only repainted at the frame rate
+        iUpdatePending = true;
     }
 
     cursor& terminal::cursor() const
@@ -1103,6 +1316,8 @@ namespace neogfx
 
     void terminal::init()
     {
+        iPrimaryBuffer.lines.set_capacity(static_cast<std::size_t>(iBufferSize.cy));
+        iAlternateBuffer.lines.set_capacity(static_cast<std::size_t>(iBufferSize.cy));
         vertical_scrollbar().set_style(vertical_scrollbar().style() | scrollbar_style::AlwaysVisible);
         horizontal_scrollbar().set_style(scrollbar_style::None);
         set_ideal_size(padding().size() + character_extents() * size { iTerminalSize } +
@@ -1143,6 +1358,7 @@ namespace neogfx
     {
         iActiveBuffer = &iAlternateBuffer;
         iAlternateBuffer = {};
+        iAlternateBuffer.lines.set_capacity(static_cast<std::size_t>(iBufferSize.cy));
         iAlternateBuffer.cursor.set_style(cursor_style::Xor);
         iAlternateBuffer.cursor.set_width(character_extents().cx);
         set_cursor_pos({});
@@ -1232,12 +1448,123 @@ namespace neogfx
 
     void terminal::animate()
     {
+        if (iUpdatePending)
+        {
+            iUpdatePending = false;
+            update_cursor();
+        }
         if (neolib::service<neolib::i_power>().green_mode_active())
             return;
         if (has_focus())
             update(cursor_rect());
     }
 
+    terminal::cell_glyph const& terminal::shape_cell(i_graphics_context const& aGc, neogfx::font const& aFont, char32_t aCharacter) const
+    {
+        auto const key = (static_cast<std::uint64_t>(aFont.id()) << 32u) | static_cast<std::uint64_t>(aCharacter);
+        auto existing = iCellGlyphs.find(key);
+        if (existing != iCellGlyphs.end())
+            return existing->second;
+        cell_glyph result;
+        result.extendsCluster = is_cluster_extender(aCharacter);
+        if (!result.extendsCluster)
+        {
+            auto const shaped = service<i_font_manager>().glyph_text_factory().to_glyph_text(
+                aGc, &aCharacter, &aCharacter + 1, aFont, false);
+            if (shaped.size() == 1u)
+            {
+                auto const& glyph = *shaped.begin();
+                if (category(glyph) == text_category::Mark)
+                    result.extendsCluster = true;
+                else if (category(glyph) != text_category::Emoji && category(glyph) != text_category::FontEmoji)
+                    result.glyph = glyph;
+            }
+        }
+        return iCellGlyphs.emplace(key, result).first->second;
+    }
+
+    glyph_text terminal::shape_line(i_graphics_context const& aGc, buffer_line const& aLine) const
+    {
+        // Each column of the grid is one cell so most code points map to a glyph that is shaped once per font and
+        // then copied into place; only spans containing emoji or combining sequences are shaped as a whole (with
+        // the shaped text cache making repeated spans cheap) and are then snapped back onto the grid.
+        auto const rendering = std::make_pair(aGc.is_subpixel_rendering_on(), aGc.logical_coordinate_system());
+        if (iCellGlyphsRendering != rendering)
+        {
+            iCellGlyphs.clear();
+            iCellGlyphsRendering = rendering;
+        }
+
+        auto const& text = aLine.text;
+        auto const columns = text.size();
+        auto const cx = static_cast<float>(character_extents().cx);
+        auto const columnFont = [&](std::size_t aColumn) -> neogfx::font const&
+        {
+            return aColumn < aLine.attributes.size() ? font(aLine.attributes[aColumn].style) : normal_font();
+        };
+
+        thread_local std::vector<cell_glyph const*> tCells;
+        tCells.clear();
+        for (std::size_t column = 0; column < columns; ++column)
+            tCells.push_back(&shape_cell(aGc, columnFont(column), text[column]));
+        auto const simple = [&](std::size_t aColumn)
+        {
+            return tCells[aColumn]->glyph && (aColumn + 1u == columns || !tCells[aColumn + 1u]->extendsCluster);
+        };
+
+        glyph_text result{ normal_font() };
+        auto& content = result.content();
+        font_id cachedFont = {};
+        auto const add = [&](glyph_char const& aGlyph)
+        {
+            content.push_back(aGlyph);
+            if (aGlyph.font != cachedFont)
+            {
+                content.cache_glyph_font(aGlyph.font);
+                cachedFont = aGlyph.font;
+            }
+        };
+
+        for (std::size_t column = 0; column < columns;)
+        {
+            if (simple(column))
+            {
+                auto glyph = *tCells[column]->glyph;
+                glyph.clusters = { static_cast<glyph_char::cluster_index>(column), static_cast<glyph_char::cluster_index>(column + 1u) };
+                place_in_cell(glyph, column * cx, cx);
+                add(glyph);
+                ++column;
+                continue;
+            }
+            auto spanEnd = column + 1u;
+            while (spanEnd < columns && !simple(spanEnd))
+                ++spanEnd;
+            bool uniformStyle = true;
+            for (auto spanColumn = column + 1u; uniformStyle && spanColumn < spanEnd; ++spanColumn)
+                uniformStyle = (&columnFont(spanColumn) == &columnFont(column));
+            auto& factory = service<i_font_manager>().glyph_text_factory();
+            auto const shaped = uniformStyle ?
+                factory.to_glyph_text(aGc, text.data() + column, text.data() + spanEnd, columnFont(column), false) :
+                factory.to_glyph_text(aGc, text.data() + column, text.data() + spanEnd,
+                    [&, column](std::size_t n) -> neogfx::font { return columnFont(column + n); }, false);
+            // glyphs within a cluster keep their shaped offsets from the first glyph of the cluster
+            std::optional<std::pair<glyph_char::cluster_index, float>> clusterOrigin;
+            for (auto glyph : shaped)
+            {
+                if (!clusterOrigin || clusterOrigin->first != glyph.clusters.first)
+                    clusterOrigin.emplace(glyph.clusters.first, glyph.cell[0].x);
+                auto const cells = std::max<glyph_char::cluster_index>(1u, glyph.clusters.second - glyph.clusters.first);
+                place_in_cell(glyph, (column + glyph.clusters.first) * cx + (glyph.cell[0].x - clusterOrigin->second), cells * cx);
+                glyph.clusters.first += static_cast<glyph_char::cluster_index>(column);
+                glyph.clusters.second += static_cast<glyph_char::cluster_index>(column);
+                add(glyph);
+            }
+            column = spanEnd;
+        }
+        content.align_baselines();
+        return result;
+    }
+
     void terminal::erase_in_display(point_type const& aBufferPosStart, point_type const& aBufferPosEnd)
     {
         auto lineStart = std::min(aBufferPosStart.y, static_cast<coordinate_type>(active_buffer().lines.size()) - 1);
@@ -1257,9 +1584,8 @@ namespace neogfx
             line.text.erase(line.text.begin(), std::next(line.text.begin(), eol));
             line.attributes.erase(line.attributes.begin(), std::next(line.attributes.begin(), eol));
         }
-        auto eraseLineStart = std::next(active_buffer().lines.begin(), lineStart);
-        auto eraseLineEnd = std::next(active_buffer().lines.begin(), lineEnd);
-        active_buffer().lines.erase(eraseLineStart, eraseLineEnd);
+        if (lineStart < lineEnd)
+            active_buffer().lines.erase(lineStart, lineEnd);
     }
 
     char32_t terminal::to_unicode(char32_t aCharacter) const
@@ -1299,18 +1625,20 @@ namespace neogfx
     terminal::buffer_line& terminal::line(coordinate_type aLine)
     {
         auto oldBufferSize = active_buffer().lines.size();
-        auto const desiredBufferSize = aLine + 1;
+        auto const desiredBufferSize = static_cast<std::size_t>(std::max(aLine + 1, 1));
 
-        while (active_buffer().lines.size() < desiredBufferSize)
+        if (active_buffer().lines.size() < desiredBufferSize)
         {
-            active_buffer().lines.emplace_back();
-            active_buffer().lines.back().text.reserve(iBufferSize.cx);
-            active_buffer().lines.back().attributes.reserve(iBufferSize.cx);
+            // once the buffer is full each new line discards the oldest
+            auto const newLines = std::min(desiredBufferSize - active_buffer().lines.size(), active_buffer().lines.capacity());
+            for (std::size_t i = 0; i < newLines; ++i)
+            {
+                auto& newLine = active_buffer().lines.emplace_back();
+                newLine.text.reserve(iBufferSize.cx);
+                newLine.attributes.reserve(iBufferSize.cx);
+            }
         }
 
-        if (active_buffer().lines.size() > iBufferSize.cy)
-            active_buffer().lines.erase(active_buffer().lines.begin(), std::next(active_buffer().lines.begin(), active_buffer().lines.size() - iBufferSize.cy));
-
         if (active_buffer().lines.size() - buffer_origin().y > iTerminalSize.cy)
             set_buffer_origin( buffer_origin() + 
                 point_type{ 0, (static_cast<coordinate_type>(active_buffer().lines.size() - oldBufferSize)) });
@@ -1344,6 +1672,40 @@ namespace neogfx
         set_cursor_pos(cursor_pos().with_x(cursor_pos().x + 1));
     }
 
+    void terminal::output_run(std::u32string_view aRun)
+    {
+        auto const activeAttribute = active_attribute();
+        while (!aRun.empty())
+        {
+            if (cursor_pos().x == iTerminalSize.cx && active_buffer().autoWrap &&
+                (!active_buffer().scrollingRegion || cursor_pos().y + 1 < active_buffer().scrollingRegion->bottom))
+                set_cursor_pos({ 0, cursor_pos().y + 1 });
+            if (cursor_pos().x >= iTerminalSize.cx)
+            {
+                // without autowrap each character overwrites the last so only the final one survives
+                output_character(to_unicode(aRun.back()), activeAttribute);
+                return;
+            }
+            auto const pos = buffer_pos();
+            auto const count = std::min<std::size_t>(aRun.size(), iTerminalSize.cx - cursor_pos().x);
+            auto const end = static_cast<std::size_t>(pos.x) + count;
+            auto& line = terminal::line(pos.y);
+            if (line.text.size() < end)
+                line.text.resize(end, U' ');
+            if (line.attributes.size() < end)
+                line.attributes.resize(end, default_attribute());
+            if (active_buffer().characterSet == character_set::USASCII)
+                std::copy(aRun.begin(), std::next(aRun.begin(), count), std::next(line.text.begin(), pos.x));
+            else
+                std::transform(aRun.begin(), std::next(aRun.begin(), count), std::next(line.text.begin(), pos.x),
+                    [&](char32_t aCharacter) { return to_unicode(aCharacter); });
+            std::fill(std::next(line.attributes.begin(), pos.x), std::next(line.attributes.begin(), end), activeAttribute);
+            line.glyphs = std::nullopt;
+            set_cursor_pos(cursor_pos().with_x(cursor_pos().x + static_cast<coordinate_type>(count)));
+            aRun.remove_prefix(count);
+        }
+    }
+
     terminal::point_type terminal::buffer_origin() const
     {
         return active_buffer().bufferOrigin;
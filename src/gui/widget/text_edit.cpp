@@ -18,6 +18,7 @@
 */
 
 #include <neogfx/neogfx.hpp>
+#include <execution>
 #include <boost/algorithm/string/find.hpp>
 #include <neolib/core/scoped.hpp>
 #include <neolib/task/thread.hpp>
@@ -56,6 +57,19 @@ namespace neogfx
         parent.set_padding(previousPadding);
     }
 
+    struct text_edit::paragraph_line
+    {
+        // glyph positions are relative to the start of the paragraph and ypos to its top
+        document_glyphs::size_type paragraphLineStart;
+        document_glyphs::size_type paragraphLineEnd;
+        document_glyphs::size_type lineStart;
+        document_glyphs::size_type lineEnd;
+        coordinate ypos;
+        size extents;
+        font_id majorFont;
+        scalar baseline;
+    };
+
     class text_edit::glyph_paragraph_index
     {
     public:
@@ -90,6 +104,7 @@ namespace neogfx
     {
     public:
         typedef std::map<document_glyphs::size_type, dimension, std::less<document_glyphs::size_type>, boost::fast_pool_allocator<std::pair<const document_glyphs::size_type, dimension>>> height_list;
+        typedef std::vector<paragraph_line> line_list;
     public:
         glyph_paragraph(text_edit& aParent) :
             iParent{ &aParent }, iSelf{}
@@ -115,11 +130,43 @@ namespace neogfx
         {
             iLineBreaks = aLineBreaks;
         }
+        void reset_heights()
+        {
+            iHeights.clear();
+        }
+        bool has_lines(std::optional<dimension> const& aWrapWidth, bool aLastParagraph) const
+        {
+            return iLinesLaidOut && iLinesWrapWidth == aWrapWidth && iLinesLastParagraph == aLastParagraph;
+        }
+        line_list const& lines() const
+        {
+            return iLines;
+        }
+        line_list& lines()
+        {
+            return iLines;
+        }
+        coordinate lines_height() const
+        {
+            return iLinesHeight;
+        }
+        void set_lines(std::optional<dimension> const& aWrapWidth, bool aLastParagraph, coordinate aHeight)
+        {
+            iLinesLaidOut = true;
+            iLinesWrapWidth = aWrapWidth;
+            iLinesLastParagraph = aLastParagraph;
+            iLinesHeight = aHeight;
+        }
         glyph_paragraph& operator=(const glyph_paragraph& aOther)
         {
             iParent = aOther.iParent;
             iSelf = aOther.iSelf;
             iHeights = aOther.iHeights;
+            iLines = aOther.iLines;
+            iLinesLaidOut = aOther.iLinesLaidOut;
+            iLinesWrapWidth = aOther.iLinesWrapWidth;
+            iLinesLastParagraph = aOther.iLinesLastParagraph;
+            iLinesHeight = aOther.iLinesHeight;
             return *this;
         }
     public:
@@ -211,15 +258,35 @@ namespace neogfx
         glyph_paragraphs::const_iterator iSelf;
         mutable height_list iHeights;
         vector<glyph_text::size_type> iLineBreaks;
+        line_list iLines;
+        bool iLinesLaidOut = false;
+        std::optional<dimension> iLinesWrapWidth;
+        bool iLinesLastParagraph = false;
+        coordinate iLinesHeight = 0.0;
+    };
+
+    struct text_edit::paragraph_shaping
+    {
+        // below this many paragraphs the thread pool costs more than it saves
+        static constexpr std::size_t ConcurrencyThreshold = 64u;
+        // consecutive paragraphs shaped without touching the rasteriser before the rest are handed to the thread pool
+        static constexpr std::size_t WarmUpParagraphs = 8u;
+
+        document_text::size_type textStart;
+        document_text::size_type textEnd;
+        std::u32string text;
+        std::vector<std::pair<std::size_t, neogfx::font>> fonts;
+        optional_glyph_text glyphs;
     };
 
     struct text_edit::glyph_line
     {
-        std::pair<glyph_paragraphs::size_type, glyph_paragraphs::const_iterator> paragraph;
-        std::pair<document_glyphs::size_type, document_glyphs::const_iterator> paragraphStart;
-        std::pair<document_glyphs::size_type, document_glyphs::const_iterator> paragraphEnd;
-        std::pair<document_glyphs::size_type, document_glyphs::const_iterator> lineStart;
-        std::pair<document_glyphs::size_type, document_glyphs::const_iterator> lineEnd;
+        // glyph positions are indices rather than iterators so that the lines after an edit only need shifting
+        glyph_paragraphs::const_iterator paragraph;
+        document_glyphs::size_type paragraphStart;
+        document_glyphs::size_type paragraphEnd;
+        document_glyphs::size_type lineStart;
+        document_glyphs::size_type lineEnd;
         coordinate ypos;
         size extents;
         font_id majorFont;
@@ -669,7 +736,8 @@ namespace neogfx
         }, std::chrono::milliseconds{ 16 } },
         iSuppressTextChangedNotification{ 0u },
         iWantedToNotfiyTextChanged{ 0u },
-        iOutOfMemory{ false }
+        iOutOfMemory{ false },
+        iLinesVisited{ 0u }
     {
         init();
     }
@@ -690,7 +758,8 @@ namespace neogfx
         }, std::chrono::milliseconds{ 16 } },
         iSuppressTextChangedNotification{ 0u },
         iWantedToNotfiyTextChanged{ 0u },
-        iOutOfMemory{ false }
+        iOutOfMemory{ false },
+        iLinesVisited{ 0u }
     {
         init();
     }
@@ -711,7 +780,8 @@ namespace neogfx
         }, std::chrono::milliseconds{ 16 } },
         iSuppressTextChangedNotification{ 0u },
         iWantedToNotfiyTextChanged{ 0u },
-        iOutOfMemory{ false }
+        iOutOfMemory{ false },
+        iLinesVisited{ 0u }
     {
         init();
     }
@@ -789,6 +859,7 @@ namespace neogfx
     void text_edit::paint(i_graphics_context& aGc) const
     {
         framed_scrollable_widget::paint(aGc);
+        iLinesVisited = 0u;
         rect clipRect = default_clip_rect().intersection(client_rect(false));
         clipRect.inflate(size{ padding_adjust() });
         if (iOutOfMemory)
@@ -808,26 +879,28 @@ namespace neogfx
             scoped_scissor scissor2{ aGc, columnClipRect };
             auto const& columnRectSansPadding = column_rect(columnIndex);
             auto const& lines = column.lines();
-            auto line = std::lower_bound(lines.begin(), lines.end(), glyph_line{ {}, {}, {}, {}, {}, vertical_scrollbar().position(), {} },
-                [](const glyph_line& left, const glyph_line& right) { return left.ypos < right.ypos; });
-            if (line != lines.begin() && (line == lines.end() || line->ypos > vertical_scrollbar().position()))
-                --line;
+            // lines are in ypos order so start at the first line reaching the top of the area being painted
+            auto const visibleTop = vertical_scrollbar().position() + std::max(columnRectSansPadding.top(), update_rect().top()) - columnRectSansPadding.top();
+            auto line = std::partition_point(lines.begin(), lines.end(), 
+                [visibleTop](const glyph_line& aLine) { return aLine.ypos + aLine.extents.cy < visibleTop; });
             if (line == lines.end())
                 continue;
+            rect const visibleRect = columnClipRect.intersection(update_rect());
             for (auto paintLine = line; paintLine != lines.end(); paintLine++)
             {
+                ++iLinesVisited;
                 point linePos = columnRectSansPadding.top_left() + point{ -horizontal_scrollbar().position(), paintLine->ypos - vertical_scrollbar().position() };
                 if (linePos.y + paintLine->extents.cy < columnRectSansPadding.top() || linePos.y + paintLine->extents.cy < update_rect().top())
                     continue;
                 if (linePos.y > columnRectSansPadding.bottom() || linePos.y > update_rect().bottom())
                     break;
-                auto textDirection = glyph_text_direction(paintLine->lineStart.second, paintLine->lineEnd.second);
+                auto textDirection = glyph_text_direction(glyphs().begin() + paintLine->lineStart, glyphs().begin() + paintLine->lineEnd);
                 if (((Alignment & alignment::Horizontal) == alignment::Left && textDirection == text_direction::RTL) ||
                     ((Alignment & alignment::Horizontal) == alignment::Right && textDirection == text_direction::LTR))
                     linePos.x += aGc.from_device_units(size{ columnRectSansPadding.width() - paintLine->extents.cx, 0.0 }).cx;
                 else if ((Alignment & alignment::Horizontal) == alignment::Center)
                     linePos.x += std::ceil((aGc.from_device_units(size{ columnRectSansPadding.width() - paintLine->extents.cx, 0.0 }).cx) / 2.0);
-                draw_glyphs(aGc, linePos, column, paintLine);
+                draw_glyphs(aGc, linePos, visibleRect, column, paintLine);
             }
             x += column.width();
         }
@@ -1794,17 +1867,17 @@ namespace neogfx
         std::pair<glyph_lines::const_iterator, glyph_lines::const_iterator> lines;
         for (; column != iGlyphColumns.end(); ++column)
         {
-            auto line = std::lower_bound(column->lines().begin(), column->lines().end(), glyph_line{ {}, {}, { aGlyphPosition, {} }, {}, {}, 0.0, {} },
+            auto line = std::lower_bound(column->lines().begin(), column->lines().end(), glyph_line{ {}, {}, aGlyphPosition, {}, {}, 0.0, {} },
                 [](const glyph_line& left, const glyph_line& right) 
                 { 
-                    return left.paragraphEnd.first < right.paragraphEnd.first; 
+                    return left.paragraphEnd < right.paragraphEnd; 
                 });
             if (line != column->lines().end())
             {
-                lines = std::equal_range(column->lines().begin(), column->lines().end(), glyph_line{ {}, { line->paragraphStart.first, {} }, {}, {}, {}, 0.0, {} },
+                lines = std::equal_range(column->lines().begin(), column->lines().end(), glyph_line{ {}, line->paragraphStart, {}, {}, {}, 0.0, {} },
                     [](const glyph_line& left, const glyph_line& right)
                     {
-                        return left.paragraphStart.first < right.paragraphStart.first;
+                        return left.paragraphStart < right.paragraphStart;
                     });
                 break;
             }
@@ -1817,12 +1890,12 @@ namespace neogfx
         if (lines.first == lines.second)
             return std::make_pair(column, lines.first);
         glyph_lines::const_iterator line = column->lines().end();
-        if (lines.first->lineStart.first <= std::prev(lines.second)->lineStart.first)
-            line = std::lower_bound(lines.first, lines.second, glyph_line{ {}, {}, {}, { aGlyphPosition, glyphs().begin() + aGlyphPosition }, {}, 0.0, {} },
-                [](const glyph_line& left, const glyph_line& right) { return left.lineStart.first < right.lineStart.first; });
+        if (lines.first->lineStart <= std::prev(lines.second)->lineStart)
+            line = std::lower_bound(lines.first, lines.second, glyph_line{ {}, {}, {}, aGlyphPosition, {}, 0.0, {} },
+                [](const glyph_line& left, const glyph_line& right) { return left.lineStart < right.lineStart; });
         else
-            line = std::lower_bound(lines.first, lines.second, glyph_line{ {}, {}, {}, { aGlyphPosition, glyphs().begin() + aGlyphPosition }, {}, 0.0, {} },
-                [](const glyph_line& left, const glyph_line& right) { return left.lineStart.first > right.lineStart.first; });
+            line = std::lower_bound(lines.first, lines.second, glyph_line{ {}, {}, {}, aGlyphPosition, {}, 0.0, {} },
+                [](const glyph_line& left, const glyph_line& right) { return left.lineStart > right.lineStart; });
         return std::make_pair(column, line);
     }
 
@@ -1838,16 +1911,16 @@ namespace neogfx
             if (line == lines.end())
             {
                 auto const& lastLine = lines.back();
-                if (aGlyphPosition <= lastLine.lineEnd.first)
+                if (aGlyphPosition <= lastLine.lineEnd)
                     --line;
             }
-            else if (aGlyphPosition < line->lineStart.first)
+            else if (aGlyphPosition < line->lineStart)
                 --line;
         }
         if (line != lines.end())
         {
-            position_type lineStart = line->lineStart.first;
-            position_type lineEnd = line->lineEnd.first;
+            position_type lineStart = line->lineStart;
+            position_type lineEnd = line->lineEnd;
             bool placeCursorToRight = (aGlyphPosition == lineEnd);
             if (aForCursor)
             {
@@ -1872,7 +1945,7 @@ namespace neogfx
             if (aGlyphPosition >= lineStart && aGlyphPosition <= lineEnd)
             {
                 delta alignmentAdjust;
-                auto textDirection = glyph_text_direction(line->lineStart.second, line->lineEnd.second);
+                auto textDirection = glyph_text_direction(glyphs().begin() + lineStart, glyphs().begin() + lineEnd);
                 if (((Alignment & alignment::Horizontal) == alignment::Left && textDirection == text_direction::RTL) ||
                     ((Alignment & alignment::Horizontal) == alignment::Right && textDirection == text_direction::LTR))
                     alignmentAdjust.dx = columnRectSansPadding.cx - line->extents.cx;
@@ -1882,20 +1955,20 @@ namespace neogfx
                 {
                     auto iterGlyph = glyphs().begin() + aGlyphPosition;
                     auto const& glyph = aGlyphPosition < lineEnd ? *iterGlyph : *(iterGlyph - 1);
-                    point linePos{ glyph.cell[0].x - line->lineStart.second->cell[0].x, line->ypos };
+                    point linePos{ glyph.cell[0].x - glyphs()[lineStart].cell[0].x, line->ypos };
                     if (placeCursorToRight)
                         linePos.x += quad_extents(glyph.cell).x;
                     return position_info{ iterGlyph, column, line, glyphs().begin() + lineStart, glyphs().begin() + lineEnd, linePos + alignmentAdjust };
                 }
                 else
-                    return position_info{ line->lineStart.second, column, line, glyphs().begin() + lineStart, glyphs().begin() + lineEnd, point{ 0.0, line->ypos } + alignmentAdjust };
+                    return position_info{ glyphs().begin() + lineStart, column, line, glyphs().begin() + lineStart, glyphs().begin() + lineEnd, point{ 0.0, line->ypos } + alignmentAdjust };
             }
         }
         point pos;
         if (!lines.empty())
         {
             pos.x = 0.0;
-            auto textDirection = glyph_text_direction(lines.back().lineStart.second, lines.back().lineEnd.second);
+            auto textDirection = glyph_text_direction(glyphs().begin() + lines.back().lineStart, glyphs().begin() + lines.back().lineEnd);
             if (((Alignment & alignment::Horizontal) == alignment::Left && textDirection == text_direction::RTL) ||
                 ((Alignment & alignment::Horizontal) == alignment::Right && textDirection == text_direction::LTR))
                 pos.x = columnRectSansPadding.cx;
@@ -1938,7 +2011,7 @@ namespace neogfx
             if (line != lines.begin() && adjustedPosition.y < line->ypos)
                 --line;
             delta alignmentAdjust;
-            auto const textDirection = glyph_text_direction(lines.back().lineStart.second, lines.back().lineEnd.second);
+            auto const textDirection = glyph_text_direction(glyphs().begin() + lines.back().lineStart, glyphs().begin() + lines.back().lineEnd);
             if (((Alignment & alignment::Horizontal) == alignment::Left && textDirection == text_direction::RTL) ||
                 ((Alignment & alignment::Horizontal) == alignment::Right && textDirection == text_direction::LTR))
                 alignmentAdjust.dx = columnRectSansPadding.cx - line->extents.cx;
@@ -1946,17 +2019,17 @@ namespace neogfx
                 alignmentAdjust.dx = (columnRectSansPadding.cx - line->extents.cx) / 2.0;
             adjustedPosition.x -= alignmentAdjust.dx;
             adjustedPosition = adjustedPosition.max(point{});
-            auto const lineStart = (line != lines.end() ? line->lineStart.first : glyphs().size());
-            auto const lineEnd = (line != lines.end() ? line->lineEnd.first : glyphs().size());
-            auto const lineStartX = line->lineStart.second->cell[0].x;
-            auto const lineEndX = std::prev(line->lineEnd.second)->cell[1].x;
+            auto const lineStart = (line != lines.end() ? line->lineStart : glyphs().size());
+            auto const lineEnd = (line != lines.end() ? line->lineEnd : glyphs().size());
+            auto const lineStartX = glyphs()[lineStart].cell[0].x;
+            auto const lineEndX = glyphs()[lineEnd - 1].cell[1].x;
             if (adjustedPosition.x >= lineEndX - lineStartX)
             {
                 if (lineEnd > lineStart && is_line_breaking_whitespace(glyphs()[lineEnd - 1]))
                     return lineEnd - 1;
                 return lineEnd;
             }
-            for (auto gi = line->lineStart.first; gi != lineEnd; ++gi)
+            for (auto gi = line->lineStart; gi != lineEnd; ++gi)
             {
                 auto const& glyph = glyphs()[gi];
                 auto const glyphAdvance = quad_extents(glyph.cell).x;
@@ -2163,6 +2236,11 @@ namespace neogfx
         return gp;
     }
 
+    uint32_t text_edit::lines_visited_by_last_paint() const
+    {
+        return iLinesVisited;
+    }
+
     std::size_t text_edit::columns() const
     {
         return iGlyphColumns.size();
@@ -2467,34 +2545,102 @@ namespace neogfx
         if (iUpdatingDocument)
             return;
 
-        /* simple (naive) implementation just to get things moving (so just refresh everything) ... */
-        (void)aWhere;
         graphics_context gc{ *this, graphics_context::type::Unattached };
         if (password() && (!iPasswordBits || !iPasswordBits.value().showPassword.is_pressed()))
             gc.set_password(true, PasswordMask.value().empty() ? "\xE2\x97\x8F"_s : PasswordMask);
-        glyphs().clear();
-        iGlyphParagraphs.clear();
+        scoped_tab_stops sts{ gc, tab_stops() };
+
+        if (aDelta == 0 || !refresh_edited_paragraphs(gc, aWhere, aDelta))
+        {
+            glyphs().clear();
+            iGlyphParagraphs.clear();
+            iCharacterToParagraphCache.clear();
+            iCharacterToParagraphCacheLastAccess.reset();
+            iGlyphToParagraphCache.clear();
+            iGlyphToParagraphCacheLastAccess.reset();
+            iLinesLayout = std::nullopt;
+            iLinesEdit = std::nullopt;
+            std::vector<paragraph_shaping> paragraphs;
+            shape_paragraphs(gc, 0u, iText.size(), paragraphs);
+            for (auto const& paragraph : paragraphs)
+                insert_paragraph(iGlyphParagraphs.end(), glyphs().size(), paragraph);
+        }
+
+        if (iPasswordBits)
+            iPasswordBits.value().showPassword.show(!iText.empty());
+
+        refresh_columns();
+    }
+
+    bool text_edit::refresh_edited_paragraphs(i_graphics_context const& aGc, document_text::const_iterator aWhere, ptrdiff_t aDelta)
+    {
+        // only the paragraphs spanned by the edit are reshaped; this relies on the existing paragraphs still describing
+        // the text as it was before the edit so anything else gets a full refresh
+        if (columns() != 1 || iGlyphParagraphs.empty())
+            return false;
+        auto const oldTextSize = static_cast<document_text::size_type>(static_cast<ptrdiff_t>(iText.size()) - aDelta);
+        if (std::prev(iGlyphParagraphs.end())->first.text_end_index() != oldTextSize)
+            return false;
+        auto const paragraph_at = [&](document_text::size_type aCharacterPos)
+        {
+            if (aCharacterPos >= oldTextSize)
+                return std::prev(iGlyphParagraphs.end());
+            return iGlyphParagraphs.find_by_foreign_index(glyph_paragraph_index{ aCharacterPos, 0 }, 
+                [](const glyph_paragraph_index& aLhs, const glyph_paragraph_index& aRhs) { return aLhs.characters() < aRhs.characters(); }).first;
+        };
+        auto const editStart = static_cast<document_text::size_type>(aWhere - iText.begin());
+        auto const oldEditEnd = editStart + static_cast<document_text::size_type>(std::max<ptrdiff_t>(-aDelta, 0));
+        auto first = paragraph_at(editStart);
+        auto last = paragraph_at(oldEditEnd);
+        if (first == iGlyphParagraphs.end() || last == iGlyphParagraphs.end())
+            return false;
+        ++last;
+        auto const textStart = first->first.text_start_index();
+        auto const textEnd = static_cast<document_text::size_type>(static_cast<ptrdiff_t>(std::prev(last)->first.text_end_index()) + aDelta);
+        auto const glyphStart = first->first.start_index();
+        auto const glyphEnd = std::prev(last)->first.end_index();
+
+        std::vector<paragraph_shaping> paragraphs;
+        shape_paragraphs(aGc, textStart, textEnd, paragraphs);
+
+        glyphs().container().erase(glyphs().container().begin() + glyphStart, glyphs().container().begin() + glyphEnd);
+        auto next = iGlyphParagraphs.erase(first, last);
+        auto glyphPos = glyphStart;
+        glyph_paragraphs::size_type inserted = 0u;
+        for (auto const& paragraph : paragraphs)
+        {
+            auto const glyphCount = insert_paragraph(next, glyphPos, paragraph);
+            if (glyphCount != 0u)
+                ++inserted;
+            glyphPos += glyphCount;
+        }
+        // refresh_lines can only patch the lines for one edit; a second before it runs needs them all laid out again
+        if (iLinesLayout != std::nullopt && iLinesEdit == std::nullopt)
+            iLinesEdit = lines_edit{ next, inserted, glyphStart, glyphEnd, glyphPos };
+        else
+            iLinesLayout = std::nullopt;
+        // the glyphs of the paragraphs that follow have moved
+        for (; next != iGlyphParagraphs.end(); ++next)
+            next->first.reset_heights();
         iCharacterToParagraphCache.clear();
         iCharacterToParagraphCacheLastAccess.reset();
         iGlyphToParagraphCache.clear();
         iGlyphToParagraphCacheLastAccess.reset();
-        std::u32string paragraphBuffer;
-        auto nextParagraph = iText.begin();
+        return true;
+    }
+
+    void text_edit::shape_paragraphs(i_graphics_context const& aGc, document_text::size_type aTextBegin, document_text::size_type aTextEnd, std::vector<paragraph_shaping>& aParagraphs) const
+    {
+        aParagraphs.clear();
+        if (aTextBegin == aTextEnd)
+            return;
+
+        // paragraph text and fonts are gathered here as the document and its styles can only be read by this thread
+        auto const textBegin = iText.begin() + aTextBegin;
+        auto const textEnd = iText.begin() + aTextEnd;
+        auto nextParagraph = textBegin;
         auto iterColumn = iGlyphColumns.begin();
-        neolib::vecarray<std::u32string::size_type, 16, -1> columnDelimiters;
-        auto fs = [this, &nextParagraph, &columnDelimiters](std::u32string::size_type aSourceIndex)
-        {
-            auto const& tagStyle = iText.tag(nextParagraph + aSourceIndex).style();
-            std::size_t indexColumn = std::lower_bound(columnDelimiters.begin(), columnDelimiters.end(), aSourceIndex) - columnDelimiters.begin();
-            if (indexColumn > columns() - 1)
-                indexColumn = columns() - 1;
-            auto const& columnStyle = column_style(indexColumn);
-            auto const& style =
-                std::holds_alternative<style_list::const_iterator>(tagStyle) ? *static_variant_cast<style_list::const_iterator>(tagStyle) :
-                columnStyle.character().font() != std::nullopt ? columnStyle : iDefaultStyle;
-            return style.character().font() != std::nullopt ? *style.character().font() : font();
-        };
-        for (auto iterChar = iText.begin(); iterChar != iText.end(); ++iterChar)
+        for (auto iterChar = textBegin; iterChar != textEnd; ++iterChar)
         {
             auto& column = *(iterColumn);
             auto ch = *iterChar;
@@ -2504,34 +2650,88 @@ namespace neogfx
                 continue;
             }
             bool newParagraph = (ch == U'\n');
-            if (newParagraph || iterChar == iText.end() - 1)
+            if (newParagraph || iterChar == textEnd - 1)
             {
-                paragraphBuffer.assign(nextParagraph, iterChar + 1);
-                scoped_tab_stops sts{ gc, tab_stops() };
-                auto gt = service<i_font_manager>().glyph_text_factory().to_glyph_text(gc, std::u32string_view{ paragraphBuffer.begin(), paragraphBuffer.end() }, fs, false);
-                if (gt.cbegin() != gt.cend())
+                auto& paragraph = aParagraphs.emplace_back();
+                paragraph.textStart = static_cast<document_text::size_type>(nextParagraph - iText.begin());
+                paragraph.textEnd = static_cast<document_text::size_type>((iterChar + 1) - iText.begin());
+                paragraph.text.assign(nextParagraph, iterChar + 1);
+                for (auto iterParagraphChar = nextParagraph; iterParagraphChar != iterChar + 1; ++iterParagraphChar)
                 {
-                    auto paragraphGlyphs = glyphs().container().insert(glyphs().container().end(), gt.cbegin(), gt.cend());
-                    for (auto& newGlyph : gt)
-                        glyphs().cache_glyph_font(newGlyph.font);
-                    auto paragraph = iGlyphParagraphs.insert(iGlyphParagraphs.end(),
-                        std::make_pair(
-                            glyph_paragraph{ *this },
-                            glyph_paragraph_index{
-                                static_cast<std::size_t>((iterChar + 1) - iText.begin()) - static_cast<std::size_t>(nextParagraph - iText.begin()),
-                                glyphs().size() - static_cast<std::size_t>(paragraphGlyphs - glyphs().container().begin()) }),
-                                glyph_paragraphs::skip_type{ glyph_paragraph_index{}, glyph_paragraph_index{} });
-                    paragraph->first.set_self(paragraph);
-                    paragraph->first.set_line_breaks(gt.content().line_breaks());
+                    auto const& tagStyle = iText.tag(iterParagraphChar).style();
+                    auto const& columnStyle = column_style(0);
+                    auto const& style =
+                        std::holds_alternative<style_list::const_iterator>(tagStyle) ? *static_variant_cast<style_list::const_iterator>(tagStyle) :
+                        columnStyle.character().font() != std::nullopt ? columnStyle : iDefaultStyle;
+                    auto const& characterFont = style.character().font() != std::nullopt ? *style.character().font() : font();
+                    if (paragraph.fonts.empty() || paragraph.fonts.back().second != characterFont)
+                        paragraph.fonts.emplace_back(static_cast<std::size_t>(iterParagraphChar - nextParagraph), characterFont);
                 }
                 nextParagraph = iterChar + 1;
             }
         }
 
-        if (iPasswordBits)
-            iPasswordBits.value().showPassword.show(!iText.empty());
+        auto& factory = service<i_font_manager>().glyph_text_factory();
+        auto const shape = [&](paragraph_shaping& aParagraph, bool aConcurrent)
+        {
+            font_selector const fs{ [&aParagraph](std::size_t aSourceIndex)
+            {
+                return std::prev(std::upper_bound(aParagraph.fonts.begin(), aParagraph.fonts.end(), aSourceIndex,
+                    [](std::size_t aLhs, std::pair<std::size_t, neogfx::font> const& aRhs) { return aLhs < aRhs.first; }))->second;
+            } };
+            auto const text = aParagraph.text.data();
+            if (aConcurrent)
+                aParagraph.glyphs = factory.to_glyph_text_concurrent(aGc, text, text + aParagraph.text.size(), fs, false);
+            else
+                aParagraph.glyphs = factory.to_glyph_text(aGc, text, text + aParagraph.text.size(), fs, false);
+        };
 
-        refresh_columns();
+        auto next = aParagraphs.begin();
+        if (aParagraphs.size() >= paragraph_shaping::ConcurrencyThreshold)
+        {
+            // workers give up on paragraphs needing fallback fonts, emoji or glyphs not yet rasterised so warm the glyph
+            // cache on this thread first; if it never warms up (e.g. asynchronous rasterisation) stay on this thread
+            std::size_t consecutive = 0u;
+            for (; next != aParagraphs.end() && consecutive < paragraph_shaping::WarmUpParagraphs &&
+                static_cast<std::size_t>(next - aParagraphs.begin()) < paragraph_shaping::ConcurrencyThreshold; ++next)
+            {
+                shape(*next, true);
+                if (next->glyphs != std::nullopt)
+                    ++consecutive;
+                else
+                {
+                    shape(*next, false);
+                    consecutive = 0u;
+                }
+            }
+            if (consecutive == paragraph_shaping::WarmUpParagraphs)
+                std::for_each(std::execution::par, next, aParagraphs.end(), [&](paragraph_shaping& aParagraph)
+                {
+                    shape(aParagraph, true);
+                });
+        }
+        for (auto& paragraph : aParagraphs)
+            if (paragraph.glyphs == std::nullopt)
+                shape(paragraph, false);
+    }
+
+    text_edit::document_glyphs::size_type text_edit::insert_paragraph(glyph_paragraphs::const_iterator aBefore, document_glyphs::size_type aGlyphPos, paragraph_shaping const& aParagraph)
+    {
+        auto const& gt = *aParagraph.glyphs;
+        if (gt.cbegin() == gt.cend())
+            return 0u;
+        glyphs().container().insert(glyphs().container().begin() + aGlyphPos, gt.cbegin(), gt.cend());
+        for (auto& newGlyph : gt)
+            glyphs().cache_glyph_font(newGlyph.font);
+        auto const glyphCount = static_cast<document_glyphs::size_type>(gt.cend() - gt.cbegin());
+        auto paragraph = iGlyphParagraphs.insert(aBefore,
+            std::make_pair(
+                glyph_paragraph{ *this },
+                glyph_paragraph_index{ aParagraph.textEnd - aParagraph.textStart, glyphCount }),
+                glyph_paragraphs::skip_type{ glyph_paragraph_index{}, glyph_paragraph_index{} });
+        paragraph->first.set_self(paragraph);
+        paragraph->first.set_line_breaks(gt.content().line_breaks());
+        return glyphCount;
     }
 
     void text_edit::refresh_columns()
@@ -2545,11 +2745,16 @@ namespace neogfx
 
     void text_edit::refresh_lines()
     {
+        auto const edit = iLinesEdit;
+        iLinesEdit = std::nullopt;
         try
         {
-            /* simple (naive) implementation just to get things moving... */
             iOutOfMemory = false;
 
+            if (edit != std::nullopt && refresh_edited_lines(*edit))
+                return;
+            iLinesLayout = std::nullopt;
+
             for (auto& column : iGlyphColumns)
                 column.lines().clear();
             
@@ -2569,213 +2774,8 @@ namespace neogfx
             {
                 auto& column = *iterColumn;
                 auto& lines = column.lines();
-                auto& paragraph = *p;
-
-                thread_local std::vector<std::pair<document_glyphs::iterator, document_glyphs::iterator>> paragraphLines;
-                paragraphLines.clear();
-                glyph_text::size_type lastBreak = 0;
-                for (auto lineBreak : paragraph.first.line_breaks())
-                {
-                    paragraphLines.emplace_back(paragraph.first.start() + lastBreak, paragraph.first.start() + lineBreak);
-                    lastBreak = lineBreak + 1;
-                }
-                paragraphLines.emplace_back(paragraph.first.start() + lastBreak, paragraph.first.end());
-                if (paragraphLines.back().first != paragraphLines.back().second && 
-                    is_line_breaking_whitespace(glyphs().back()) && std::next(p) == iGlyphParagraphs.end())
-                    paragraphLines.emplace_back(paragraph.first.end(), paragraph.first.end());
 
-                auto const& paragraphStyle = glyph_style(paragraph.first.start(), column);
-
-                if (paragraphStyle.paragraph().padding())
-                    pos.y += paragraphStyle.paragraph().padding().value().top;
-
-                bool again = false;
-
-                for (auto const& paragraphLine : paragraphLines)
-                {
-                    auto const paragraphLineStart = paragraphLine.first;
-                    auto const paragraphLineEnd = paragraphLine.second;
-
-                    if (again)
-                    {
-                        if (paragraphStyle.paragraph().line_spacing())
-                            pos.y += paragraphStyle.paragraph().line_spacing().value();
-                    }
-                    else
-                        again = true;
-
-                    if (paragraphLineStart == paragraphLineEnd || is_line_breaking_whitespace(*paragraphLineStart))
-                    {
-                        auto lineStart = paragraphLineStart;
-                        auto lineEnd = !is_line_breaking_whitespace(*paragraphLineStart) ? paragraphLineEnd : paragraphLineStart;
-
-                        auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
-
-                        lines.push_back(
-                            glyph_line{
-                                { p - iGlyphParagraphs.begin(), p },
-                                { paragraphLineStart - glyphs().begin(), paragraphLineStart },
-                                { paragraphLineEnd - glyphs().begin(), paragraphLineEnd },
-                                { lineStart - glyphs().begin(), lineStart },
-                                { lineEnd - glyphs().begin(), lineEnd },
-                                pos.y,
-                                { lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f, alignBaselinesResult.yExtent },
-                                alignBaselinesResult.majorFont, 
-                                alignBaselinesResult.baseline });
-                        pos.y += lines.back().extents.cy;
-                        iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
-                    }
-                    else if (WordWrap && static_cast<coordinate>((paragraphLineEnd - 1)->cell[0].x) + static_cast<coordinate>(quad_extents((paragraphLineEnd - 1)->cell).x) > availableWidth)
-                    {
-                        if (glyph_text_direction(paragraphLineStart, paragraphLineEnd) == text_direction::LTR)
-                        {
-                            auto insertionPoint = lines.end();
-                            auto next = paragraphLineStart;
-                            auto lineStart = next;
-                            auto lineEnd = paragraphLineEnd;
-                            coordinate offset = (lineEnd != lineStart ? lineStart->cell[0].x : 0.0);
-                            while (next != paragraphLineEnd)
-                            {
-                                glyph_char const key{ {}, {}, {}, {}, {}, quadf_2d{ vec2{ offset + availableWidth, 0.0f } }, {} };
-                                auto split = std::lower_bound(next, paragraphLineEnd, key, [](auto const& lhs, auto const& rhs) { return lhs.cell[0].x < rhs.cell[0].x; });
-                                if (split != next && (split != paragraphLineEnd || static_cast<coordinate>((split - 1)->cell[0].x) + static_cast<coordinate>(quad_extents((split - 1)->cell).x) >= offset + availableWidth))
-                                    --split;
-                                if (split == next)
-                                    ++split;
-                                if (split != paragraphLineEnd)
-                                {
-                                    auto wordBreak = word_break(lineStart, split, paragraphLineEnd);
-                                    if (wordBreak.first == wordBreak.second)
-                                    {
-                                        auto previousLineEnd = wordBreak.first;
-                                        while (previousLineEnd != lineStart && (previousLineEnd - 1)->clusters == wordBreak.first->clusters)
-                                            --previousLineEnd;
-                                        if (previousLineEnd != lineStart)
-                                        {
-                                            lineEnd = wordBreak.first;
-                                            next = previousLineEnd;
-                                        }
-                                        else
-                                            next = lineEnd = split;
-                                    }
-                                    else
-                                    {
-                                        lineEnd = wordBreak.first;
-                                        next = wordBreak.second;
-                                    }
-                                }
-                                else
-                                    next = paragraphLineEnd;
-                                if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
-                                    --lineEnd;
-                                auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
-                                insertionPoint = lines.insert(lines.end(),
-                                    glyph_line{
-                                        { p - iGlyphParagraphs.begin(), p },
-                                        { paragraphLineStart - glyphs().begin(), paragraphLineStart },
-                                        { paragraphLineEnd - glyphs().begin(), paragraphLineEnd },
-                                        { lineStart - glyphs().begin(), lineStart },
-                                        { lineEnd - glyphs().begin(), lineEnd },
-                                        pos.y,
-                                        { lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f, alignBaselinesResult.yExtent },
-                                        alignBaselinesResult.majorFont,
-                                        alignBaselinesResult.baseline });
-                                pos.y += insertionPoint->extents.cy;
-                                iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
-                                lineStart = next;
-                                if (lineStart != paragraphLineEnd)
-                                    offset = lineStart->cell[0].x;
-                                lineEnd = paragraphLineEnd;
-                            }
-                        }
-                        else // RTL
-                        {
-                            auto insertionPoint = lines.end();
-                            auto next = std::reverse_iterator{ paragraphLineEnd };
-                            auto lineStart = next;
-                            auto lineEnd = std::reverse_iterator{ paragraphLineStart };
-                            coordinate const rightmost = (lineEnd != lineStart ? lineStart->cell[1].x : 0.0);
-                            coordinate offset = rightmost;
-                            while (next != std::reverse_iterator{ paragraphLineStart })
-                            {
-                                glyph_char const key{ {}, {}, {}, {}, {}, quadf_2d{ vec2{ offset - availableWidth, 0.0f } }, {} };
-                                auto split = std::lower_bound(next, std::reverse_iterator{ paragraphLineStart }, key, [=](auto const& lhs, auto const& rhs) { return offset - lhs.cell[0].x < offset - rhs.cell[0].x; });
-                                if (split != next && (split != std::reverse_iterator{ paragraphLineStart } || static_cast<coordinate>((split - 1)->cell[0].x) + static_cast<coordinate>(quad_extents((split - 1)->cell).x) >= rightmost - offset + availableWidth))
-                                    --split;
-                                if (split == next)
-                                    ++split;
-                                if (split != std::reverse_iterator{ paragraphLineStart })
-                                {
-                                    auto wordBreak = word_break(lineStart, split, std::reverse_iterator{ paragraphLineStart });
-                                    if (wordBreak.first == wordBreak.second)
-                                    {
-                                        auto previousLineEnd = wordBreak.first;
-                                        while (previousLineEnd != lineStart && (previousLineEnd - 1)->clusters == wordBreak.first->clusters)
-                                            --previousLineEnd;
-                                        if (previousLineEnd != lineStart)
-                                        {
-                                            lineEnd = wordBreak.first;
-                                            next = previousLineEnd;
-                                        }
-                                        else
-                                            next = lineEnd = split;
-                                    }
-                                    else
-                                    {
-                                        lineEnd = wordBreak.first;
-                                        next = wordBreak.second;
-                                    }
-                                }
-                                else
-                                    next = std::reverse_iterator{ paragraphLineStart };
-                                if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
-                                    --lineEnd;
-                                auto const alignBaselinesResult = glyphs().align_baselines(lineEnd.base(), lineStart.base(), true);
-                                insertionPoint = lines.insert(lines.end(),
-                                    glyph_line{
-                                        { p - iGlyphParagraphs.begin(), p },
-                                        { paragraphLineStart - glyphs().begin(), paragraphLineStart },
-                                        { paragraphLineEnd - glyphs().begin(), paragraphLineEnd },
-                                        { lineEnd.base() - glyphs().begin(), lineEnd.base() },
-                                        { lineStart.base() - glyphs().begin(), lineStart.base() },
-                                        pos.y,
-                                        { lineEnd != lineStart ? (lineStart)->cell[1].x - (lineEnd - 1)->cell[0].x : 0.0f, alignBaselinesResult.yExtent },
-                                        alignBaselinesResult.majorFont,
-                                        alignBaselinesResult.baseline });
-                                pos.y += insertionPoint->extents.cy;
-                                iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
-                                lineStart = next;
-                                if (lineStart != std::reverse_iterator{ paragraphLineStart })
-                                    offset = lineStart->cell[1].x;
-                                lineEnd = std::reverse_iterator{ paragraphLineStart };  
-                            }
-                        }
-                    }
-                    else
-                    {
-                        auto lineStart = paragraphLineStart;
-                        auto lineEnd = paragraphLineEnd;
-                        if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
-                            --lineEnd;
-                        auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
-                        lines.push_back(
-                            glyph_line{
-                                { p - iGlyphParagraphs.begin(), p },
-                                { paragraphLineStart - glyphs().begin(), paragraphLineStart },
-                                { paragraphLineEnd - glyphs().begin(), paragraphLineEnd },
-                                { lineStart - glyphs().begin(), lineStart },
-                                { lineEnd - glyphs().begin(), lineEnd },
-                                pos.y,
-                                { lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f, alignBaselinesResult.yExtent},
-                                alignBaselinesResult.majorFont,
-                                alignBaselinesResult.baseline });
-                        pos.y += lines.back().extents.cy;
-                        iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
-                    }
-                }
-
-                if (paragraphStyle.paragraph().padding())
-                    pos.y += paragraphStyle.paragraph().padding().value().bottom;
+                pos.y = layout_paragraph_lines(p, column, availableWidth, pos.y, lines, iTextExtents->cx);
 
                 auto next_pass = [&]()
                 {
@@ -2819,10 +2819,11 @@ namespace neogfx
 
             iTextExtents->cy = pos.y;
 
+            coordinate adjust = 0.0;
             if (iTextExtents->cy < client_rect(false).cy)
             {
                 auto const space = client_rect(false).cy - iTextExtents->cy;
-                auto const adjust =
+                adjust =
                     ((Alignment & alignment::Vertical) == alignment::Bottom) ? space :
                     ((Alignment & alignment::Vertical) == alignment::VCenter) ? std::floor(space / 2.0) : 0.0;
                 if (adjust != 0.0)
@@ -2830,15 +2831,355 @@ namespace neogfx
                         for (auto& line : column.lines())
                             line.ypos += adjust;
             }
+
+            // an edit can patch these lines unless the scrollbars are about to change or they have been realigned
+            if (!showVerticalScrollbar && !showHorizontalScrollbar && adjust == 0.0)
+                iLinesLayout = lines_layout{ column_rect(0), vertical_scrollbar().visible(), horizontal_scrollbar().visible(), WordWrap, *iTextExtents };
         }
         catch (std::bad_alloc)
         {
             for (auto& column : iGlyphColumns)
                 column.lines().clear();
+            iLinesLayout = std::nullopt;
             iOutOfMemory = true;
         }
     }
 
+    bool text_edit::refresh_edited_lines(lines_edit const& aEdit)
+    {
+        // if the edit leaves the column and scrollbars as they were only the paragraphs it reshaped are laid out and
+        // their lines spliced in; the lines above are kept and those below shifted by the change in height and glyphs
+        if (iLinesLayout == std::nullopt || iGlyphColumns.size() != 1u || 
+            iLinesLayout->columnRect != column_rect(0) ||
+            iLinesLayout->verticalScrollbar != vertical_scrollbar().visible() ||
+            iLinesLayout->horizontalScrollbar != horizontal_scrollbar().visible() ||
+            iLinesLayout->wordWrap != WordWrap)
+            return false;
+
+        auto& column = iGlyphColumns[0];
+        auto& lines = column.lines();
+        auto const paragraph_padding = [&](glyph_paragraph const& aParagraph)
+        {
+            return glyph_style(aParagraph.start(), column).paragraph().padding();
+        };
+
+        auto first = aEdit.tail;
+        for (auto n = aEdit.paragraphs; n != 0u; --n)
+            --first;
+        auto glyphStart = aEdit.glyphStart;
+        // a paragraph that has become the last one may need a trailing empty line
+        if (aEdit.tail == iGlyphParagraphs.end() && first != iGlyphParagraphs.begin())
+        {
+            --first;
+            glyphStart = first->first.start_index();
+        }
+
+        auto const before = [](glyph_line const& aLine, document_glyphs::size_type aGlyphPos) { return aLine.paragraphStart < aGlyphPos; };
+        auto const oldFirst = std::lower_bound(lines.begin(), lines.end(), glyphStart, before);
+        auto const oldLast = std::lower_bound(oldFirst, lines.end(), aEdit.oldGlyphEnd, before);
+
+        coordinate top = 0.0;
+        if (oldFirst != lines.begin())
+        {
+            auto const& previous = std::prev(oldFirst)->paragraph->first;
+            top = std::prev(oldFirst, previous.lines().size())->ypos - previous.lines().front().ypos + previous.lines_height();
+            if (auto const previousPadding = paragraph_padding(previous))
+                top += previousPadding->bottom;
+        }
+        std::optional<coordinate> oldBottom;
+        if (oldLast != lines.end())
+        {
+            auto const& following = oldLast->paragraph->first;
+            oldBottom = oldLast->ypos - following.lines().front().ypos;
+            if (auto const followingPadding = paragraph_padding(following))
+                *oldBottom -= followingPadding->top;
+        }
+
+        dimension const availableWidth = column_rect(0).width();
+        glyph_lines reflowed;
+        dimension reflowedWidth = 0.0;
+        coordinate bottom = top;
+        for (auto p = first; p != aEdit.tail; ++p)
+            bottom = layout_paragraph_lines(p, column, availableWidth, bottom, reflowed, reflowedWidth);
+
+        dimension removedWidth = 0.0;
+        for (auto line = oldFirst; line != oldLast; ++line)
+            removedWidth = std::max(removedWidth, line->extents.cx);
+        auto const shift = (oldBottom != std::nullopt ? bottom - *oldBottom : 0.0);
+        auto const glyphDelta = static_cast<std::ptrdiff_t>(aEdit.newGlyphEnd) - static_cast<std::ptrdiff_t>(aEdit.oldGlyphEnd);
+        auto const moved = [glyphDelta](document_glyphs::size_type aGlyphPos)
+        {
+            return static_cast<document_glyphs::size_type>(static_cast<std::ptrdiff_t>(aGlyphPos) + glyphDelta);
+        };
+        auto const reflowedCount = reflowed.size();
+        auto next = lines.insert(lines.erase(oldFirst, oldLast), reflowed.begin(), reflowed.end()) + reflowedCount;
+        for (; next != lines.end(); ++next)
+        {
+            next->paragraphStart = moved(next->paragraphStart);
+            next->paragraphEnd = moved(next->paragraphEnd);
+            next->lineStart = moved(next->lineStart);
+            next->lineEnd = moved(next->lineEnd);
+            next->ypos += shift;
+        }
+
+        auto extents = iLinesLayout->extents;
+        extents.cy = (oldBottom != std::nullopt ? extents.cy + shift : bottom);
+        if (removedWidth < extents.cx)
+            extents.cx = std::max(extents.cx, reflowedWidth);
+        else
+        {
+            extents.cx = 0.0;
+            for (auto const& line : lines)
+                extents.cx = std::max(extents.cx, line.extents.cx);
+        }
+
+        // anything that would show a scrollbar or realign the lines needs the full layout
+        if ((!vertical_scrollbar().visible() && extents.cy > column_rect(0).height()) ||
+            (!horizontal_scrollbar().visible() && extents.cx > availableWidth) ||
+            (extents.cy < client_rect(false).cy && (Alignment & alignment::Vertical) != alignment::Top))
+            return false;
+
+        iTextExtents = extents;
+        iLinesLayout->extents = extents;
+        return true;
+    }
+
+    coordinate text_edit::layout_paragraph_lines(glyph_paragraphs::iterator aParagraph, glyph_column const& aColumn, dimension aAvailableWidth, coordinate aTop, glyph_lines& aLines, dimension& aWidth)
+    {
+        auto& paragraph = aParagraph->first;
+        auto const& paragraphStyle = glyph_style(paragraph.start(), aColumn);
+        coordinate y = aTop;
+        if (paragraphStyle.paragraph().padding())
+            y += paragraphStyle.paragraph().padding().value().top;
+
+        // paragraphs keep their lines between refreshes so only those reshaped since, or last laid out for a
+        // different wrap width, are reflowed; the rest are just repositioned
+        bool const lastParagraph = (std::next(aParagraph) == iGlyphParagraphs.end());
+        auto const wrapWidth = (WordWrap ? std::optional<dimension>{ aAvailableWidth } : std::nullopt);
+        if (!paragraph.has_lines(wrapWidth, lastParagraph))
+            paragraph.set_lines(wrapWidth, lastParagraph,
+                layout_paragraph(paragraph, paragraphStyle, aAvailableWidth, lastParagraph, paragraph.lines()));
+
+        auto const paragraphStartIndex = paragraph.start_index();
+        for (auto const& line : paragraph.lines())
+        {
+            aLines.push_back(
+                glyph_line{
+                    aParagraph,
+                    paragraphStartIndex + line.paragraphLineStart,
+                    paragraphStartIndex + line.paragraphLineEnd,
+                    paragraphStartIndex + line.lineStart,
+                    paragraphStartIndex + line.lineEnd,
+                    y + line.ypos,
+                    line.extents,
+                    line.majorFont,
+                    line.baseline });
+            aWidth = std::max(aWidth, line.extents.cx);
+        }
+        y += paragraph.lines_height();
+
+        if (paragraphStyle.paragraph().padding())
+            y += paragraphStyle.paragraph().padding().value().bottom;
+        return y;
+    }
+
+    coordinate text_edit::layout_paragraph(glyph_paragraph& aParagraph, style const& aParagraphStyle, dimension aAvailableWidth, bool aLastParagraph, std::vector<paragraph_line>& aLines)
+    {
+        aLines.clear();
+
+        auto const paragraphStart = aParagraph.start();
+        thread_local std::vector<std::pair<document_glyphs::iterator, document_glyphs::iterator>> paragraphLines;
+        paragraphLines.clear();
+        glyph_text::size_type lastBreak = 0;
+        for (auto lineBreak : aParagraph.line_breaks())
+        {
+            paragraphLines.emplace_back(paragraphStart + lastBreak, paragraphStart + lineBreak);
+            lastBreak = lineBreak + 1;
+        }
+        paragraphLines.emplace_back(paragraphStart + lastBreak, aParagraph.end());
+        if (paragraphLines.back().first != paragraphLines.back().second && 
+            is_line_breaking_whitespace(glyphs().back()) && aLastParagraph)
+            paragraphLines.emplace_back(aParagraph.end(), aParagraph.end());
+
+        coordinate y = 0.0;
+        bool again = false;
+
+        for (auto const& paragraphLine : paragraphLines)
+        {
+            auto const paragraphLineStart = paragraphLine.first;
+            auto const paragraphLineEnd = paragraphLine.second;
+
+            if (again)
+            {
+                if (aParagraphStyle.paragraph().line_spacing())
+                    y += aParagraphStyle.paragraph().line_spacing().value();
+            }
+            else
+                again = true;
+
+            if (paragraphLineStart == paragraphLineEnd || is_line_breaking_whitespace(*paragraphLineStart))
+            {
+                auto lineStart = paragraphLineStart;
+                auto lineEnd = !is_line_breaking_whitespace(*paragraphLineStart) ? paragraphLineEnd : paragraphLineStart;
+
+                auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
+
+                aLines.push_back(
+                    paragraph_line{
+                        static_cast<document_glyphs::size_type>(paragraphLineStart - paragraphStart),
+                        static_cast<document_glyphs::size_type>(paragraphLineEnd - paragraphStart),
+                        static_cast<document_glyphs::size_type>(lineStart - paragraphStart),
+                        static_cast<document_glyphs::size_type>(lineEnd - paragraphStart),
+                        y,
+                        { lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f, alignBaselinesResult.yExtent },
+                        alignBaselinesResult.majorFont, 
+                        alignBaselinesResult.baseline });
+                y += aLines.back().extents.cy;
+            }
+            else if (WordWrap && static_cast<coordinate>((paragraphLineEnd - 1)->cell[0].x) + static_cast<coordinate>(quad_extents((paragraphLineEnd - 1)->cell).x) > aAvailableWidth)
+            {
+                if (glyph_text_direction(paragraphLineStart, paragraphLineEnd) == text_direction::LTR)
+                {
+                    auto next = paragraphLineStart;
+                    auto lineStart = next;
+                    auto lineEnd = paragraphLineEnd;
+                    coordinate offset = (lineEnd != lineStart ? lineStart->cell[0].x : 0.0);
+                    while (next != paragraphLineEnd)
+                    {
+                        glyph_char const key{ {}, {}, {}, {}, {}, quadf_2d{ vec2{ offset + aAvailableWidth, 0.0f } }, {} };
+                        auto split = std::lower_bound(next, paragraphLineEnd, key, [](auto const& lhs, auto const& rhs) { return lhs.cell[0].x < rhs.cell[0].x; });
+                        if (split != next && (split != paragraphLineEnd || static_cast<coordinate>((split - 1)->cell[0].x) + static_cast<coordinate>(quad_extents((split - 1)->cell).x) >= offset + aAvailableWidth))
+                            --split;
+                        if (split == next)
+                            ++split;
+                        if (split != paragraphLineEnd)
+                        {
+                            auto wordBreak = word_break(lineStart, split, paragraphLineEnd);
+                            if (wordBreak.first == wordBreak.second)
+                            {
+                                auto previousLineEnd = wordBreak.first;
+                                while (previousLineEnd != lineStart && (previousLineEnd - 1)->clusters == wordBreak.first->clusters)
+                                    --previousLineEnd;
+                                if (previousLineEnd != lineStart)
+                                {
+                                    lineEnd = wordBreak.first;
+                                    next = previousLineEnd;
+                                }
+                                else
+                                    next = lineEnd = split;
+                            }
+                            else
+                            {
+                                lineEnd = wordBreak.first;
+                                next = wordBreak.second;
+                            }
+                        }
+                        else
+                            next = paragraphLineEnd;
+                        if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
+                            --lineEnd;
+                        auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
+                        aLines.push_back(
+                            paragraph_line{
+                                static_cast<document_glyphs::size_type>(paragraphLineStart - paragraphStart),
+                                static_cast<document_glyphs::size_type>(paragraphLineEnd - paragraphStart),
+                                static_cast<document_glyphs::size_type>(lineStart - paragraphStart),
+                                static_cast<document_glyphs::size_type>(lineEnd - paragraphStart),
+                                y,
+                                { lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f, alignBaselinesResult.yExtent },
+                                alignBaselinesResult.majorFont,
+                                alignBaselinesResult.baseline });
+                        y += aLines.back().extents.cy;
+                        lineStart = next;
+                        if (lineStart != paragraphLineEnd)
+                            offset = lineStart->cell[0].x;
+                        lineEnd = paragraphLineEnd;
+                    }
+                }
+                else // RTL
+                {
+                    auto next = std::reverse_iterator{ paragraphLineEnd };
+                    auto lineStart = next;
+                    auto lineEnd = std::reverse_iterator{ paragraphLineStart };
+                    coordinate const rightmost = (lineEnd != lineStart ? lineStart->cell[1].x : 0.0);
+                    coordinate offset = rightmost;
+                    while (next != std::reverse_iterator{ paragraphLineStart })
+                    {
+                        glyph_char const key{ {}, {}, {}, {}, {}, quadf_2d{ vec2{ offset - aAvailableWidth, 0.0f } }, {} };
+                        auto split = std::lower_bound(next, std::reverse_iterator{ paragraphLineStart }, key, [=](auto const& lhs, auto const& rhs) { return offset - lhs.cell[0].x < offset - rhs.cell[0].x; });
+                        if (split != next && (split != std::reverse_iterator{ paragraphLineStart } || static_cast<coordinate>((split - 1)->cell[0].x) + static_cast<coordinate>(quad_extents((split - 1)->cell).x) >= rightmost - offset + aAvailableWidth))
+                            --split;
+                        if (split == next)
+                            ++split;
+                        if (split != std::reverse_iterator{ paragraphLineStart })
+                        {
+                            auto wordBreak = word_break(lineStart, split, std::reverse_iterator{ paragraphLineStart });
+                            if (wordBreak.first == wordBreak.second)
+                            {
+                                auto previousLineEnd = wordBreak.first;
+                                while (previousLineEnd != lineStart && (previousLineEnd - 1)->clusters == wordBreak.first->clusters)
+                                    --previousLineEnd;
+                                if (previousLineEnd != lineStart)
+                                {
+                                    lineEnd = wordBreak.first;
+                                    next = previousLineEnd;
+                                }
+                                else
+                                    next = lineEnd = split;
+                            }
+                            else
+                            {
+                                lineEnd = wordBreak.first;
+                                next = wordBreak.second;
+                            }
+                        }
+                        else
+                            next = std::reverse_iterator{ paragraphLineStart };
+                        if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
+                            --lineEnd;
+                        auto const alignBaselinesResult = glyphs().align_baselines(lineEnd.base(), lineStart.base(), true);
+                        aLines.push_back(
+                            paragraph_line{
+                                static_cast<document_glyphs::size_type>(paragraphLineStart - paragraphStart),
+                                static_cast<document_glyphs::size_type>(paragraphLineEnd - paragraphStart),
+                                static_cast<document_glyphs::size_type>(lineEnd.base() - paragraphStart),
+                                static_cast<document_glyphs::size_type>(lineStart.base() - paragraphStart),
+                                y,
+                                { lineEnd != lineStart ? (lineStart)->cell[1].x - (lineEnd - 1)->cell[0].x : 0.0f, alignBaselinesResult.yExtent },
+                                alignBaselinesResult.majorFont,
+                                alignBaselinesResult.baseline });
+                        y += aLines.back().extents.cy;
+                        lineStart = next;
+                        if (lineStart != std::reverse_iterator{ paragraphLineStart })
+                            offset = lineStart->cell[1].x;
+                        lineEnd = std::reverse_iterator{ paragraphLineStart };  
+                    }
+                }
+            }
+            else
+            {
+                auto lineStart = paragraphLineStart;
+                auto lineEnd = paragraphLineEnd;
+                if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
+                    --lineEnd;
+                auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
+                aLines.push_back(
+                    paragraph_line{
+                        static_cast<document_glyphs::size_type>(paragraphLineStart - paragraphStart),
+                        static_cast<document_glyphs::size_type>(paragraphLineEnd - paragraphStart),
+                        static_cast<document_glyphs::size_type>(lineStart - paragraphStart),
+                        static_cast<document_glyphs::size_type>(lineEnd - paragraphStart),
+                        y,
+                        { lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f, alignBaselinesResult.yExtent},
+                        alignBaselinesResult.majorFont,
+                        alignBaselinesResult.baseline });
+                y += aLines.back().extents.cy;
+            }
+        }
+
+        return y;
+    }
+
     void text_edit::animate()
     {
         if (neolib::service<neolib::i_power>().green_mode_active())
@@ -2886,24 +3227,34 @@ namespace neogfx
         return result;
     }
 
-    void text_edit::draw_glyphs(i_graphics_context const& aGc, const point& aPosition, const glyph_column& aColumn, glyph_lines::const_iterator aLine) const
+    void text_edit::draw_glyphs(i_graphics_context const& aGc, const point& aPosition, const rect& aVisibleRect, const glyph_column& aColumn, glyph_lines::const_iterator aLine) const
     {
-        auto lineStart = aLine->lineStart.second;
-        auto lineEnd = aLine->lineEnd.second;
+        auto lineStart = glyphs().begin() + aLine->lineStart;
+        auto lineEnd = glyphs().begin() + aLine->lineEnd;
 
         if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
             --lineEnd;
 
-        auto documentGlyph = lineStart;
-
         glyph_text lineGlyphs{ font(), lineStart, lineEnd };
         lineGlyphs.content().align_baselines();
 
         optional_text_format textAppearance;
         point const lineOrigin = lineStart->cell[0];
         point const textPos = aPosition - lineOrigin;
-        auto segmentStart = lineGlyphs.cbegin();
-        for (auto segmentGlyph = segmentStart; segmentGlyph != lineGlyphs.cend(); ++segmentGlyph, ++documentGlyph)
+
+        // glyph cells advance monotonically along a line so only the run of glyphs that can reach the visible
+        // area (give or take an em for overhangs and text effects) need be styled and drawn
+        auto const margin = font().height() + padding_adjust();
+        auto const visibleLeft = aVisibleRect.left() - textPos.x - margin;
+        auto const visibleRight = aVisibleRect.right() - textPos.x + margin;
+        auto const visibleBegin = std::partition_point(lineGlyphs.cbegin(), lineGlyphs.cend(),
+            [visibleLeft](glyph_char const& aGlyph) { return aGlyph.cell[1].x < visibleLeft; });
+        auto const visibleEnd = std::partition_point(visibleBegin, lineGlyphs.cend(),
+            [visibleRight](glyph_char const& aGlyph) { return aGlyph.cell[0].x <= visibleRight; });
+
+        auto documentGlyph = lineStart + (visibleBegin - lineGlyphs.cbegin());
+        auto segmentStart = visibleBegin;
+        for (auto segmentGlyph = segmentStart; segmentGlyph != visibleEnd; ++segmentGlyph, ++documentGlyph)
         {
             bool selected = false;
             if (cursor().position() != cursor().anchor())
@@ -2932,8 +3283,8 @@ namespace neogfx
             }
             textAppearance = nextTextAppearance;
         }
-        if (segmentStart != lineGlyphs.cend())
-            aGc.draw_glyph_text(textPos, lineGlyphs, segmentStart, lineGlyphs.cend(), textAppearance.value());
+        if (segmentStart != visibleEnd)
+            aGc.draw_glyph_text(textPos, lineGlyphs, segmentStart, visibleEnd, textAppearance.value());
     }
 
     void text_edit::draw_cursor(i_graphics_context const& aGc) const
@@ -38,6 +38,7 @@ namespace neogfx
         iSurfaceWindow{ aWindow },
         iLogicalCoordinateSystem{ neogfx::logical_coordinate_system::AutomaticGui },
         iFrameCounter{ 0 },
+        iLastFrameDamage{},
         iPaused{ 0 },
         iRendering{ false },
         iDebug{ false }
@@ -221,10 +222,8 @@ namespace neogfx
     {
         if (aInvalidatedRect.cx != 0.0 && aInvalidatedRect.cy != 0.0)
         {
-            if (!has_invalidated_area())
-                iInvalidatedArea = aInvalidatedRect.ceil();
-            else
-                iInvalidatedArea = invalidated_area().combined(aInvalidatedRect).ceil();
+            iInvalidatedRegion.add(aInvalidatedRect.ceil());
+            iInvalidatedArea = iInvalidatedRegion.bounding_rect();
         }
     }
 
@@ -235,22 +234,45 @@ namespace neogfx
 
     const rect& native_surface::invalidated_area() const
     {
+        if (iRenderingArea != std::nullopt)
+            return *iRenderingArea;
         if (has_invalidated_area())
             return *iInvalidatedArea;
         throw no_invalidated_area();
     }
 
+    const region& native_surface::invalidated_region() const
+    {
+        return iInvalidatedRegion;
+    }
+
     rect native_surface::validate()
     {
         if (has_invalidated_area())
         {
-            rect validatedArea = invalidated_area();
+            rect validatedArea = *iInvalidatedArea;
             iInvalidatedArea = std::nullopt;
+            iInvalidatedRegion.clear();
             return validatedArea;
         }
         throw no_invalidated_area();
     }
 
+    damage_statistics const& native_surface::last_frame_damage() const
+    {
+        return iLastFrameDamage;
+    }
+
+    const region& native_surface::rendering_region() const
+    {
+        return iRenderingRegion;
+    }
+
+    void native_surface::set_rendering_area(std::optional<rect> const& aArea)
+    {
+        iRenderingArea = aArea;
+    }
+
     bool native_surface::can_render() const
     {
         return !iPaused && surface_window().as_window().ready_to_render();
@@ -317,6 +339,17 @@ namespace neogfx
 
         ++iFrameCounter;
 
+        // each rectangle rendered is a separate pass over the widget tree so only a few are worth keeping
+        iRenderingRegion = iInvalidatedRegion;
+        iRenderingRegion.coalesce(MaxRenderPasses);
+
+        iLastFrameDamage = damage_statistics{ 
+            static_cast<uint32_t>(iInvalidatedRegion.rects().size()),
+            static_cast<uint64_t>(iInvalidatedRegion.area()),
+            static_cast<uint64_t>(iInvalidatedArea->cx * iInvalidatedArea->cy),
+            static_cast<uint32_t>(iRenderingRegion.rects().size()),
+            static_cast<uint64_t>(iRenderingRegion.area()) };
+
         iRendering = true;
         iLastFrameTime = now;
 
@@ -46,6 +46,8 @@ namespace neogfx
         define_declared_event(TargetDeactivated, target_deactivated)
     public:
         struct bad_pause_count : std::logic_error { bad_pause_count() : std::logic_error("neogfx::native_surface::bad_pause_count") {} };
+    public:
+        static constexpr std::size_t MaxRenderPasses = 4u;
     public:
         native_surface(i_rendering_engine& aRenderingEngine, i_surface_window& aWindow);
         ~native_surface();
@@ -86,7 +88,9 @@ namespace neogfx
         void invalidate(const rect& aInvalidatedRect) override;
         bool has_invalidated_area() const override;
         const rect& invalidated_area() const override;
+        const region& invalidated_region() const override;
         rect validate() override;
+        damage_statistics const& last_frame_damage() const override;
         bool can_render() const override;
         void pause() override;
         void resume() override;
@@ -97,6 +101,9 @@ namespace neogfx
     protected:
         void set_destroying() override;
         void set_destroyed() override;
+    protected:
+        const region& rendering_region() const;
+        void set_rendering_area(std::optional<rect> const& aArea);
     private:
         virtual void do_activate_target() const = 0;
         virtual void do_render() = 0;
@@ -108,7 +115,11 @@ namespace neogfx
         mutable std::optional<pixel_format_t> iPixelFormat;
         neogfx::logical_coordinate_system iLogicalCoordinateSystem;
         mutable std::optional<neogfx::logical_coordinates> iLogicalCoordinates;
+        region iInvalidatedRegion;
         std::optional<rect> iInvalidatedArea;
+        std::optional<rect> iRenderingArea;
+        region iRenderingRegion;
+        damage_statistics iLastFrameDamage;
         uint64_t iFrameCounter;
         typedef std::chrono::time_point<std::chrono::high_resolution_clock> frame_time_point;
         typedef std::pair<frame_time_point, frame_time_point> frame_times;
@@ -231,11 +231,21 @@ namespace neogfx
         return parent().invalidated_area();
     }
 
+    const region& virtual_surface::invalidated_region() const
+    {
+        return parent().invalidated_region();
+    }
+
     rect virtual_surface::validate()
     {
         return parent().validate();
     }
 
+    damage_statistics const& virtual_surface::last_frame_damage() const
+    {
+        return parent().last_frame_damage();
+    }
+
     bool virtual_surface::can_render() const
     {
         return parent().can_render();
@@ -91,7 +91,9 @@ namespace neogfx
         void invalidate(const rect& aInvalidatedRect) final;
         bool has_invalidated_area() const final;
         const rect& invalidated_area() const final;
+        const region& invalidated_region() const final;
         rect validate() final;
+        damage_statistics const& last_frame_damage() const final;
         bool can_render() const final;
         void render(bool aOOBRequest = false) final;
         void pause() final;
@@ -254,6 +254,11 @@ namespace neogfx
         return native_surface().invalidated_area();
     }
 
+    const region& surface_window::invalidated_region() const
+    {
+        return native_surface().invalidated_region();
+    }
+
     rect surface_window::validate()
     {
         return native_surface().validate();
@@ -0,0 +1,348 @@
+﻿#include <neogfx/neogfx.hpp>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <neolib/core/random.hpp>
+#include <neogfx/game/ecs.hpp>
+#include <neogfx/game/standard_archetypes.hpp>
+#include <neogfx/game/rigid_body.hpp>
+#include <neogfx/game/box_collider.hpp>
+#include <neogfx/game/collision_detector.hpp>
+#include <neogfx/app/i_app.hpp>
+#include <neogfx/gfx/vertex_transform.hpp>
+#include <neogfx/gui/layout/i_async_layout.hpp>
+#include <neogfx/gui/window/window.hpp>
+#include <neogfx/gui/widget/item_model.hpp>
+#include <neogfx/gui/widget/item_presentation_model.hpp>
+#include <neogfx/gui/widget/table_view.hpp>
+#include <neogfx/gui/widget/text_edit.hpp>
+#include <neogfx/gui/widget/terminal.hpp>
+
+// Timing harness for engine hot paths; run with "--console --benchmark", results go to standard output.
+
+namespace ng = neogfx;
+
+namespace
+{
+    typedef std::chrono::high_resolution_clock benchmark_clock;
+
+    template <typename Function>
+    double time_ms(Function&& aFunction)
+    {
+        auto const start = benchmark_clock::now();
+        aFunction();
+        return std::chrono::duration<double, std::milli>{ benchmark_clock::now() - start }.count();
+    }
+
+    ng::game::sprite_archetype const benchmarkCollider{ "Benchmark Collider" };
+
+    // Mean collision detection cycle time for a scene in which aMovingPercent of the colliders move each cycle.
+    double broadphase_cycle_ms(std::size_t aColliders, std::size_t aMovingPercent, ng::game::broadphase_strategy aStrategy, ng::game::broadphase_update_mode aMode)
+    {
+        std::size_t constexpr Cycles = 20u;
+
+        ng::game::ecs ecs{ ng::game::ecs_flags::Default | ng::game::ecs_flags::NoThreads };
+        auto& detector = ecs.system<ng::game::collision_detector>();
+        detector.set_broadphase(aStrategy);
+        detector.set_update_mode(aMode);
+
+        neolib::basic_random<ng::scalar> prng{ 42 };
+        ng::scalar const worldExtent = std::sqrt(static_cast<ng::scalar>(aColliders)) * 32.0;
+        std::vector<ng::game::entity_id> entities;
+        entities.reserve(aColliders);
+        for (std::size_t i = 0u; i < aColliders; ++i)
+            entities.push_back(ecs.create_entity(
+                benchmarkCollider,
+                ng::to_ecs_component(ng::rect{ ng::size{ prng(8.0) + 8.0 } }.with_centered_origin()),
+                ng::game::material{ ng::to_ecs_component(ng::color::White), {}, {}, {} },
+                ng::game::rigid_body{ ng::vec3{ prng(worldExtent), prng(worldExtent), 0.0 }, 1.0 },
+                ng::game::box_collider_2d{ i % 2u == 0u ? 0x1ull : 0x2ull }));
+        detector.run_cycle();
+
+        std::size_t const moving = std::max<std::size_t>(aColliders * aMovingPercent / 100u, 1u);
+        double total = 0.0;
+        for (std::size_t cycle = 0u; cycle < Cycles; ++cycle)
+        {
+            {
+                ng::game::scoped_component_lock<ng::game::rigid_body> lock{ ecs };
+                auto& rigidBodies = ecs.component<ng::game::rigid_body>();
+                for (std::size_t i = 0u; i < moving; ++i)
+                    rigidBodies.entity_record(entities[(cycle * moving + i) % entities.size()]).position +=
+                        ng::vec3{ prng(8.0) - 4.0, prng(8.0) - 4.0, 0.0 };
+            }
+            total += time_ms([&]() { detector.run_cycle(); });
+        }
+        return total / Cycles;
+    }
+
+    void benchmark_broadphase_update()
+    {
+        std::cout << "Broadphase tree update, ms per collision detection cycle (1% of colliders moving)" << std::endl;
+        std::cout << std::setw(12) << "colliders" << std::setw(12) << "full" << std::setw(14) << "incremental" << std::endl;
+        for (std::size_t colliders : { 1000u, 10000u, 50000u })
+            std::cout << std::setw(12) << colliders <<
+                std::setw(12) << broadphase_cycle_ms(colliders, 1u, ng::game::broadphase_strategy::Tree, ng::game::broadphase_update_mode::Full) <<
+                std::setw(14) << broadphase_cycle_ms(colliders, 1u, ng::game::broadphase_strategy::Tree, ng::game::broadphase_update_mode::Incremental) << std::endl;
+        std::cout << std::endl;
+    }
+
+    void benchmark_broadphase_strategies()
+    {
+        for (std::size_t movingPercent : { 1u, 100u })
+        {
+            std::cout << "Broadphase strategy, ms per collision detection cycle (" << movingPercent << "% of colliders moving)" << std::endl;
+            std::cout << std::setw(12) << "colliders" << std::setw(12) << "tree" << std::setw(14) << "spatial hash" << std::setw(16) << "sweep and prune" << std::endl;
+            for (std::size_t colliders : { 1000u, 10000u, 50000u })
+                std::cout << std::setw(12) << colliders <<
+                    std::setw(12) << broadphase_cycle_ms(colliders, movingPercent, ng::game::broadphase_strategy::Tree, ng::game::broadphase_update_mode::Full) <<
+                    std::setw(14) << broadphase_cycle_ms(colliders, movingPercent, ng::game::broadphase_strategy::SpatialHash, ng::game::broadphase_update_mode::Full) <<
+                    std::setw(16) << broadphase_cycle_ms(colliders, movingPercent, ng::game::broadphase_strategy::SweepAndPrune, ng::game::broadphase_update_mode::Full) << std::endl;
+            std::cout << std::endl;
+        }
+    }
+
+    // Time to load (and shape) the whole document, then the mean time of a single character insertion or deletion
+    // in the middle of it, including line layout.
+    void benchmark_text_edit()
+    {
+        std::size_t constexpr Edits = 20u;
+
+        ng::window window{ ng::size{ 800.0, 600.0 } };
+        ng::text_edit textEdit{ window.client_layout() };
+
+        std::cout << "text_edit load time, ms, and edit latency, ms per keystroke (word wrap on)" << std::endl;
+        std::cout << std::setw(12) << "lines" << std::setw(12) << "load" << std::setw(12) << "latency" << std::endl;
+        for (std::size_t lines : { 1000u, 10000u, 100000u })
+        {
+            std::string document;
+            for (std::size_t line = 0u; line < lines; ++line)
+                document += "The quick brown fox jumps over the lazy dog " + std::to_string(line) + "\n";
+            ng::string const text{ document };
+            auto const load = time_ms([&]() { textEdit.set_plain_text(text); });
+            auto const middle = static_cast<ng::text_edit::position_type>(document.size() / 2u);
+            double total = 0.0;
+            for (std::size_t edit = 0u; edit < Edits; ++edit)
+            {
+                total += time_ms([&]() { textEdit.insert_text(middle, ng::string{ "x" }); });
+                total += time_ms([&]() { textEdit.delete_text(middle, middle + 1u); });
+            }
+            std::cout << std::setw(12) << lines << std::setw(12) << load << std::setw(12) << total / (Edits * 2u) << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Parsing throughput of terminal::output for a build log written in 64 KiB chunks; repaints are deferred to the
+    // terminal's frame timer so they are not included.
+    double terminal_mb_per_s(ng::terminal& aTerminal, bool aAnsi)
+    {
+        std::size_t constexpr ChunkSize = 64u * 1024u;
+        std::size_t constexpr Chunks = 256u;
+
+        std::string chunk;
+        for (std::size_t line = 0u; chunk.size() < ChunkSize; ++line)
+        {
+            if (aAnsi)
+                chunk += "\x1B[32m[" + std::to_string(line) + "]\x1B[0m \x1B[1;33mwarning:\x1B[0m unused variable \x1B[36m'x'\x1B[0m\r\n";
+            else
+                chunk += "[" + std::to_string(line) + "] warning: unused variable 'x' in src/gui/widget/terminal.cpp\r\n";
+        }
+        ng::string const output{ chunk };
+        auto const elapsed = time_ms([&]()
+        {
+            for (std::size_t i = 0u; i < Chunks; ++i)
+                aTerminal.output(output);
+        });
+        return (static_cast<double>(chunk.size()) * Chunks / (1024.0 * 1024.0)) / (elapsed / 1000.0);
+    }
+
+    void benchmark_terminal()
+    {
+        ng::window window{ ng::size{ 800.0, 600.0 } };
+        ng::terminal terminal{ window.client_layout() };
+
+        std::cout << "terminal::output throughput, MB/s" << std::endl;
+        std::cout << std::setw(12) << "plain" << std::setw(12) << "ANSI" << std::endl;
+        std::cout << std::setw(12) << terminal_mb_per_s(terminal, false);
+        std::cout << std::setw(12) << terminal_mb_per_s(terminal, true) << std::endl;
+        std::cout << std::endl;
+    }
+
+    // Rows of three random strings for the item_presentation_model benchmarks.
+    void fill_item_model(ng::item_model& aModel, uint32_t aRows)
+    {
+        neolib::random prng{ 42 };
+        aModel.reserve(aRows);
+        for (uint32_t row = 0u; row < aRows; ++row)
+            for (uint32_t col = 0u; col < 3u; ++col)
+            {
+                std::string randomString;
+                for (uint32_t j = prng(12u) + 1u; j-- > 0u;)
+                    randomString += static_cast<char>('A' + prng('z' - 'A'));
+                if (col == 0u)
+                    aModel.insert_item(ng::item_model_index{ row }, randomString);
+                else
+                    aModel.insert_cell_data(ng::item_model_index{ row, col }, randomString);
+            }
+    }
+
+    // Time to first paint of a table view (its header sizing every column, the total height and the row in the middle
+    // of the scroll range) and the cost of bringing it up to date after a single cell edit, with and without
+    // virtualized row extents.
+    void benchmark_row_extents()
+    {
+        ng::window window{ ng::size{ 800.0, 600.0 } };
+
+        std::cout << "item_presentation_model row extents, ms" << std::endl;
+        std::cout << std::setw(12) << "rows" << std::setw(12) << "open" << std::setw(12) << "edit" << 
+            std::setw(16) << "virtual open" << std::setw(16) << "virtual edit" << std::endl;
+        for (uint32_t rows : { 10000u, 100000u })
+        {
+            ng::item_model itemModel;
+            fill_item_model(itemModel, rows);
+            std::cout << std::setw(12) << rows;
+            for (bool virtualized : { false, true })
+            {
+                ng::item_presentation_model presentationModel;
+                presentationModel.set_virtualized_row_extents(virtualized);
+                ng::table_view tableView{ window.client_layout() };
+                tableView.set_presentation_model(presentationModel);
+                auto const open = time_ms([&]()
+                {
+                    tableView.set_model(itemModel);
+                    presentationModel.item_at(presentationModel.total_height(tableView) / 2.0, tableView);
+                });
+                auto const edit = time_ms([&]()
+                {
+                    itemModel.update_cell_data(ng::item_model_index{ rows / 2u, 1u }, std::string{ "Edited" });
+                    presentationModel.item_at(presentationModel.total_height(tableView) / 2.0, tableView);
+                });
+                std::cout << std::setw(virtualized ? 16 : 12) << open << std::setw(virtualized ? 16 : 12) << edit;
+            }
+            std::cout << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Sorting on the GUI thread against sorting in the background: for the latter both the time the GUI thread is
+    // blocked by sort_by and the time until the sorted rows are published are reported.
+    void benchmark_sort()
+    {
+        std::cout << "item_presentation_model sort, ms" << std::endl;
+        std::cout << std::setw(12) << "rows" << std::setw(12) << "sync" << std::setw(20) << "background call" << 
+            std::setw(20) << "background sorted" << std::endl;
+        for (uint32_t rows : { 10000u, 100000u, 1000000u })
+        {
+            ng::item_model itemModel;
+            fill_item_model(itemModel, rows);
+            ng::item_presentation_model presentationModel{ itemModel, true };
+            auto const sync = time_ms([&]() { presentationModel.sort_by(1u, ng::i_item_presentation_model::sort_direction::Ascending); });
+            presentationModel.set_background_sort_filter(true);
+            double call = 0.0;
+            auto const sorted = time_ms([&]()
+            {
+                call = time_ms([&]() { presentationModel.sort_by(2u, ng::i_item_presentation_model::sort_direction::Ascending); });
+                while (presentationModel.sort_filter_pending())
+                    ng::service<ng::i_app>().process_events();
+            });
+            std::cout << std::setw(12) << rows << std::setw(12) << sync << std::setw(20) << call << std::setw(20) << sorted << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // One async layout tick after every table view's column header requests a deferred layout of itself and its
+    // ancestors; laid out widgets should stay at the number of subtrees rather than grow with the deferrals queued.
+    void benchmark_async_layout()
+    {
+        auto& asyncLayout = ng::service<ng::i_async_layout>();
+        auto const process_events_until = [](auto&& aPredicate)
+        {
+            while (!aPredicate())
+                ng::service<ng::i_app>().process_events();
+        };
+
+        std::cout << "async_layout tick after a header of every table view is invalidated" << std::endl;
+        std::cout << std::setw(12) << "tables" << std::setw(12) << "queued" << std::setw(12) << "coalesced" << 
+            std::setw(12) << "laid out" << std::setw(12) << "ms" << std::endl;
+        for (std::size_t tables : { 10u, 100u, 500u })
+        {
+            ng::window window{ ng::size{ 800.0, 600.0 } };
+            std::vector<std::unique_ptr<ng::table_view>> tableViews;
+            for (std::size_t i = 0u; i < tables; ++i)
+                tableViews.push_back(std::make_unique<ng::table_view>(window.client_layout()));
+            // let the layouts deferred while building the tables run, then wait for a quiet tick
+            process_events_until([&]() { return asyncLayout.last_tick_statistics().queued != 0u; });
+            process_events_until([&]() { return asyncLayout.last_tick_statistics().queued == 0u; });
+            for (auto& tableView : tableViews)
+                tableView->column_header().update_layout(true, true);
+            process_events_until([&]() { return asyncLayout.last_tick_statistics().queued != 0u; });
+            auto const& statistics = asyncLayout.last_tick_statistics();
+            std::cout << std::setw(12) << tables << std::setw(12) << statistics.queued << std::setw(12) << statistics.coalesced <<
+                std::setw(12) << statistics.laidOut << std::setw(12) << statistics.duration.count() / 1000.0 << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // transform_vertices against the per-vertex matrix-vector product it replaced in the OpenGL vertex upload path.
+    void benchmark_vertex_transform()
+    {
+        std::size_t constexpr Passes = 10u;
+
+        ng::mat44 transformation = ng::mat44::identity();
+        transformation[0][0] = 2.0;
+        transformation[1][1] = 2.0;
+        transformation[3][0] = 100.0;
+        transformation[3][1] = 50.0;
+        ng::optional_mat44 const affine = transformation;
+        ng::optional_mat44 const none;
+
+        std::cout << "Vertex transform, Mvertices/s" << std::endl;
+        std::cout << std::setw(12) << "vertices" << std::setw(12) << "scalar" << std::setw(12) << "affine" << std::setw(12) << "none" << std::endl;
+        for (std::size_t vertices : { 10000u, 100000u, 1000000u })
+        {
+            neolib::basic_random<ng::scalar> prng{ 42 };
+            std::vector<ng::vec3> input(vertices);
+            for (auto& v : input)
+                v = ng::vec3{ prng(1000.0), prng(1000.0), 0.0 };
+            std::vector<ng::vec3f> output(vertices);
+            auto const mvertices_per_s = [&](double aElapsed) { return static_cast<double>(vertices) * Passes / 1000.0 / aElapsed; };
+            auto const scalar = time_ms([&]()
+            {
+                for (std::size_t pass = 0u; pass < Passes; ++pass)
+                    for (std::size_t i = 0u; i < vertices; ++i)
+                        output[i] = (transformation * input[i]).as<float>();
+            });
+            auto const withAffine = time_ms([&]()
+            {
+                for (std::size_t pass = 0u; pass < Passes; ++pass)
+                    ng::transform_vertices(affine, input.data(), vertices, output.data());
+            });
+            auto const withNone = time_ms([&]()
+            {
+                for (std::size_t pass = 0u; pass < Passes; ++pass)
+                    ng::transform_vertices(none, input.data(), vertices, output.data());
+            });
+            std::cout << std::setw(12) << vertices << std::setw(12) << mvertices_per_s(scalar) <<
+                std::setw(12) << mvertices_per_s(withAffine) << std::setw(12) << mvertices_per_s(withNone) << std::endl;
+        }
+        std::cout << std::endl;
+    }
+}
+
+int run_benchmarks()
+{
+    std::cout << std::fixed << std::setprecision(3);
+    benchmark_broadphase_update();
+    benchmark_broadphase_strategies();
+    benchmark_text_edit();
+    benchmark_terminal();
+    benchmark_row_extents();
+    benchmark_sort();
+    benchmark_async_layout();
+    benchmark_vertex_transform();
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -22,6 +22,15 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+    // "--benchmark" runs the timing harness in benchmarks.cpp instead of the test app
+    auto const benchmarkOption = std::find_if(argv + 1, argv + argc, [](char const* aArg) { return std::string_view{ aArg } == "--benchmark"; });
+    bool const benchmark = (benchmarkOption != argv + argc);
+    if (benchmark)
+    {
+        std::rotate(benchmarkOption, benchmarkOption + 1, argv + argc);
+        --argc;
+    }
+
     /* Yes this is an 800 line (and counting) function and whilst in general such long functions are
     egregious this function is a special case: it is test code which mostly just creates widgets. 
     Most of this code is about to disappear into code auto-generated by the neoGFX resource compiler! */
@@ -35,6 +44,9 @@ int main(int argc, char* argv[])
         app.current_style().palette().set_color(ng::color_role::Theme, ng::color::Black);
         app.change_style("Dark");
 
+        if (benchmark)
+            return run_benchmarks();
+
         test::main_window window{ app };
 
         window.labelDPI.set_text(ng::string{ (std::ostringstream{} << "DPI: " <<
@@ -1,5 +1,7 @@
 ﻿#include <neolib/neolib.hpp>
 #include <csignal>
+#include <algorithm>
+#include <string_view>
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 #include <neolib/core/random.hpp>
@@ -220,4 +222,5 @@ private:
 };
 
 ng::game::i_ecs& create_game(ng::i_layout& aLayout);
+int run_benchmarks();
 